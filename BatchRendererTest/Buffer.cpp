@@ -77,6 +77,11 @@ IndexBuffer::IndexBuffer(uint32_t* indices, size_t size)
 	glBufferData(GL_ARRAY_BUFFER, size, indices, GL_STATIC_DRAW);
 }
 
+IndexBuffer::~IndexBuffer()
+{
+	glDeleteBuffers(1, &m_RendererID);
+}
+
 void IndexBuffer::Bind()
 {
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_RendererID);
@@ -110,16 +115,14 @@ VertexArray::VertexArray(VertexBuffer* vertexBuffer, IndexBuffer* indexBuffer)
 		SetIndexBuffer(indexBuffer);
 }
 
+// the buffers belong to whoever created them, they can be shared by several arrays
 VertexArray::~VertexArray()
 {
-	delete m_VertexBuffer;
-	delete m_IndexBuffer;
+	glDeleteVertexArrays(1, &m_RendererID);
 }
 
 void VertexArray::SetVertexBuffer(VertexBuffer* vertexBuffer)
 {
-	delete m_VertexBuffer;
-
 	glBindVertexArray(m_RendererID);
 	vertexBuffer->Bind();
 
@@ -143,8 +146,6 @@ void VertexArray::SetVertexBuffer(VertexBuffer* vertexBuffer)
 
 void VertexArray::SetIndexBuffer(IndexBuffer* indexBuffer)
 {
-	delete m_IndexBuffer;
-
 	glBindVertexArray(m_RendererID);
 
 	indexBuffer->Bind();
@@ -56,6 +56,7 @@ class IndexBuffer
 public:
 	IndexBuffer(size_t size);
 	IndexBuffer(uint32_t* indices, size_t size);
+	~IndexBuffer();
 
 	void Bind();
 	void Unbind();
@@ -69,6 +70,7 @@ private:
 	uint32_t m_Size;
 };
 
+// only references the buffers, deleting it leaves them alone
 class VertexArray
 {
 public:
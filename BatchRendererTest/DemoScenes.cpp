@@ -0,0 +1,69 @@
+#include "DemoScenes.h"
+
+#include <math.h>
+
+void DrawCheckerboardRect(Renderer2D* target, const CheckerboardDesc& desc, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1)
+{
+	Transform quadTransform = {};
+	quadTransform.Scale = desc.QuadScale;
+
+	for (uint32_t height = y0; height < y1; height++)
+	{
+		for (uint32_t width = x0; width < x1; width++)
+		{
+			bool white = !((width + height) % 2);
+			quadTransform.Location = { quadTransform.Scale.X * width, quadTransform.Scale.Y * height, 0.0f };
+			target->DrawQuadTextured(quadTransform, white ? target->GetWhiteTexture() : desc.Texture, desc.TilingFactor, { 1.0f, 1.0f, 1.0f });
+		}
+	}
+}
+
+void DrawMainQuad(Renderer2D* target, const Transform& transform, Vec3 color)
+{
+	target->DrawQuad(transform, color);
+}
+
+void DrawDebugShapes(Renderer2D* target, uint32_t count)
+{
+	const uint32_t shapesPerRow = 100;
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		float x = -2.0f - (i % shapesPerRow) * 0.25f;
+		float y = (i / shapesPerRow) * 0.25f;
+		Vec3 color = { 0.3f + (i % 7) * 0.1f, 0.9f - (i % 5) * 0.15f, 0.4f + (i % 3) * 0.2f };
+
+		switch (i % 4)
+		{
+		case 0:
+			target->DrawCircle({ x, y, -0.05f }, 0.1f, color);
+			break;
+		case 1:
+			target->DrawCircle({ x, y, -0.05f }, 0.1f, color, 0.03f);
+			break;
+		case 2:
+			target->DrawRoundedRect({ { x, y, -0.05f }, { 0.0f, 0.0f, (float)(i % 45) }, { 0.2f, 0.12f, 1.0f } }, 0.04f, color);
+			break;
+		case 3:
+			target->DrawLine({ x - 0.08f, y - 0.08f, -0.05f }, { x + 0.08f, y + 0.08f, -0.05f }, 0.02f, color);
+			break;
+		}
+	}
+}
+
+void EmitParallelSprites(SubmissionContext* submission, Texture* texture, uint32_t first, uint32_t count, float time)
+{
+	const uint32_t spritesPerRow = 500;
+
+	for (uint32_t i = first; i < first + count; i++)
+	{
+		float x = -2.0f - (i % spritesPerRow) * 0.05f;
+		float y = -1.0f - (i / spritesPerRow) * 0.05f + sinf(time * 2.0f + x) * 0.1f;
+		Transform transform = { { x, y, -0.1f }, { 0.0f, 0.0f, (float)(i % 90) }, { 0.04f, 0.04f, 1.0f } };
+
+		if (i & 1)
+			submission->DrawQuadTextured(transform, texture);
+		else
+			submission->DrawQuad(transform, { 0.2f + (i % 5) * 0.2f, 0.6f, 1.0f - (i % 3) * 0.3f });
+	}
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "Renderer2D.h"
+
+// The demo's scenes as functions of their settings, so the golden tests (Tests.cpp) draw exactly
+// what the demo draws and only pick fixed settings for it.
+
+struct CheckerboardDesc
+{
+	Texture* Texture; // the non-white squares
+	Vec3 QuadScale;
+	float TilingFactor;
+};
+
+// a quad is white (untextured) when its column and row add up to an even number
+void DrawCheckerboardRect(Renderer2D* target, const CheckerboardDesc& desc, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1);
+
+// the spinning quad in front of the checkerboard, untextured and tinted
+void DrawMainQuad(Renderer2D* target, const Transform& transform, Vec3 color);
+
+// rows of circles, rings, rounded rects and lines left of the checkerboard, the kind of thing debug drawing spams
+void DrawDebugShapes(Renderer2D* target, uint32_t count);
+
+// sprites [first, first + count) of the grid below the debug shapes, every other one textured and the rest tinted.
+// time makes them bob
+void EmitParallelSprites(SubmissionContext* submission, Texture* texture, uint32_t first, uint32_t count, float time);
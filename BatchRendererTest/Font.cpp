@@ -0,0 +1,342 @@
+#include "Font.h"
+
+#include "Texture.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+// ImGui compiles its own copy as static, so we need one for this translation unit as well
+#define STBTT_STATIC
+#define STB_TRUETYPE_IMPLEMENTATION
+#include "ImGui/imstb_truetype.h"
+
+// empty texels between glyphs so linear filtering doesn't pick up the neighbours
+static const uint32_t GlyphPadding = 1;
+
+// SDF glyphs don't depend on the requested size, so they all share this key space
+static const uint64_t SdfKeyPrefix = (uint64_t)Font::SdfPixelSize << 32;
+
+Font::Font(std::vector<unsigned char>&& data, uint32_t atlasSize, bool cpuOnly)
+	: m_Data(std::move(data)), m_Missing()
+{
+	stbtt_fontinfo* info = new stbtt_fontinfo();
+	stbtt_InitFont(info, m_Data.data(), stbtt_GetFontOffsetForIndex(m_Data.data(), 0));
+	m_Info = info;
+
+	InitAtlas(m_Bitmap, atlasSize, cpuOnly);
+	InitAtlas(m_Sdf, atlasSize, cpuOnly);
+}
+
+Font::~Font()
+{
+	delete (stbtt_fontinfo*)m_Info;
+	delete m_Bitmap.Page;
+	delete m_Sdf.Page;
+}
+
+Font* Font::FromFile(const char* path, uint32_t atlasSize, bool cpuOnly)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+		return nullptr;
+
+	std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	file.close();
+
+	if (data.empty() || stbtt_GetFontOffsetForIndex(data.data(), 0) < 0)
+		return nullptr;
+
+	return new Font(std::move(data), atlasSize, cpuOnly);
+}
+
+const Glyph& Font::GetGlyph(uint32_t codepoint, uint32_t pixelSize)
+{
+	uint64_t key = ((uint64_t)pixelSize << 32) | codepoint;
+
+	std::unordered_map<uint64_t, Glyph>::iterator it = m_Bitmap.Glyphs.find(key);
+	if (it != m_Bitmap.Glyphs.end())
+		return it->second;
+
+	stbtt_fontinfo* info = (stbtt_fontinfo*)m_Info;
+	float scale = stbtt_ScaleForPixelHeight(info, (float)pixelSize);
+
+	int advance, leftSideBearing;
+	stbtt_GetCodepointHMetrics(info, codepoint, &advance, &leftSideBearing);
+
+	int x0, y0, x1, y1;
+	stbtt_GetCodepointBitmapBox(info, codepoint, scale, scale, &x0, &y0, &x1, &y1);
+
+	Glyph glyph = {};
+	glyph.Advance = advance * scale;
+	glyph.OffsetX = (float)x0;
+	glyph.OffsetY = (float)y0;
+	glyph.Width = (float)(x1 - x0);
+	glyph.Height = (float)(y1 - y0);
+
+	uint32_t width = x1 > x0 ? x1 - x0 : 0;
+	uint32_t height = y1 > y0 ? y1 - y0 : 0;
+
+	std::vector<unsigned char> coverage(width * height);
+	if (!coverage.empty())
+		stbtt_MakeCodepointBitmap(info, coverage.data(), width, height, width, scale, scale, codepoint);
+
+	if (!Store(m_Bitmap, key, glyph, coverage.data(), width, height))
+		return m_Missing;
+
+	return m_Bitmap.Glyphs[key];
+}
+
+const Glyph& Font::GetSdfGlyph(uint32_t codepoint)
+{
+	std::unordered_map<uint64_t, Glyph>::iterator it = m_Sdf.Glyphs.find(SdfKeyPrefix | codepoint);
+	if (it != m_Sdf.Glyphs.end())
+		return it->second;
+
+	SdfBitmap bitmap = CreateSdfBitmap(codepoint);
+	const Glyph& glyph = StoreSdfGlyph(bitmap);
+	stbtt_FreeSDF(bitmap.Data, nullptr);
+
+	return glyph;
+}
+
+void Font::PrewarmSdf(uint32_t first, uint32_t last, uint32_t threadCount)
+{
+	std::vector<uint32_t> missing;
+	for (uint32_t codepoint = first; codepoint <= last; codepoint++)
+	{
+		if (m_Sdf.Glyphs.find(SdfKeyPrefix | codepoint) == m_Sdf.Glyphs.end())
+			missing.push_back(codepoint);
+	}
+
+	if (missing.empty())
+		return;
+
+	if (threadCount < 1)
+		threadCount = 1;
+
+	// the distance field is the expensive part and only reads the font, packing/upload stays on this thread
+	std::vector<SdfBitmap> bitmaps(missing.size());
+
+	uint32_t perThread = (missing.size() + threadCount - 1) / threadCount;
+	WorkerPool::Get().Run(threadCount, [this, &missing, &bitmaps, perThread](uint32_t thread)
+	{
+		uint32_t begin = thread * perThread;
+		uint32_t end = std::min<uint32_t>(begin + perThread, missing.size());
+		for (uint32_t i = begin; i < end; i++)
+			bitmaps[i] = CreateSdfBitmap(missing[i]);
+	});
+
+	for (SdfBitmap& bitmap : bitmaps)
+	{
+		StoreSdfGlyph(bitmap);
+		stbtt_FreeSDF(bitmap.Data, nullptr);
+	}
+}
+
+Font::SdfBitmap Font::CreateSdfBitmap(uint32_t codepoint) const
+{
+	stbtt_fontinfo* info = (stbtt_fontinfo*)m_Info;
+	float scale = stbtt_ScaleForPixelHeight(info, (float)SdfPixelSize);
+
+	SdfBitmap bitmap = {};
+	bitmap.Codepoint = codepoint;
+
+	int width = 0, height = 0, offsetX = 0, offsetY = 0;
+	bitmap.Data = stbtt_GetCodepointSDF(info, scale, codepoint, SdfPadding, SdfOnEdgeValue, SdfPixelDistScale, &width, &height, &offsetX, &offsetY);
+
+	bitmap.Width = bitmap.Data ? width : 0;
+	bitmap.Height = bitmap.Data ? height : 0;
+	bitmap.OffsetX = offsetX;
+	bitmap.OffsetY = offsetY;
+
+	return bitmap;
+}
+
+const Glyph& Font::StoreSdfGlyph(const SdfBitmap& bitmap)
+{
+	stbtt_fontinfo* info = (stbtt_fontinfo*)m_Info;
+	float scale = stbtt_ScaleForPixelHeight(info, (float)SdfPixelSize);
+
+	int advance, leftSideBearing;
+	stbtt_GetCodepointHMetrics(info, bitmap.Codepoint, &advance, &leftSideBearing);
+
+	Glyph glyph = {};
+	glyph.Advance = advance * scale;
+	glyph.OffsetX = (float)bitmap.OffsetX;
+	glyph.OffsetY = (float)bitmap.OffsetY;
+	glyph.Width = (float)bitmap.Width;
+	glyph.Height = (float)bitmap.Height;
+
+	uint64_t key = SdfKeyPrefix | bitmap.Codepoint;
+	if (!Store(m_Sdf, key, glyph, bitmap.Data, bitmap.Width, bitmap.Height))
+		return m_Missing;
+
+	return m_Sdf.Glyphs[key];
+}
+
+bool Font::Store(GlyphAtlas& atlas, uint64_t key, Glyph& glyph, const unsigned char* alpha, uint32_t width, uint32_t height)
+{
+	glyph.Visible = false;
+
+	if (width > 0 && height > 0)
+	{
+		uint32_t x, y;
+		if (!Allocate(atlas, width, height, x, y))
+		{
+			// not cached, it'll be rasterized again once NewFrame has cleared the atlas
+			atlas.ResetPending = true;
+			m_Missing = glyph;
+			return false;
+		}
+
+		std::vector<uint32_t> pixels(width * height);
+		for (uint32_t i = 0; i < width * height; i++)
+			pixels[i] = 0x00ffffff | ((uint32_t)alpha[i] << 24);
+
+		atlas.Page->SetData(x, y, width, height, (unsigned char*)pixels.data());
+
+		glyph.U0 = (float)x / atlas.Size;
+		glyph.V0 = (float)y / atlas.Size;
+		glyph.U1 = (float)(x + width) / atlas.Size;
+		glyph.V1 = (float)(y + height) / atlas.Size;
+		glyph.Visible = true;
+	}
+
+	atlas.Glyphs[key] = glyph;
+	return true;
+}
+
+float Font::GetKerning(uint32_t first, uint32_t second, uint32_t pixelSize) const
+{
+	stbtt_fontinfo* info = (stbtt_fontinfo*)m_Info;
+	return stbtt_GetCodepointKernAdvance(info, first, second) * stbtt_ScaleForPixelHeight(info, (float)pixelSize);
+}
+
+float Font::GetLineHeight(uint32_t pixelSize) const
+{
+	stbtt_fontinfo* info = (stbtt_fontinfo*)m_Info;
+
+	int ascent, descent, lineGap;
+	stbtt_GetFontVMetrics(info, &ascent, &descent, &lineGap);
+
+	return (ascent - descent + lineGap) * stbtt_ScaleForPixelHeight(info, (float)pixelSize);
+}
+
+float Font::GetAscent(uint32_t pixelSize) const
+{
+	stbtt_fontinfo* info = (stbtt_fontinfo*)m_Info;
+
+	int ascent, descent, lineGap;
+	stbtt_GetFontVMetrics(info, &ascent, &descent, &lineGap);
+
+	return ascent * stbtt_ScaleForPixelHeight(info, (float)pixelSize);
+}
+
+void Font::NewFrame()
+{
+	if (m_Bitmap.ResetPending)
+		ResetAtlas(m_Bitmap);
+	if (m_Sdf.ResetPending)
+		ResetAtlas(m_Sdf);
+}
+
+uint32_t Font::DecodeUTF8(const char*& text)
+{
+	const unsigned char* s = (const unsigned char*)text;
+
+	uint32_t codepoint;
+	uint32_t length;
+
+	if (s[0] < 0x80)
+	{
+		codepoint = s[0];
+		length = 1;
+	}
+	else if ((s[0] & 0xe0) == 0xc0)
+	{
+		codepoint = s[0] & 0x1f;
+		length = 2;
+	}
+	else if ((s[0] & 0xf0) == 0xe0)
+	{
+		codepoint = s[0] & 0x0f;
+		length = 3;
+	}
+	else if ((s[0] & 0xf8) == 0xf0)
+	{
+		codepoint = s[0] & 0x07;
+		length = 4;
+	}
+	else
+	{
+		text++;
+		return '?';
+	}
+
+	for (uint32_t i = 1; i < length; i++)
+	{
+		if ((s[i] & 0xc0) != 0x80)
+		{
+			// truncated sequence, don't skip past what might be the terminator
+			text += i;
+			return '?';
+		}
+		codepoint = (codepoint << 6) | (s[i] & 0x3f);
+	}
+
+	text += length;
+	return codepoint;
+}
+
+void Font::InitAtlas(GlyphAtlas& atlas, uint32_t size, bool cpuOnly)
+{
+	atlas.Size = size;
+
+	std::vector<uint32_t> clear(size * size, 0x00ffffff);
+	atlas.Page = new Texture(size, size, 4, (unsigned char*)clear.data(), 1, cpuOnly);
+}
+
+bool Font::Allocate(GlyphAtlas& atlas, uint32_t width, uint32_t height, uint32_t& x, uint32_t& y)
+{
+	width += GlyphPadding;
+	height += GlyphPadding;
+
+	if (width > atlas.Size || height > atlas.Size)
+		return false;
+
+	if (atlas.ShelfX + width > atlas.Size)
+	{
+		atlas.ShelfX = 0;
+		atlas.ShelfY += atlas.ShelfHeight;
+		atlas.ShelfHeight = 0;
+	}
+
+	if (atlas.ShelfY + height > atlas.Size)
+		return false;
+
+	x = atlas.ShelfX;
+	y = atlas.ShelfY;
+
+	atlas.ShelfX += width;
+	if (height > atlas.ShelfHeight)
+		atlas.ShelfHeight = height;
+
+	return true;
+}
+
+void Font::ResetAtlas(GlyphAtlas& atlas)
+{
+	atlas.Glyphs.clear();
+
+	atlas.ShelfX = 0;
+	atlas.ShelfY = 0;
+	atlas.ShelfHeight = 0;
+
+	std::vector<uint32_t> clear(atlas.Size * atlas.Size, 0x00ffffff);
+	atlas.Page->SetData(0, 0, atlas.Size, atlas.Size, (unsigned char*)clear.data());
+
+	atlas.ResetPending = false;
+	atlas.Resets++;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+class Texture;
+
+struct Glyph
+{
+	// atlas rect, V0 is the top row of the glyph
+	float U0, V0, U1, V1;
+
+	// in pixels at the size the glyph was rasterized for, Y goes down from the baseline (stb_truetype convention)
+	float OffsetX, OffsetY;
+	float Width, Height;
+	float Advance;
+
+	bool Visible; // false for spaces and for glyphs that didn't fit in the atlas
+};
+
+// one RGBA page, white with the coverage (or distance) in alpha
+struct GlyphAtlas
+{
+	Texture* Page = nullptr;
+	uint32_t Size = 0;
+
+	// shelf packer
+	uint32_t ShelfX = 0;
+	uint32_t ShelfY = 0;
+	uint32_t ShelfHeight = 0;
+
+	bool ResetPending = false;
+	uint32_t Resets = 0;
+
+	std::unordered_map<uint64_t, Glyph> Glyphs;
+
+	// texels covered by the shelves so far
+	inline uint32_t GetUsedBytes() const { return (ShelfY + ShelfHeight) * Size * 4; }
+};
+
+// Glyphs are rasterized on demand (imstb_truetype) into atlas pages that go through the quad batch.
+// Bitmap glyphs are cached per pixel size in one shared page and use the alpha tested permutation.
+// SDF glyphs are generated once at SdfPixelSize into their own page and scale to any size
+// with the SDF permutation, which also does outline and shadow.
+class Font
+{
+public:
+	~Font();
+
+	// cpuOnly makes the atlas pages CPU only textures, for a software renderer (see Renderer2D::UsesCpuTextures)
+	static Font* FromFile(const char* path, uint32_t atlasSize = 1024, bool cpuOnly = false);
+
+	const Glyph& GetGlyph(uint32_t codepoint, uint32_t pixelSize);
+	const Glyph& GetSdfGlyph(uint32_t codepoint);
+
+	// generates the SDF glyphs for [first, last] on threadCount threads, then packs them
+	void PrewarmSdf(uint32_t first, uint32_t last, uint32_t threadCount);
+
+	float GetKerning(uint32_t first, uint32_t second, uint32_t pixelSize) const;
+	float GetLineHeight(uint32_t pixelSize) const;
+	float GetAscent(uint32_t pixelSize) const;
+
+	// applies a reset requested by a full atlas, call it between frames so no batched quad points at a stale rect
+	void NewFrame();
+
+	inline Texture* GetAtlas() const { return m_Bitmap.Page; }
+	inline Texture* GetSdfAtlas() const { return m_Sdf.Page; }
+	inline const GlyphAtlas& GetBitmapAtlasInfo() const { return m_Bitmap; }
+	inline const GlyphAtlas& GetSdfAtlasInfo() const { return m_Sdf; }
+
+	// returns the codepoint at text and moves text past it, invalid sequences come back as '?'
+	static uint32_t DecodeUTF8(const char*& text);
+
+public:
+	static const uint32_t SdfPixelSize = 48;
+	static const uint32_t SdfPadding = 8;      // texels of distance around every glyph, room for outline and shadow
+	static const uint8_t SdfOnEdgeValue = 128; // alpha on the glyph outline
+	static constexpr float SdfPixelDistScale = 16.0f; // alpha change per texel away from the edge
+
+private:
+	struct SdfBitmap
+	{
+		uint32_t Codepoint;
+		unsigned char* Data;
+		int32_t Width, Height, OffsetX, OffsetY;
+	};
+
+	Font(std::vector<unsigned char>&& data, uint32_t atlasSize, bool cpuOnly);
+
+	SdfBitmap CreateSdfBitmap(uint32_t codepoint) const;
+	const Glyph& StoreSdfGlyph(const SdfBitmap& bitmap);
+
+	bool Store(GlyphAtlas& atlas, uint64_t key, Glyph& glyph, const unsigned char* alpha, uint32_t width, uint32_t height);
+
+	static void InitAtlas(GlyphAtlas& atlas, uint32_t size, bool cpuOnly);
+	static bool Allocate(GlyphAtlas& atlas, uint32_t width, uint32_t height, uint32_t& x, uint32_t& y);
+	static void ResetAtlas(GlyphAtlas& atlas);
+
+private:
+	std::vector<unsigned char> m_Data;
+	void* m_Info; // stbtt_fontinfo, kept out of the header
+
+	GlyphAtlas m_Bitmap;
+	GlyphAtlas m_Sdf;
+
+	Glyph m_Missing;
+};
@@ -0,0 +1,137 @@
+#include "FrameArena.h"
+
+#include <Windows.h>
+
+#include <new>
+
+FrameArena::FrameArena(uint64_t capacity)
+	: m_Offset(0), m_Used(0), m_HighWater(0), m_OverflowOffset(0)
+{
+	m_Block = AllocateBlock(capacity);
+	m_Capacity = m_Block.Size;
+	m_LargePages = m_Block.LargePages;
+}
+
+FrameArena::~FrameArena()
+{
+	for (const Block& block : m_Overflow)
+		FreeBlock(block);
+
+	FreeBlock(m_Block);
+}
+
+bool FrameArena::LargePagesAvailable()
+{
+	// large pages need SeLockMemoryPrivilege, which has to be granted to the user and then enabled on the process token
+	static const bool available = []()
+	{
+		if (GetLargePageMinimum() == 0)
+			return false;
+
+		HANDLE token;
+		if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token))
+			return false;
+
+		TOKEN_PRIVILEGES privileges = {};
+		privileges.PrivilegeCount = 1;
+		privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+
+		bool enabled = false;
+		if (LookupPrivilegeValueA(nullptr, "SeLockMemoryPrivilege", &privileges.Privileges[0].Luid))
+		{
+			// succeeds even when the privilege isn't held, the last error tells
+			enabled = AdjustTokenPrivileges(token, FALSE, &privileges, 0, nullptr, nullptr) && GetLastError() == ERROR_SUCCESS;
+		}
+
+		CloseHandle(token);
+		return enabled;
+	}();
+
+	return available;
+}
+
+FrameArena::Block FrameArena::AllocateBlock(uint64_t size)
+{
+	if (size == 0)
+		size = 1;
+
+	if (LargePagesAvailable())
+	{
+		uint64_t pageSize = GetLargePageMinimum();
+		uint64_t rounded = (size + pageSize - 1) & ~(pageSize - 1);
+
+		// can still fail when physical memory is too fragmented for contiguous large pages
+		void* memory = VirtualAlloc(nullptr, rounded, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+		if (memory)
+			return { (uint8_t*)memory, rounded, true };
+	}
+
+	// allocation granularity, anything smaller would waste the rest of the reservation anyway
+	uint64_t rounded = (size + 0xffff) & ~0xffffull;
+
+	void* memory = VirtualAlloc(nullptr, rounded, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	if (!memory)
+		throw std::bad_alloc();
+
+	return { (uint8_t*)memory, rounded, false };
+}
+
+void FrameArena::FreeBlock(const Block& block)
+{
+	VirtualFree(block.Memory, 0, MEM_RELEASE);
+}
+
+void* FrameArena::Allocate(uint64_t size, uint64_t alignment)
+{
+	uint64_t aligned = (m_Offset + alignment - 1) & ~(alignment - 1);
+
+	uint8_t* result;
+	if (m_Overflow.empty() && aligned + size <= m_Capacity)
+	{
+		result = m_Block.Memory + aligned;
+		m_Used += aligned + size - m_Offset;
+		m_Offset = aligned + size;
+	}
+	else
+	{
+		aligned = (m_OverflowOffset + alignment - 1) & ~(alignment - 1);
+
+		if (m_Overflow.empty() || aligned + size > m_Overflow.back().Size)
+		{
+			// at least as big as the main block, so a frame that keeps growing needs few of them
+			uint64_t blockSize = size + alignment > m_Capacity ? size + alignment : m_Capacity;
+			m_Overflow.push_back(AllocateBlock(blockSize));
+			m_OverflowOffset = 0;
+			aligned = 0;
+		}
+
+		result = m_Overflow.back().Memory + aligned;
+		m_Used += aligned + size - m_OverflowOffset;
+		m_OverflowOffset = aligned + size;
+	}
+
+	if (m_Used > m_HighWater)
+		m_HighWater = m_Used;
+
+	return result;
+}
+
+void FrameArena::Reset()
+{
+	if (!m_Overflow.empty())
+	{
+		for (const Block& block : m_Overflow)
+			FreeBlock(block);
+		m_Overflow.clear();
+
+		// a quarter on top so a scene that grows slowly doesn't land here every frame
+		FreeBlock(m_Block);
+		m_Block = AllocateBlock(m_HighWater + m_HighWater / 4);
+		m_Capacity = m_Block.Size;
+		m_LargePages = m_Block.LargePages;
+	}
+
+	m_Offset = 0;
+	m_OverflowOffset = 0;
+	m_Used = 0;
+}
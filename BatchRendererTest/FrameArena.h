@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+// Bump allocator for data that only lives for one frame: Allocate moves a pointer forward and Reset drops everything at once.
+// The block comes straight from VirtualAlloc, backed by large pages when the process is allowed to lock them.
+// Running out never fails, the extra goes into overflow blocks and the next Reset replaces everything with one block
+// big enough for the high water mark, so after a couple of frames a steady scene doesn't allocate at all.
+// Nothing gets destructed, only put trivially destructible things in here.
+class FrameArena
+{
+public:
+	FrameArena(uint64_t capacity);
+	~FrameArena();
+
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	void* Allocate(uint64_t size, uint64_t alignment = 16);
+	void Reset();
+
+	template<typename T>
+	inline T* Allocate(uint64_t count)
+	{
+		return (T*)Allocate(sizeof(T) * count, alignof(T) > 16 ? alignof(T) : 16);
+	}
+
+	inline uint64_t GetUsed() const { return m_Used; } // since the last Reset, overflow blocks included
+	inline uint64_t GetHighWater() const { return m_HighWater; }
+	inline uint64_t GetCapacity() const { return m_Capacity; } // of the main block
+	inline uint32_t GetOverflowCount() const { return (uint32_t)m_Overflow.size(); }
+	inline bool IsLargePages() const { return m_LargePages; }
+
+	// enables the lock pages privilege the first time it's called, false when the user doesn't hold it
+	static bool LargePagesAvailable();
+
+private:
+	struct Block
+	{
+		uint8_t* Memory;
+		uint64_t Size;
+		bool LargePages;
+	};
+
+	static Block AllocateBlock(uint64_t size);
+	static void FreeBlock(const Block& block);
+
+private:
+	Block m_Block;
+	uint64_t m_Capacity;
+	uint64_t m_Offset;
+	uint64_t m_Used;
+	uint64_t m_HighWater;
+	bool m_LargePages;
+
+	std::vector<Block> m_Overflow; // only between running out and the next Reset
+	uint64_t m_OverflowOffset;
+};
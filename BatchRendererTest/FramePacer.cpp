@@ -0,0 +1,154 @@
+#include "FramePacer.h"
+
+#include "GL/glew.h"
+
+#include "RenderThread.h"
+
+#include <thread>
+#include <math.h>
+
+// sleep is only as fine as the OS timer (15.6 ms on windows unless something raised it), the rest is spun
+static const std::chrono::milliseconds SpinMargin(2);
+
+FramePacer::FramePacer()
+	: m_MaxFramesInFlight(2), m_TargetFrameRate(0.0f), m_FenceWaitMs(0.0f), m_CpuAheadMs(0.0f), m_FramesInFlight(0), m_SleepMs(0.0f),
+	m_Started(false), m_IntervalIndex(0), m_IntervalsRecorded(0), m_IntervalMs(0.0f), m_JitterMs(0.0f), m_MaxDeviationMs(0.0f)
+{
+	for (uint32_t i = 0; i < IntervalCount; i++)
+		m_Intervals[i] = 0.0f;
+}
+
+// the queued frames that use the fences have to be done by now (the render thread is gone)
+FramePacer::~FramePacer()
+{
+	for (Fence& fence : m_Fences)
+		glDeleteSync((GLsync)fence.Sync);
+}
+
+void FramePacer::BeginFrame()
+{
+	Pace();
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (m_Started)
+	{
+		std::chrono::duration<float, std::milli> interval = now - m_LastBegin;
+		RecordInterval(interval.count());
+	}
+	m_LastBegin = now;
+	m_Started = true;
+
+	uint32_t maxFramesInFlight = m_MaxFramesInFlight;
+	RenderThread::Run([this, maxFramesInFlight]()
+	{
+		WaitForFences(maxFramesInFlight);
+	});
+}
+
+void FramePacer::EndFrame()
+{
+	RenderThread::Run([this]()
+	{
+		InsertFence();
+	});
+}
+
+void FramePacer::WaitForFences(uint32_t maxFramesInFlight)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	while (!m_Fences.empty())
+	{
+		Fence& fence = m_Fences.front();
+
+		// over the limit we wait for the oldest, under it we only drop the ones that are already done
+		bool mustWait = maxFramesInFlight > 0 && m_Fences.size() >= maxFramesInFlight;
+		GLenum result = glClientWaitSync((GLsync)fence.Sync, GL_SYNC_FLUSH_COMMANDS_BIT, mustWait ? 1000000000ull : 0);
+		if (result == GL_TIMEOUT_EXPIRED && mustWait)
+			continue;
+		if (result == GL_TIMEOUT_EXPIRED)
+			break;
+
+		// signaled, or the wait failed and there's nothing better to do than let it go
+		glDeleteSync((GLsync)fence.Sync);
+		m_Fences.erase(m_Fences.begin());
+	}
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	std::chrono::duration<float, std::milli> waitTime = now - start;
+	m_FenceWaitMs = waitTime.count();
+
+	m_FramesInFlight = (uint32_t)m_Fences.size();
+	if (m_Fences.empty())
+	{
+		m_CpuAheadMs = 0.0f;
+	}
+	else
+	{
+		std::chrono::duration<float, std::milli> ahead = now - m_Fences.front().Submitted;
+		m_CpuAheadMs = ahead.count();
+	}
+}
+
+void FramePacer::InsertFence()
+{
+	Fence fence;
+	fence.Sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	fence.Submitted = std::chrono::steady_clock::now();
+	m_Fences.push_back(fence);
+}
+
+void FramePacer::Pace()
+{
+	if (m_TargetFrameRate <= 0.0f)
+	{
+		m_SleepMs = 0.0f;
+		m_Deadline = std::chrono::steady_clock::time_point();
+		return;
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::duration interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / m_TargetFrameRate));
+
+	// a frame or more late (or just switched on): start over from now instead of rushing to catch up
+	if (m_Deadline == std::chrono::steady_clock::time_point() || start - m_Deadline > interval)
+		m_Deadline = start;
+
+	if (m_Deadline - start > SpinMargin)
+		std::this_thread::sleep_for(m_Deadline - start - SpinMargin);
+
+	while (std::chrono::steady_clock::now() < m_Deadline)
+		std::this_thread::yield();
+
+	// the next one is relative to the deadline and not to when we woke up, so oversleeping doesn't add up
+	m_Deadline += interval;
+
+	std::chrono::duration<float, std::milli> sleepTime = std::chrono::steady_clock::now() - start;
+	m_SleepMs = sleepTime.count();
+}
+
+void FramePacer::RecordInterval(float intervalMs)
+{
+	m_Intervals[m_IntervalIndex] = intervalMs;
+	m_IntervalIndex = (m_IntervalIndex + 1) % IntervalCount;
+	if (m_IntervalsRecorded < IntervalCount)
+		m_IntervalsRecorded++;
+
+	float sum = 0.0f;
+	for (uint32_t i = 0; i < m_IntervalsRecorded; i++)
+		sum += m_Intervals[i];
+	float mean = sum / m_IntervalsRecorded;
+
+	float variance = 0.0f;
+	float maxDeviation = 0.0f;
+	for (uint32_t i = 0; i < m_IntervalsRecorded; i++)
+	{
+		float deviation = fabsf(m_Intervals[i] - mean);
+		variance += deviation * deviation;
+		maxDeviation = deviation > maxDeviation ? deviation : maxDeviation;
+	}
+
+	m_IntervalMs = mean;
+	m_JitterMs = sqrtf(variance / m_IntervalsRecorded);
+	m_MaxDeviationMs = maxDeviation;
+}
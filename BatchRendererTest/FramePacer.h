@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+#include <atomic>
+#include <chrono>
+
+// Keeps the CPU from running more than a few frames ahead of the GPU and optionally paces frames to a fixed rate.
+// EndFrame drops a fence after the swap, BeginFrame makes whoever owns the context wait at the head of the next frame
+// until no more than MaxFramesInFlight - 1 frames are still on the GPU. With 1 the CPU only starts a frame once the last one
+// is done, the lowest latency there is. The pacer sleeps on the game thread before the frame starts (and before input
+// is polled), so the latency it adds is the time spent waiting, not a full queued frame.
+class FramePacer
+{
+public:
+	FramePacer();
+	~FramePacer();
+
+	FramePacer(const FramePacer&) = delete;
+	FramePacer& operator=(const FramePacer&) = delete;
+
+	// 0 leaves it to the driver
+	inline void SetMaxFramesInFlight(uint32_t count) { m_MaxFramesInFlight = count; }
+	inline uint32_t GetMaxFramesInFlight() const { return m_MaxFramesInFlight; }
+
+	// 0 = off, runs as fast as it goes (or at vsync)
+	inline void SetTargetFrameRate(float framesPerSecond) { m_TargetFrameRate = framesPerSecond > 0.0f ? framesPerSecond : 0.0f; }
+	inline float GetTargetFrameRate() const { return m_TargetFrameRate; }
+
+	// game thread, first thing in the frame
+	void BeginFrame();
+	// game thread, after the swap was recorded
+	void EndFrame();
+
+	inline float GetFenceWaitMs() const { return m_FenceWaitMs; } // at the head of the last frame, where the context lives
+	inline float GetCpuAheadMs() const { return m_CpuAheadMs; } // how long the oldest frame still in flight has been on the GPU
+	inline uint32_t GetFramesInFlight() const { return m_FramesInFlight; } // after the wait, without the frame that's starting
+	inline float GetSleepMs() const { return m_SleepMs; }
+
+	// BeginFrame to BeginFrame over the last IntervalCount frames
+	inline float GetIntervalMs() const { return m_IntervalMs; }
+	inline float GetJitterMs() const { return m_JitterMs; } // standard deviation
+	inline float GetMaxDeviationMs() const { return m_MaxDeviationMs; }
+
+private:
+	// only touched where the context lives
+	void WaitForFences(uint32_t maxFramesInFlight);
+	void InsertFence();
+
+	void Pace();
+	void RecordInterval(float intervalMs);
+
+private:
+	static const uint32_t IntervalCount = 120;
+
+	struct Fence
+	{
+		void* Sync; // GLsync
+		std::chrono::steady_clock::time_point Submitted;
+	};
+
+	uint32_t m_MaxFramesInFlight;
+	float m_TargetFrameRate;
+
+	std::vector<Fence> m_Fences; // oldest first, a handful at most (a deque allocates as it goes)
+
+	std::atomic<float> m_FenceWaitMs;
+	std::atomic<float> m_CpuAheadMs;
+	std::atomic<uint32_t> m_FramesInFlight;
+	float m_SleepMs;
+
+	bool m_Started;
+	std::chrono::steady_clock::time_point m_Deadline;
+	std::chrono::steady_clock::time_point m_LastBegin;
+
+	float m_Intervals[IntervalCount];
+	uint32_t m_IntervalIndex;
+	uint32_t m_IntervalsRecorded;
+	float m_IntervalMs;
+	float m_JitterMs;
+	float m_MaxDeviationMs;
+};
@@ -0,0 +1,168 @@
+#include "GoldenImage.h"
+
+#include "stb/stb_image.h"
+
+#include <fstream>
+#include <math.h>
+
+// largest possible YIQ delta (black vs white), used to bring deltas to 0..1
+static const float MaxYIQDelta = 35215.0f;
+
+static inline void ToYIQ(uint32_t pixel, float& y, float& i, float& q)
+{
+	// blend alpha over white so transparent pixels compare the way they would look
+	float a = ((pixel >> 24) & 0xff) / 255.0f;
+	float r = 255.0f + (((pixel >> 0) & 0xff) - 255.0f) * a;
+	float g = 255.0f + (((pixel >> 8) & 0xff) - 255.0f) * a;
+	float b = 255.0f + (((pixel >> 16) & 0xff) - 255.0f) * a;
+
+	y = r * 0.29889531f + g * 0.58662247f + b * 0.11448223f;
+	i = r * 0.59597799f - g * 0.27417610f - b * 0.32180189f;
+	q = r * 0.21147017f - g * 0.52261711f + b * 0.31114694f;
+}
+
+static inline float ColorDelta(uint32_t a, uint32_t b)
+{
+	if (a == b)
+		return 0.0f;
+
+	float y1, i1, q1, y2, i2, q2;
+	ToYIQ(a, y1, i1, q1);
+	ToYIQ(b, y2, i2, q2);
+
+	float dy = y1 - y2;
+	float di = i1 - i2;
+	float dq = q1 - q2;
+
+	return (0.5053f * dy * dy + 0.299f * di * di + 0.1957f * dq * dq) / MaxYIQDelta;
+}
+
+Image MakeImage(const uint32_t* pixels, uint32_t width, uint32_t height, uint32_t stride)
+{
+	Image image;
+	image.Width = width;
+	image.Height = height;
+	image.Pixels.resize(width * height);
+
+	for (uint32_t y = 0; y < height; y++)
+	{
+		for (uint32_t x = 0; x < width; x++)
+		{
+			image.Pixels[y * width + x] = pixels[y * stride + x];
+		}
+	}
+
+	return image;
+}
+
+bool WriteImageTGA(const char* path, const Image& image)
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	// uncompressed true color, 32 bpp, bottom left origin (so rows go out in the order we store them)
+	uint8_t header[18] = {};
+	header[2] = 2;
+	header[12] = image.Width & 0xff;
+	header[13] = (image.Width >> 8) & 0xff;
+	header[14] = image.Height & 0xff;
+	header[15] = (image.Height >> 8) & 0xff;
+	header[16] = 32;
+	header[17] = 8;
+
+	file.write((const char*)header, sizeof(header));
+
+	std::vector<uint8_t> row(image.Width * 4);
+	for (uint32_t y = 0; y < image.Height; y++)
+	{
+		for (uint32_t x = 0; x < image.Width; x++)
+		{
+			uint32_t pixel = image.Pixels[y * image.Width + x];
+			row[x * 4 + 0] = (pixel >> 16) & 0xff;
+			row[x * 4 + 1] = (pixel >> 8) & 0xff;
+			row[x * 4 + 2] = (pixel >> 0) & 0xff;
+			row[x * 4 + 3] = (pixel >> 24) & 0xff;
+		}
+		file.write((const char*)row.data(), row.size());
+	}
+
+	file.close();
+	return true;
+}
+
+bool ReadImage(const char* path, Image& image)
+{
+	int width, height, channels;
+	stbi_uc* data = stbi_load(path, &width, &height, &channels, 4);
+	if (!data)
+		return false;
+
+	image.Width = width;
+	image.Height = height;
+	image.Pixels.resize(width * height);
+
+	// stb gives us the top row first
+	for (int y = 0; y < height; y++)
+	{
+		const stbi_uc* row = data + (height - 1 - y) * width * 4;
+		for (int x = 0; x < width; x++)
+		{
+			const stbi_uc* texel = row + x * 4;
+			image.Pixels[y * width + x] = texel[0] | (texel[1] << 8) | (texel[2] << 16) | ((uint32_t)texel[3] << 24);
+		}
+	}
+
+	stbi_image_free(data);
+	return true;
+}
+
+ImageDiff CompareImages(const Image& reference, const Image& actual, float threshold)
+{
+	ImageDiff diff;
+
+	if (reference.Width != actual.Width || reference.Height != actual.Height)
+	{
+		diff.SizeMismatch = true;
+		return diff;
+	}
+
+	uint32_t count = reference.Width * reference.Height;
+
+	diff.Heatmap.Width = reference.Width;
+	diff.Heatmap.Height = reference.Height;
+	diff.Heatmap.Pixels.resize(count);
+
+	double totalDelta = 0.0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		float delta = ColorDelta(reference.Pixels[i], actual.Pixels[i]);
+
+		totalDelta += delta;
+		if (delta > diff.MaxDelta)
+			diff.MaxDelta = delta;
+
+		if (delta > threshold)
+		{
+			diff.DifferentPixels++;
+
+			uint32_t red = 128 + (uint32_t)(fminf(delta / threshold, 4.0f) * 31.75f);
+			diff.Heatmap.Pixels[i] = red | 0xff000000;
+		}
+		else
+		{
+			float y, iq, q;
+			ToYIQ(reference.Pixels[i], y, iq, q);
+
+			// faded gray so the red stands out
+			uint32_t gray = 192 + (uint32_t)(y * 0.25f);
+			if (gray > 255)
+				gray = 255;
+			diff.Heatmap.Pixels[i] = gray | (gray << 8) | (gray << 16) | 0xff000000;
+		}
+	}
+
+	diff.MeanDelta = count > 0 ? (float)(totalDelta / count) : 0.0f;
+
+	return diff;
+}
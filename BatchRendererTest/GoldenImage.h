@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+// RGBA8 (R in the low byte), first row at the bottom like GL and SoftwareRasterizer
+struct Image
+{
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	std::vector<uint32_t> Pixels;
+};
+
+struct ImageDiff
+{
+	uint32_t DifferentPixels = 0;
+	float MaxDelta = 0.0f;   // perceptual delta, 0 = identical, 1 = black vs white
+	float MeanDelta = 0.0f;
+	bool SizeMismatch = false;
+
+	Image Heatmap;
+};
+
+// stride is in pixels, it lets us copy straight out of a padded color buffer
+Image MakeImage(const uint32_t* pixels, uint32_t width, uint32_t height, uint32_t stride);
+
+bool WriteImageTGA(const char* path, const Image& image);
+bool ReadImage(const char* path, Image& image);
+
+// YIQ based color distance (same idea as pixelmatch), a pixel counts as different when its
+// delta is above threshold. The heatmap is the reference in gray with the differences in red.
+ImageDiff CompareImages(const Image& reference, const Image& actual, float threshold);
@@ -0,0 +1,296 @@
+#include "GpuQuadCuller.h"
+
+#include "GL/glew.h"
+
+#include "Buffer.h"
+#include "Shader.h"
+#include "Texture.h"
+#include "GpuQuery.h"
+#include "RenderThread.h"
+
+#include <vector>
+#include <string.h>
+#include <math.h>
+
+// has to match local_size_x in res/gpu_cull.txt
+static const uint32_t CullGroupSize = 64;
+
+// the layout of the command buffer, filled in by the compute shader
+struct DrawElementsIndirectCommand
+{
+	uint32_t Count;
+	uint32_t InstanceCount;
+	uint32_t FirstIndex;
+	int32_t BaseVertex;
+	uint32_t BaseInstance;
+};
+
+// rounded up to a power of two, so uploads that go up and down around the same size stop reallocating after the first few
+template<typename T>
+static void ReserveStaging(std::vector<T>& staging, size_t count)
+{
+	size_t capacity = 64;
+	while (capacity < count)
+		capacity *= 2;
+	staging.reserve(capacity);
+}
+
+GpuQuad MakeGpuQuad(const Transform& transform, Vec3 color, uint32_t textureSlot, Vec4 textureRect)
+{
+	glm::mat4 rotation = GetRotation(transform.Rotation);
+	glm::vec3 halfX = glm::vec3(rotation[0]) * (transform.Scale.X * 0.5f);
+	glm::vec3 halfY = glm::vec3(rotation[1]) * (transform.Scale.Y * 0.5f);
+
+	GpuQuad quad;
+	quad.CenterTexture = { transform.Location.X, transform.Location.Y, transform.Location.Z, (float)textureSlot };
+	quad.HalfX = { halfX.x, halfX.y, halfX.z, 0.0f };
+	quad.HalfY = { halfY.x, halfY.y, halfY.z, 0.0f };
+	quad.Color = { color.X, color.Y, color.Z, 1.0f };
+	quad.TextureRect = textureRect;
+	return quad;
+}
+
+GpuQuadCuller::GpuQuadCuller(uint32_t capacity)
+	: m_Capacity(capacity > 0 ? capacity : 1), m_QuadCount(0), m_QuadBuffer(0), m_VisibleBuffer(0), m_CommandBuffer(0), m_VertexArray(0), m_TextureCount(0)
+{
+	for (uint32_t i = 0; i < MAX_TEXTURE_SLOTS; i++)
+		m_Textures[i] = nullptr;
+
+	// same index pattern as the quad batch, the vertex shader turns index i * 4 + corner into a visible quad's corner
+	std::vector<uint32_t> indices(m_Capacity * 6);
+	for (uint32_t i = 0; i < m_Capacity; i++)
+	{
+		indices[i * 6 + 0] = i * 4 + 0;
+		indices[i * 6 + 1] = i * 4 + 1;
+		indices[i * 6 + 2] = i * 4 + 2;
+		indices[i * 6 + 3] = i * 4 + 2;
+		indices[i * 6 + 4] = i * 4 + 3;
+		indices[i * 6 + 5] = i * 4 + 0;
+	}
+
+	RenderThread::RunSync([this, &indices]()
+	{
+		m_CullProgram.reset(Shader::FromComputeFile("res/gpu_cull.txt"));
+
+		std::string defines = GetPermutationDefines(ShaderFeature_Textured | ShaderFeature_Tinted);
+		std::string vertexSrc = InjectDefines(Shader::ReadSource("res/gpu_vertex.txt"), defines);
+		std::string fragmentSrc = InjectDefines(Shader::ReadSource("res/fragment.txt"), defines);
+		m_DrawProgram.reset(new Shader(vertexSrc.c_str(), fragmentSrc.c_str()));
+
+		int32_t samplers[MAX_TEXTURE_SLOTS];
+		for (int32_t i = 0; i < MAX_TEXTURE_SLOTS; i++)
+			samplers[i] = i;
+		m_DrawProgram->Bind();
+		m_DrawProgram->SetUniform1iv("u_TexSlots", MAX_TEXTURE_SLOTS, samplers);
+		m_DrawProgram->UnBind();
+
+		glCreateBuffers(1, &m_QuadBuffer);
+		glNamedBufferStorage(m_QuadBuffer, sizeof(GpuQuad) * m_Capacity, nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+		glCreateBuffers(1, &m_VisibleBuffer);
+		glNamedBufferStorage(m_VisibleBuffer, sizeof(uint32_t) * m_Capacity, nullptr, 0);
+
+		glCreateBuffers(1, &m_CommandBuffer);
+		glNamedBufferStorage(m_CommandBuffer, sizeof(DrawElementsIndirectCommand), nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+		m_Indices.reset(new IndexBuffer(indices.data(), sizeof(uint32_t) * indices.size()));
+
+		// no attributes, everything is pulled from the storage buffers
+		glCreateVertexArrays(1, &m_VertexArray);
+		glVertexArrayElementBuffer(m_VertexArray, m_Indices->GetID());
+
+		m_Primitives.reset(new GpuQuery(GL_PRIMITIVES_GENERATED));
+	});
+}
+
+GpuQuadCuller::~GpuQuadCuller()
+{
+	// after any Draw that's still queued
+	Shader* cullProgram = m_CullProgram.release();
+	Shader* drawProgram = m_DrawProgram.release();
+	IndexBuffer* indices = m_Indices.release();
+	GpuQuery* primitives = m_Primitives.release();
+	uint32_t buffers[3] = { m_QuadBuffer, m_VisibleBuffer, m_CommandBuffer };
+	uint32_t vertexArray = m_VertexArray;
+	// queued uploads still read from these
+	std::vector<std::unique_ptr<GpuQuadStaging>>* staging = new std::vector<std::unique_ptr<GpuQuadStaging>>(std::move(m_Staging));
+
+	RenderThread::Run([cullProgram, drawProgram, indices, primitives, staging, buffers, vertexArray]()
+	{
+		delete cullProgram;
+		delete drawProgram;
+		delete indices;
+		delete primitives;
+		delete staging;
+		glDeleteBuffers(3, buffers);
+		glDeleteVertexArrays(1, &vertexArray);
+	});
+}
+
+bool GpuQuadCuller::IsSupported()
+{
+	return GLEW_VERSION_4_3 || (GLEW_ARB_compute_shader && GLEW_ARB_shader_storage_buffer_object);
+}
+
+uint32_t GpuQuadCuller::AddTexture(Texture* texture)
+{
+	for (uint32_t i = 0; i < m_TextureCount; i++)
+	{
+		if (m_Textures[i] == texture)
+			return i;
+	}
+
+	if (m_TextureCount >= MAX_TEXTURE_SLOTS)
+		return InvalidTextureSlot;
+
+	m_Textures[m_TextureCount] = texture;
+	return m_TextureCount++;
+}
+
+void GpuQuadCuller::SetQuads(const GpuQuad* quads, uint32_t first, uint32_t count)
+{
+	if (count == 0)
+		return;
+
+	uint32_t buffer = m_QuadBuffer;
+	size_t offset = sizeof(GpuQuad) * first;
+	size_t size = sizeof(GpuQuad) * count;
+
+	if (RenderThread::IsRecording())
+	{
+		// the caller's records may have changed by the time the render thread gets to it
+		GpuQuadStaging* staging = AcquireStaging();
+		ReserveStaging(staging->Quads, count);
+		staging->Quads.assign(quads, quads + count);
+		RenderThread::Run([buffer, offset, size, staging]()
+		{
+			glNamedBufferSubData(buffer, offset, size, staging->Quads.data());
+			staging->InFlight = false;
+		});
+	}
+	else
+	{
+		glNamedBufferSubData(buffer, offset, size, quads);
+	}
+}
+
+void GpuQuadCuller::SetQuadRanges(const GpuQuad* quads, const GpuQuadRange* ranges, uint32_t rangeCount)
+{
+	if (rangeCount == 0)
+		return;
+
+	uint32_t buffer = m_QuadBuffer;
+
+	if (RenderThread::IsRecording())
+	{
+		// packed back to back, the render thread walks the ranges to find each one's records
+		uint32_t total = 0;
+		for (uint32_t i = 0; i < rangeCount; i++)
+			total += ranges[i].Count;
+
+		GpuQuadStaging* staging = AcquireStaging();
+		ReserveStaging(staging->Quads, total);
+		ReserveStaging(staging->Ranges, rangeCount);
+		staging->Quads.resize(total);
+		staging->Ranges.assign(ranges, ranges + rangeCount);
+
+		GpuQuad* write = staging->Quads.data();
+		for (uint32_t i = 0; i < rangeCount; i++)
+		{
+			memcpy(write, quads + ranges[i].First, sizeof(GpuQuad) * ranges[i].Count);
+			write += ranges[i].Count;
+		}
+
+		RenderThread::Run([buffer, staging]()
+		{
+			const GpuQuad* read = staging->Quads.data();
+			for (const GpuQuadRange& range : staging->Ranges)
+			{
+				glNamedBufferSubData(buffer, sizeof(GpuQuad) * range.First, sizeof(GpuQuad) * range.Count, read);
+				read += range.Count;
+			}
+			staging->InFlight = false;
+		});
+	}
+	else
+	{
+		for (uint32_t i = 0; i < rangeCount; i++)
+			glNamedBufferSubData(buffer, sizeof(GpuQuad) * ranges[i].First, sizeof(GpuQuad) * ranges[i].Count, quads + ranges[i].First);
+	}
+}
+
+GpuQuadStaging* GpuQuadCuller::AcquireStaging()
+{
+	for (std::unique_ptr<GpuQuadStaging>& staging : m_Staging)
+	{
+		if (!staging->InFlight.load())
+		{
+			staging->InFlight = true;
+			return staging.get();
+		}
+	}
+
+	m_Staging.emplace_back(new GpuQuadStaging());
+	m_Staging.back()->InFlight = true;
+	return m_Staging.back().get();
+}
+
+void GpuQuadCuller::SetQuadCount(uint32_t count)
+{
+	m_QuadCount = count < m_Capacity ? count : m_Capacity;
+}
+
+uint32_t GpuQuadCuller::GetVisibleCount() const
+{
+	return m_Primitives ? (uint32_t)(m_Primitives->GetResult() / 2) : 0;
+}
+
+void GpuQuadCuller::Draw(const glm::mat4& view, const glm::mat4& proj, uint32_t quadCount)
+{
+	// Gribb/Hartmann like SpatialIndex, normalized so the shader can compare against a radius
+	glm::mat4 viewProj = proj * view;
+	glm::vec4 rows[4];
+	for (uint32_t i = 0; i < 4; i++)
+		rows[i] = glm::vec4(viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i]);
+
+	glm::vec4 planes[6] =
+	{
+		rows[3] + rows[0], rows[3] - rows[0],
+		rows[3] + rows[1], rows[3] - rows[1],
+		rows[3] + rows[2], rows[3] - rows[2]
+	};
+	for (glm::vec4& plane : planes)
+		plane /= glm::length(glm::vec3(plane));
+
+	DrawElementsIndirectCommand reset = { 0, 1, 0, 0, 0 };
+	glNamedBufferSubData(m_CommandBuffer, 0, sizeof(reset), &reset);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_QuadBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_VisibleBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_CommandBuffer);
+
+	m_CullProgram->Bind();
+	m_CullProgram->SetUniform4fv("u_Planes", 6, (const float*)planes);
+	m_CullProgram->SetUniform1ui("u_QuadCount", quadCount);
+	glDispatchCompute((quadCount + CullGroupSize - 1) / CullGroupSize, 1, 1);
+
+	// the draw reads the visible list as storage and the count as its command
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+	m_DrawProgram->Bind();
+	m_DrawProgram->SetUniformMat4("u_View", 1, (float*)&view[0][0], false);
+	m_DrawProgram->SetUniformMat4("u_Proj", 1, (float*)&proj[0][0], false);
+
+	for (uint32_t i = 0; i < m_TextureCount; i++)
+		m_Textures[i]->Bind(i);
+
+	glBindVertexArray(m_VertexArray);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_CommandBuffer);
+
+	m_Primitives->Begin();
+	glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr);
+	m_Primitives->End();
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindVertexArray(0);
+}
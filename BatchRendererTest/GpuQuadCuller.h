@@ -0,0 +1,104 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+#include <memory>
+#include <atomic>
+
+#include "Renderer2D.h"
+
+class Shader;
+class Texture;
+class IndexBuffer;
+class GpuQuery;
+
+// one persistent quad as the compute shader sees it (std430, has to match res/gpu_cull.txt and res/gpu_vertex.txt)
+struct GpuQuad
+{
+	Vec4 CenterTexture; // xyz = center, w = texture slot
+	Vec4 HalfX; // xyz = half the quad along its rotated X axis, w unused
+	Vec4 HalfY;
+	Vec4 Color; // rgb = tint, a = 0 for a slot that isn't drawn
+	Vec4 TextureRect; // U0, V0, U1, V1 with V0 at the top of the quad
+};
+
+// slots [First, First + Count)
+struct GpuQuadRange
+{
+	uint32_t First;
+	uint32_t Count;
+};
+
+// what one SetQuads/SetQuadRanges recorded for the render thread, reused once it's uploaded
+struct GpuQuadStaging
+{
+	std::vector<GpuQuad> Quads; // packed back to back
+	std::vector<GpuQuadRange> Ranges;
+	std::atomic<bool> InFlight;
+};
+
+// rotation and scale are baked into the two axes here, the gpu only adds them to the center
+GpuQuad MakeGpuQuad(const Transform& transform, Vec3 color, uint32_t textureSlot, Vec4 textureRect = { 0.0f, 0.0f, 1.0f, 1.0f });
+
+// Quads that live in a shader storage buffer and never go through the batcher. Every frame a compute shader tests
+// them against the frustum and appends the survivors to a visible list plus the index count of a
+// DrawElementsIndirectCommand, then one glDrawElementsIndirect pulls their vertices straight from the records.
+// Nothing is read back: the visible count comes from a primitives query a few frames late.
+// Needs compute shaders (GL 4.3), OpenGL only. Create it, set its quads and delete it on the thread that records GL,
+// the GL objects go away after whatever is still queued. With a render thread the records are staged in buffers
+// that are recycled once uploaded, so the caller's array can change right after the call.
+class GpuQuadCuller
+{
+public:
+	GpuQuadCuller(uint32_t capacity);
+	~GpuQuadCuller();
+
+	GpuQuadCuller(const GpuQuadCuller&) = delete;
+	GpuQuadCuller& operator=(const GpuQuadCuller&) = delete;
+
+	static bool IsSupported();
+
+	static const uint32_t InvalidTextureSlot = 0xffffffff;
+
+	// returns the slot for MakeGpuQuad, or InvalidTextureSlot once all MAX_TEXTURE_SLOTS are taken
+	uint32_t AddTexture(Texture* texture);
+
+	// uploads count records starting at first, the rest of the buffer keeps what it had
+	void SetQuads(const GpuQuad* quads, uint32_t first, uint32_t count);
+	// same for many ranges at once, quads is indexed by slot like the buffer. One GL command for all of them
+	void SetQuadRanges(const GpuQuad* quads, const GpuQuadRange* ranges, uint32_t rangeCount);
+	// records past it aren't culled or drawn
+	void SetQuadCount(uint32_t count);
+
+	// GL side, Renderer2D::DrawGpuQuads records it in the scene
+	void Draw(const glm::mat4& view, const glm::mat4& proj, uint32_t quadCount);
+
+	inline uint32_t GetCapacity() const { return m_Capacity; }
+	inline uint32_t GetQuadCount() const { return m_QuadCount; }
+	// from a few frames back
+	uint32_t GetVisibleCount() const;
+
+private:
+	// the first one the render thread is done with, a new one only while more uploads are queued than ever before
+	GpuQuadStaging* AcquireStaging();
+
+private:
+	uint32_t m_Capacity;
+	uint32_t m_QuadCount;
+
+	std::unique_ptr<Shader> m_CullProgram;
+	std::unique_ptr<Shader> m_DrawProgram;
+	std::unique_ptr<IndexBuffer> m_Indices;
+	std::unique_ptr<GpuQuery> m_Primitives;
+	uint32_t m_QuadBuffer;
+	uint32_t m_VisibleBuffer;
+	uint32_t m_CommandBuffer;
+	uint32_t m_VertexArray;
+
+	Texture* m_Textures[MAX_TEXTURE_SLOTS];
+	uint32_t m_TextureCount;
+
+	// the vectors keep their capacity, so a steady upload size doesn't allocate
+	std::vector<std::unique_ptr<GpuQuadStaging>> m_Staging;
+};
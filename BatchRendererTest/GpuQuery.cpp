@@ -0,0 +1,43 @@
+#include "GpuQuery.h"
+
+#include "GL/glew.h"
+
+GpuQuery::GpuQuery(uint32_t target)
+	: m_Target(target), m_Current(0), m_Result(0)
+{
+	glGenQueries(QueryCount, m_Queries);
+
+	for (uint32_t i = 0; i < QueryCount; i++)
+		m_Issued[i] = false;
+}
+
+GpuQuery::~GpuQuery()
+{
+	glDeleteQueries(QueryCount, m_Queries);
+}
+
+void GpuQuery::Begin()
+{
+	// the slot we're about to reuse is the oldest one, grab its result if the gpu is done with it
+	if (m_Issued[m_Current])
+	{
+		int32_t available = GL_FALSE;
+		glGetQueryObjectiv(m_Queries[m_Current], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available)
+		{
+			GLuint64 result = 0;
+			glGetQueryObjectui64v(m_Queries[m_Current], GL_QUERY_RESULT, &result);
+			m_Result = result;
+		}
+	}
+
+	glBeginQuery(m_Target, m_Queries[m_Current]);
+}
+
+void GpuQuery::End()
+{
+	glEndQuery(m_Target);
+
+	m_Issued[m_Current] = true;
+	m_Current = (m_Current + 1) % QueryCount;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+
+// Wraps a ring of GL queries so results are read a few frames late instead of stalling the pipeline.
+// target is anything glBeginQuery accepts: GL_TIME_ELAPSED, GL_SAMPLES_PASSED, GL_FRAGMENT_SHADER_INVOCATIONS...
+class GpuQuery
+{
+public:
+	GpuQuery(uint32_t target);
+	~GpuQuery();
+
+	void Begin();
+	void End();
+
+	// last result that was available, 0 until the first one comes back
+	inline uint64_t GetResult() const { return m_Result; }
+
+private:
+	static const uint32_t QueryCount = 4;
+
+	uint32_t m_Target;
+	uint32_t m_Queries[QueryCount];
+	bool m_Issued[QueryCount];
+	uint32_t m_Current;
+	std::atomic<uint64_t> m_Result; // written by whoever owns the context, read by the UI
+};
@@ -0,0 +1,199 @@
+#include "ImpostorCache.h"
+
+#include "ShaderLibrary.h"
+#include "RenderTarget.h"
+#include "Texture.h"
+
+#include <float.h>
+#include <chrono>
+
+ImpostorCache::ImpostorCache(const Renderer2DConfig& config, uint32_t resolution)
+	: m_Resolution(resolution > 0 ? resolution : 1), m_Threshold((float)m_Resolution), m_MaxBakesPerFrame(8), m_ShadersReady(false), m_Stats()
+{
+	if (config.Backend == RendererBackend::OpenGL)
+		m_Renderer.reset(new Renderer2D(config));
+}
+
+ImpostorCache::~ImpostorCache()
+{
+}
+
+uint32_t ImpostorCache::AddRegion(Vec3 min, Vec3 max, const ImpostorDrawFunction& draw)
+{
+	Region region;
+	region.Min = min;
+	region.Max = max;
+	region.Draw = draw;
+	region.Baked = false;
+	region.UseImpostor = false;
+
+	m_Regions.push_back(std::move(region));
+	return (uint32_t)m_Regions.size() - 1;
+}
+
+void ImpostorCache::Invalidate(uint32_t region)
+{
+	m_Regions[region].Baked = false;
+}
+
+void ImpostorCache::InvalidateAll()
+{
+	for (Region& region : m_Regions)
+		region.Baked = false;
+}
+
+void ImpostorCache::Clear()
+{
+	m_Regions.clear();
+}
+
+// the screen rect of the bounds, FLT_MAX when part of them is behind the camera
+float ImpostorCache::GetProjectedSize(const Region& region, const glm::mat4& viewProj, uint32_t viewportWidth, uint32_t viewportHeight) const
+{
+	float minX = FLT_MAX, minY = FLT_MAX;
+	float maxX = -FLT_MAX, maxY = -FLT_MAX;
+
+	for (uint32_t i = 0; i < 8; i++)
+	{
+		glm::vec4 corner =
+		{
+			i & 1 ? region.Max.X : region.Min.X,
+			i & 2 ? region.Max.Y : region.Min.Y,
+			i & 4 ? region.Max.Z : region.Min.Z,
+			1.0f
+		};
+
+		glm::vec4 clip = viewProj * corner;
+		if (clip.w <= 0.0f)
+			return FLT_MAX;
+
+		float x = clip.x / clip.w;
+		float y = clip.y / clip.w;
+		minX = x < minX ? x : minX;
+		minY = y < minY ? y : minY;
+		maxX = x > maxX ? x : maxX;
+		maxY = y > maxY ? y : maxY;
+	}
+
+	float width = (maxX - minX) * 0.5f * viewportWidth;
+	float height = (maxY - minY) * 0.5f * viewportHeight;
+	return width > height ? width : height;
+}
+
+// the bake renderer compiles its own permutations, a bake done with the fallback would stay until the next Invalidate
+bool ImpostorCache::ShadersReady()
+{
+	if (m_ShadersReady)
+		return true;
+
+	m_ShadersReady = true;
+	for (const ShaderProgramEntry& entry : m_Renderer->GetShaderLibrary()->GetEntries())
+	{
+		if (!entry.Ready)
+			m_ShadersReady = false;
+	}
+
+	// the library is only polled by BeginScene, an empty scene keeps it going
+	if (!m_ShadersReady)
+	{
+		Camera camera = {};
+		camera.FOV = 60.0f;
+		camera.AspectRatio = 1.0f;
+		m_Renderer->BeginScene(camera);
+		m_Renderer->EndScene();
+	}
+
+	return m_ShadersReady;
+}
+
+void ImpostorCache::Bake(Region& region)
+{
+	float width = region.Max.X - region.Min.X;
+	float height = region.Max.Y - region.Min.Y;
+
+	if (!region.Target)
+		region.Target.reset(new RenderTarget(m_Resolution, m_Resolution, true));
+
+	// looking down +Z at the region, the square texture stretches to whatever aspect the region has
+	Camera camera = {};
+	camera.Transform.Location = { (region.Min.X + region.Max.X) * 0.5f, (region.Min.Y + region.Max.Y) * 0.5f, region.Min.Z - 1.0f };
+	camera.Transform.Scale = { 1.0f, 1.0f, 1.0f };
+	camera.FOV = 60.0f;
+	camera.AspectRatio = width / height;
+	camera.Orthographic = true;
+	camera.OrthographicHeight = height;
+
+	m_Renderer->SetRenderTarget(region.Target.get());
+	m_Renderer->Clear({ 0.0f, 0.0f, 0.0f }, 0.0f);
+	m_Renderer->BeginScene(camera);
+	region.Draw(m_Renderer.get());
+	m_Renderer->EndScene();
+	m_Renderer->SetRenderTarget(nullptr);
+
+	region.Target->GetTexture()->GenerateMipmaps();
+	region.Baked = true;
+}
+
+void ImpostorCache::Update(const Camera& camera, uint32_t viewportWidth, uint32_t viewportHeight)
+{
+	m_Stats.Regions = (uint32_t)m_Regions.size();
+	m_Stats.Impostors = 0;
+	m_Stats.Bakes = 0;
+	m_Stats.BakeMs = 0.0f;
+
+	bool canBake = m_Renderer && ShadersReady();
+
+	std::chrono::steady_clock::time_point bakeStart = std::chrono::steady_clock::now();
+
+	glm::mat4 viewProj = GetProjectionMatrix(camera) * GetViewMatrix(camera);
+
+	for (Region& region : m_Regions)
+	{
+		region.UseImpostor = false;
+
+		if (!canBake || region.Max.X <= region.Min.X || region.Max.Y <= region.Min.Y)
+			continue;
+
+		if (GetProjectedSize(region, viewProj, viewportWidth, viewportHeight) >= m_Threshold)
+			continue;
+
+		if (!region.Baked)
+		{
+			if (m_Stats.Bakes == m_MaxBakesPerFrame)
+				continue;
+
+			Bake(region);
+			m_Stats.Bakes++;
+			m_Stats.TotalBakes++;
+		}
+
+		region.UseImpostor = true;
+		m_Stats.Impostors++;
+	}
+
+	if (m_Stats.Bakes > 0)
+	{
+		std::chrono::duration<float, std::milli> bakeTime = std::chrono::steady_clock::now() - bakeStart;
+		m_Stats.BakeMs = bakeTime.count();
+	}
+}
+
+void ImpostorCache::Draw(Renderer2D* renderer)
+{
+	for (Region& region : m_Regions)
+	{
+		if (!region.UseImpostor)
+		{
+			region.Draw(renderer);
+			continue;
+		}
+
+		Transform transform;
+		transform.Location = { (region.Min.X + region.Max.X) * 0.5f, (region.Min.Y + region.Max.Y) * 0.5f, (region.Min.Z + region.Max.Z) * 0.5f };
+		transform.Rotation = { 0.0f, 0.0f, 0.0f };
+		transform.Scale = { region.Max.X - region.Min.X, region.Max.Y - region.Min.Y, 1.0f };
+
+		// row 0 of a render target is the bottom, so V goes up the quad; alpha 0 is wherever the region drew nothing
+		renderer->DrawQuadTexturedRect(transform, region.Target->GetTexture(), { 0.0f, 1.0f, 1.0f, 0.0f }, { 1.0f, 1.0f, 1.0f }, ShaderFeature_Textured | ShaderFeature_AlphaTest);
+	}
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+#include <memory>
+#include <functional>
+
+#include "Renderer2D.h"
+
+class RenderTarget;
+
+// draws everything in a region, called with the bake renderer to fill the impostor and with the scene's renderer up close
+typedef std::function<void(Renderer2D* renderer)> ImpostorDrawFunction;
+
+struct ImpostorStats
+{
+	uint32_t Regions;
+	uint32_t Impostors; // regions drawn as their impostor this frame
+	uint32_t Bakes; // by the last Update
+	float BakeMs; // cpu side of those bakes
+	uint32_t TotalBakes;
+};
+
+// Level of detail for dense flat regions on the XY plane (a chunk of the checkerboard, a tile layer...).
+// A region smaller on screen than the threshold is drawn as one quad textured with a bake of its contents,
+// rendered once into a RenderTarget through an orthographic camera that frames the region exactly.
+// The bake stays until Invalidate, so the caller only invalidates when what the region draws changes.
+// Bakes are spread over frames (MaxBakesPerFrame), a region without its bake yet is drawn in full meanwhile.
+// OpenGL only, with the software backend every region is always drawn in full.
+class ImpostorCache
+{
+public:
+	// the config is for the bake renderer, resolution is the size of every impostor texture
+	ImpostorCache(const Renderer2DConfig& config, uint32_t resolution = 256);
+	~ImpostorCache();
+
+	ImpostorCache(const ImpostorCache&) = delete;
+	ImpostorCache& operator=(const ImpostorCache&) = delete;
+
+	// bounds of everything the draw function emits, the impostor sits halfway between min.Z and max.Z
+	uint32_t AddRegion(Vec3 min, Vec3 max, const ImpostorDrawFunction& draw);
+	void Invalidate(uint32_t region);
+	void InvalidateAll();
+	void Clear();
+
+	// Picks the detail of every region for this camera and bakes what's missing, before BeginScene of the scene
+	// since the bakes go through their own renderer and render target.
+	void Update(const Camera& camera, uint32_t viewportWidth, uint32_t viewportHeight);
+	// the region contents or the impostor quad, whatever the last Update picked
+	void Draw(Renderer2D* renderer);
+
+	// largest projected width or height in pixels that still uses the impostor, the resolution keeps it from magnifying
+	inline void SetThreshold(float pixels) { m_Threshold = pixels; }
+	inline float GetThreshold() const { return m_Threshold; }
+	inline void SetMaxBakesPerFrame(uint32_t count) { m_MaxBakesPerFrame = count; }
+	inline uint32_t GetMaxBakesPerFrame() const { return m_MaxBakesPerFrame; }
+
+	inline uint32_t GetResolution() const { return m_Resolution; }
+	inline const ImpostorStats& GetStats() const { return m_Stats; }
+
+private:
+	struct Region
+	{
+		Vec3 Min;
+		Vec3 Max;
+		ImpostorDrawFunction Draw;
+		std::unique_ptr<RenderTarget> Target; // created on the first bake
+		bool Baked;
+		bool UseImpostor;
+	};
+
+	float GetProjectedSize(const Region& region, const glm::mat4& viewProj, uint32_t viewportWidth, uint32_t viewportHeight) const;
+	void Bake(Region& region);
+	bool ShadersReady();
+
+private:
+	std::unique_ptr<Renderer2D> m_Renderer;
+	std::vector<Region> m_Regions;
+	uint32_t m_Resolution;
+	float m_Threshold;
+	uint32_t m_MaxBakesPerFrame;
+	bool m_ShadersReady;
+
+	ImpostorStats m_Stats;
+};
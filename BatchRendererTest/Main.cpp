@@ -12,156 +12,92 @@
 #include "glm/ext.hpp"
 
 #include "Shader.h"
+#include "ShaderLibrary.h"
+#include "ShaderPermutation.h"
+#include "SoftwareRasterizer.h"
+#include "Renderer2D.h"
+#include "Font.h"
+#include "ParticleSystem.h"
+#include "Tilemap.h"
+#include "SceneGraph.h"
+#include "SpatialIndex.h"
+#include "OverdrawView.h"
+#include "GpuQuadCuller.h"
+#include "QuadStore.h"
+#include "ImpostorCache.h"
+#include "RenderLayer.h"
+#include "RenderTarget.h"
+#include "RenderThread.h"
+#include "FramePacer.h"
+#include "WorkerPool.h"
 #include "Texture.h"
 #include "Buffer.h"
 #include "Math.h"
+#include "Vertex.h"
+#include "DemoScenes.h"
+#include "Tests.h"
 
 #include <Windows.h>
-#include <future>
-
-struct Transform
-{
-    Vec3 Location;
-    Vec3 Rotation;
-    Vec3 Scale;
-};
-
-struct Vertex
-{
-    Vec3 Position;
-    Vec3 Color;
-    Vec2 TextureCoordinates;
-    float TextureIndex;
-};
-
-struct Camera
-{
-    Transform Transform;
-    float FOV;
-    float AspectRatio;
-};
-
-struct TexturedQuad
-{
-    Transform Transform;
-    Vec3 ColorTint;
-    float TextureIndex;
-    float TilingFactor;
-};
-
-void GetTextCoordinates(float* coords, float tilingFactor = 1.0f)
-{
-    coords[0] = 0.0f;
-    coords[1] = tilingFactor;
-
-    coords[2] = tilingFactor;
-    coords[3] = tilingFactor;
-
-    coords[4] = tilingFactor;
-    coords[5] = 0.0f;
-
-    coords[6] = 0.0f;
-    coords[7] = 0.0f;
-}
+#include <thread>
+#include <memory>
+#include <chrono>
+#include <atomic>
+#include <vector>
+#include <algorithm>
 
 void OnWindowResize(GLFWwindow* window, int width, int height);
 void ScrollCallback(GLFWwindow* window, double xoffset, double yoffset);
+void OnKey(GLFWwindow* window, int key, int scancode, int action, int mods);
+void OnChar(GLFWwindow* window, unsigned int codepoint);
+void OnMouseButton(GLFWwindow* window, int button, int action, int mods);
+void OnCursorPos(GLFWwindow* window, double x, double y);
+void OnCursorEnter(GLFWwindow* window, int entered);
+void OnWindowFocus(GLFWwindow* window, int focused);
+void OnWindowRefresh(GLFWwindow* window);
+double GetTime();
 
 
 static int WndWidth = 1600;
 static int WndHeight = 900;
 static bool Fullscreen = false;
 static bool VSync = true;
+static RendererBackend Backend = RendererBackend::OpenGL; // --software for the cpu rasterizer
+static bool UseRenderThread = true; // OpenGL backend only
+static int MaxQueuedFrames = 1;
 
 constexpr uint32_t MAX_QUAD_BATCH = 10000;
-constexpr uint32_t MAX_TEXTURE_SLOTS = 16;
+constexpr uint32_t MAX_SUBMISSION_CONTEXTS = 32;
 
 #define USE_IMGUI 1
 
 GLFWwindow* window;
 
-uint32_t MaxQuads = 0;
-uint32_t MaxVertices = 0;
-uint32_t MaxIndices = 0;
-
-uint32_t quadCount = 0;
-uint32_t totalQuadCount = 0;
-
-uint32_t drawCalls = 0;
-
-Vertex* vertexBufferData;
-uint32_t* indexBufferData;
-
-VertexArray* vertexArray;
-VertexBuffer* vBuffer;
-IndexBuffer* iBuffer;
-Shader* shader;
-Texture* whiteTexture;
-
-Texture** textureSlots;
-uint32_t textureIndex = 1;
-uint32_t totalTextures = 1;
+Renderer2D* renderer = nullptr;
 
 int32_t checherboardSize = 50;
 Vec3 clearColor = { 0.321f, 0.058f, 0.784f };
 
-TexturedQuad* quadBatch = 0;
+int32_t rasterThreadCount = 1;
+float* rasterMPixelsPerThread = 0; // last measurement for every thread count, to compare scaling
 
-int ThreadCount = 0;
-std::future<void>* threads = 0;
-
-int32_t FindTexture(Texture* texture)
-{
-    for (uint32_t i = 0; i < textureIndex; i++)
-    {
-        if (textureSlots[i] == texture)
-        {
-            return i;
-        }
-    }
-    return -1;
-}
-
-inline bool IsTextureBound(Texture* texture)
-{
-    return FindTexture(texture) != -1;
-}
+uint32_t sdfAtlasSize = 1024;
 
-void PushTexture(Texture* texture)
-{
-    textureSlots[textureIndex++] = texture;
-    totalTextures++;
-}
-
-void BindAllTextures()
-{
-    for (uint32_t i = 0; i < textureIndex; i++)
-    {
-        textureSlots[i]->Bind(i);
-    }
-}
-
-void ClearTextures()
-{
-    textureIndex = 1;
-    for (uint32_t i = 1; i < MAX_TEXTURE_SLOTS; i++)
-    {
-        textureSlots[i] = nullptr;
-    }
-}
+int ThreadCount = 0;
 
-const Vec3 QuadVertices[] =
-{
-    { -0.5f, -0.5f, 0.0f },
-    {  0.5f, -0.5f, 0.0f },
-    {  0.5f,  0.5f, 0.0f },
-    { -0.5f,  0.5f, 0.0f }
-};
+// owns the context while it exists, everything GL from the game side goes through RenderThread::Run
+RenderThread* renderThread = nullptr;
+bool renderThreadEnabled = false;
+std::chrono::steady_clock::time_point frameInputTime; // when BeginFrame polled the events
+std::atomic<float> inputLatencyMs(0.0f);
 
-static Vec2 QuadTextCoords[4];
+FramePacer* framePacer = nullptr;
+int32_t maxFramesInFlight = 2;
+float targetFrameRate = 0.0f;
 
-static glm::mat4 view;
-static glm::mat4 proj;
+// glGetString needs the context, which the game thread doesn't have with a render thread
+std::string glVendor;
+std::string glRenderer;
+std::string glVersion;
 
 bool Init()
 {
@@ -170,9 +106,6 @@ bool Init()
     {
         return false;
     }
-    // NO, IT USES THE CONSTRUCTOR FOR REF COUNT AND WE NEED TO INITIALIZE IT, we could loop and init it ourself but lets use the new operator
-    // threads = (std::future<void>*)malloc(sizeof(std::future<void>) * ThreadCount);
-    threads = new std::future<void>[ThreadCount];
 
     /* Initialize the library */
     if (!glfwInit())
@@ -212,6 +145,15 @@ bool Init()
 
     glfwSetScrollCallback(window, ScrollCallback);
 
+    // before ImGui installs its own, it calls these after handling the event
+    glfwSetKeyCallback(window, OnKey);
+    glfwSetCharCallback(window, OnChar);
+    glfwSetMouseButtonCallback(window, OnMouseButton);
+    glfwSetCursorPosCallback(window, OnCursorPos);
+    glfwSetCursorEnterCallback(window, OnCursorEnter);
+    glfwSetWindowFocusCallback(window, OnWindowFocus);
+    glfwSetWindowRefreshCallback(window, OnWindowRefresh);
+
 #if USE_IMGUI
 
     ImGui::CreateContext();
@@ -224,271 +166,1184 @@ bool Init()
     if (!ImGui_ImplOpenGL3_Init())
         return false;
 
+    // NewFrame would create them lazily, but by then the context might be on the render thread
+    if (!ImGui_ImplOpenGL3_CreateDeviceObjects())
+        return false;
+
 #endif
 
+    glVendor = (const char*)glGetString(GL_VENDOR);
+    glRenderer = (const char*)glGetString(GL_RENDERER);
+    glVersion = (const char*)glGetString(GL_VERSION);
+
     return true;
 }
 
 void Shutdown()
 {
-    delete[] threads;
     glfwTerminate();
 }
 
-void InitRenderer(uint32_t maxQuads)
+void InitRenderer(uint32_t maxQuads, RendererBackend rendererBackend)
 {
-    MaxQuads = maxQuads;
-    MaxVertices = MaxQuads * 4;
-    MaxIndices = MaxQuads * 6;
+    Renderer2DConfig config;
+    config.MaxQuads = maxQuads;
+    config.ThreadCount = ThreadCount;
+    config.SubmissionContexts = MAX_SUBMISSION_CONTEXTS;
+    config.Backend = rendererBackend;
+    config.Width = WndWidth;
+    config.Height = WndHeight;
+
+    renderer = new Renderer2D(config);
+
+    if (rendererBackend == RendererBackend::Software)
+    {
+        rasterThreadCount = ThreadCount;
 
-    quadCount = 0;
+        rasterMPixelsPerThread = new float[ThreadCount + 1];
+        for (int32_t i = 0; i <= ThreadCount; i++)
+            rasterMPixelsPerThread[i] = 0.0f;
+    }
+}
 
-    vertexBufferData = (Vertex*)malloc(sizeof(Vertex) * MaxVertices);
-    indexBufferData = (uint32_t*)malloc(sizeof(uint32_t) * MaxIndices);
+void ShutdownRenderer()
+{
+    delete renderer;
+    renderer = nullptr;
+
+    delete[] rasterMPixelsPerThread;
+    rasterMPixelsPerThread = nullptr;
+}
+
+void ImGuiRender();
+void CopyLastFrame();
+
+void BeginFrame()
+{
+    glfwPollEvents();
+    frameInputTime = std::chrono::steady_clock::now();
+
+#if USE_IMGUI
 
-    for (int i = 0, offset = 0, valOffset = 0; i < MaxQuads; i++, offset += 6, valOffset = 4 * i)
+    ImGui_ImplOpenGL3_NewFrame();
+    ImGui_ImplGlfw_NewFrame();
+    ImGui::NewFrame();
+
+#endif
+}
+
+#if USE_IMGUI
+// ImGui rewrites its draw lists every frame. Instead of a copy the render thread gets their buffers, swapped with
+// the ones of a frame it's done with, so ImGui fills buffers that already have the capacity and nothing is copied
+struct ImGuiFrame
+{
+    ImDrawData DrawData;
+    std::vector<ImDrawList*> Lists;
+    std::atomic<bool> InFlight;
+
+    ~ImGuiFrame()
+    {
+        for (ImDrawList* list : Lists)
+            IM_DELETE(list);
+    }
+};
+
+// only cleared once the render thread is gone
+std::vector<std::unique_ptr<ImGuiFrame>> imguiFrames;
+
+ImGuiFrame* TakeImGuiDrawData(ImDrawData* drawData)
+{
+    ImGuiFrame* frame = nullptr;
+    for (std::unique_ptr<ImGuiFrame>& candidate : imguiFrames)
     {
-        indexBufferData[0 + offset] = 0 + valOffset;
-        indexBufferData[1 + offset] = 1 + valOffset;
-        indexBufferData[2 + offset] = 2 + valOffset;
-        indexBufferData[3 + offset] = 2 + valOffset;
-        indexBufferData[4 + offset] = 3 + valOffset;
-        indexBufferData[5 + offset] = 0 + valOffset;
+        if (!candidate->InFlight.load())
+        {
+            frame = candidate.get();
+            break;
+        }
     }
 
-    vBuffer = new VertexBuffer(nullptr, sizeof(Vertex) * MaxVertices);
-    iBuffer = new IndexBuffer(indexBufferData, sizeof(uint32_t) * MaxIndices);
-    shader = Shader::FromFile("res/vertex.txt", "res/fragment.txt");
+    if (!frame)
+    {
+        imguiFrames.emplace_back(new ImGuiFrame());
+        frame = imguiFrames.back().get();
+    }
 
-    shader->Bind();
+    frame->InFlight = true;
+    frame->DrawData = *drawData;
 
-    vBuffer->SetLayout
-    ({
-        { ShaderDataType::Float3, false },
-        { ShaderDataType::Float3, false },
-        { ShaderDataType::Float2, false },
-        { ShaderDataType::Float, false }
+    while ((int)frame->Lists.size() < drawData->CmdListsCount)
+        frame->Lists.push_back(IM_NEW(ImDrawList)(ImGui::GetDrawListSharedData()));
+
+    // ImGui resets the lists in NewFrame, what they hold until then isn't read anymore
+    for (int i = 0; i < drawData->CmdListsCount; i++)
+    {
+        ImDrawList* source = drawData->CmdLists[i];
+        ImDrawList* list = frame->Lists[i];
+        list->CmdBuffer.swap(source->CmdBuffer);
+        list->IdxBuffer.swap(source->IdxBuffer);
+        list->VtxBuffer.swap(source->VtxBuffer);
+        list->Flags = source->Flags;
+    }
+
+    frame->DrawData.CmdLists = frame->Lists.data();
+    return frame;
+}
+#endif
+
+// the scenes are done by now, this draws the UI on top and presents
+void EndFrame()
+{
+    if (renderer->GetBackend() == RendererBackend::Software)
+    {
+        SoftwareRasterizer* rasterizer = renderer->GetRasterizer();
+        rasterMPixelsPerThread[rasterizer->GetThreadCount()] = rasterizer->GetMPixelsPerSecond();
+    }
+
+#if USE_IMGUI
+    ImGuiRender();
+    ImGui::Render();
+
+    if (RenderThread::IsRecording())
+    {
+        ImGuiFrame* imguiFrame = TakeImGuiDrawData(ImGui::GetDrawData());
+        RenderThread::Run([imguiFrame]()
+        {
+            ImGui_ImplOpenGL3_RenderDrawData(&imguiFrame->DrawData);
+            imguiFrame->InFlight = false;
         });
+    }
+    else
+    {
+        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    }
+#endif
+
+    CopyLastFrame();
+
+    // up to when SwapBuffers returns, the driver may still hold the frame a bit after that
+    std::chrono::steady_clock::time_point inputTime = frameInputTime;
+    RenderThread::Run([inputTime]()
+    {
+        glfwSwapBuffers(window);
+
+        std::chrono::duration<float, std::milli> latency = std::chrono::steady_clock::now() - inputTime;
+        inputLatencyMs = latency.count();
+    });
+
+    framePacer->EndFrame();
+
+    if (renderThread)
+        renderThread->EndFrame();
+}
+
+float totalTime = 0.0f;
+float deltaTime = 0.0f;
+
+float rotPerSec = 50.0f;
+float tilingFactor = 1.0f;
+
+float cameraMoveSpeed = 3.0f;
+float cameraScroolMultiplier = 100.0f;
+float mouseSens = 0.2f;
+
+Transform mainQuadTransform = { { 0.0f, 0.0f, -0.2f }, { 0.0f, 0.0f, 0.0f }, { 1.5f, 1.5f, 1.0f} };
+Vec3 mainQuadColor = { 0.2f, 0.92f, 0.52f };
+Vec3 checkerboardQuadScale = { 1.0f, 1.0f, 1.0f };
+
+Texture* myTexture;
+
+Font* font = nullptr;
+int32_t textBenchmarkGlyphs = 0;
+bool textBenchmarkSdf = false;
+float textBenchmarkMs = 0.0f;
+
+int32_t debugShapeCount = 0;
+float debugShapesMs = 0.0f;
 
-    vertexArray = new VertexArray(vBuffer, iBuffer);
-    vertexArray->Bind();
+int32_t parallelSpriteCount = 0;
+int32_t parallelSubmitThreads = 4;
+float parallelSubmitMs = 0.0f;
 
-    uint32_t whitePixel = 0xffffffff;
-    whiteTexture = new Texture(1, 1, 4, (unsigned char*)&whitePixel);
+int32_t sprite2DCount = 0;
+bool sprite2DAsQuads = false; // the same sprites through DrawQuadTextured, to compare the two paths
+float sprite2DSubmitMs = 0.0f;
+float endSceneMs = 0.0f;
 
-    int samplers[MAX_TEXTURE_SLOTS];
-    for (int i = 0; i < MAX_TEXTURE_SLOTS; i++)
-        samplers[i] = i;
-    shader->SetUniform1iv("u_TexSlots", MAX_TEXTURE_SLOTS, samplers);
+constexpr uint32_t SUBMISSION_SCALING_SPRITES = 1000000;
 
-    textureSlots = (Texture**)malloc(sizeof(Texture*) * MAX_TEXTURE_SLOTS);
-    textureSlots[0] = whiteTexture;
+bool runSubmissionScaling = false;
+float submissionScalingSubmitMs[MAX_SUBMISSION_CONTEXTS + 1] = {}; // indexed by thread count, 0 when not measured
+float submissionScalingSortMs[MAX_SUBMISSION_CONTEXTS + 1] = {};
 
-    quadBatch = (TexturedQuad*)malloc(sizeof(TexturedQuad) * MAX_QUAD_BATCH);
+constexpr uint32_t MATH_BENCHMARK_QUADS = 100000;
 
-    glClearColor(clearColor.X, clearColor.Y, clearColor.Z, 1.0f);
+bool runMathBenchmark = false;
+bool mathBenchmarkDone = false;
+float sinCosMaxError = 0.0f; // against the double precision sin/cos
+float cosMaxError = 0.0f;
+float rotationMaxError = 0.0f; // closed form against the three glm::rotate
+float calcVerticesNs[2] = {}; // per quad, Z only and XYZ
+float calcVerticesReferenceNs[2] = {};
+
+constexpr uint32_t MAX_PARTICLES = 1000000;
+
+ParticleSystem* particles = nullptr;
+int32_t particleEmitRate = 1000; // per second
+float particleLifeTime = 3.0f;
+float particleSize = 0.02f;
+Vec3 particleGravity = { 0.0f, -1.0f, 0.0f };
+float particleEmitAccumulator = 0.0f;
+float particleUpdateMs = 0.0f;
+float particleSubmitMs = 0.0f;
+
+Camera cam;
+
+////////////////////////////////////////////////
+/////////////// TILEMAP ////////////////////////
+////////////////////////////////////////////////
+
+// checkerboard pattern on a map way too big to draw quad by quad, pan around with the camera to benchmark it
+
+constexpr uint32_t TILEMAP_SIZE = 4096;
+
+Tilemap* tilemap = nullptr;
+bool tilemapEnabled = false;
+int32_t tilemapEditsPerFrame = 0;
+float tilemapMs = 0.0f;
+
+void CreateTilemap()
+{
+    tilemap = new Tilemap(TILEMAP_SIZE, TILEMAP_SIZE, { checkerboardQuadScale.X, checkerboardQuadScale.Y }, { 0.0f, 0.0f, 0.0f }, Renderer2D::GetVertexLayout(), ThreadCount);
+
+    uint16_t white = tilemap->AddTileType({ renderer->GetWhiteTexture(), { 1.0f, 1.0f, 1.0f }, GetTilingRect(1.0f) });
+    uint16_t textured = tilemap->AddTileType({ myTexture, { 1.0f, 1.0f, 1.0f }, GetTilingRect(tilingFactor) });
+    uint16_t tinted = tilemap->AddTileType({ myTexture, { 1.0f, 0.5f, 0.5f }, GetTilingRect(tilingFactor) });
+
+    for (uint32_t y = 0; y < TILEMAP_SIZE; y++)
+    {
+        for (uint32_t x = 0; x < TILEMAP_SIZE; x++)
+        {
+            // every 64 tiles a tinted row/column so panning is visible
+            if (x % 64 == 0 || y % 64 == 0)
+                tilemap->SetTile(x, y, tinted);
+            else
+                tilemap->SetTile(x, y, (x + y) % 2 ? textured : white);
+        }
+    }
 }
 
-void ShutdownRenderer()
+// random tiles changed every frame, so we can see what re-uploading dirty chunks costs
+void EditTilemap()
 {
-    free(vertexBufferData);
-    free(indexBufferData);
+    for (int32_t i = 0; i < tilemapEditsPerFrame; i++)
+    {
+        uint32_t x = rand() % TILEMAP_SIZE;
+        uint32_t y = rand() % TILEMAP_SIZE;
+        tilemap->SetTile(x, y, tilemap->GetTile(x, y) == Tilemap::EmptyTile ? 0 : Tilemap::EmptyTile);
+    }
+}
+
+////////////////////////////////////////////////
+/////////////// SCENE GRAPH ////////////////////
+////////////////////////////////////////////////
 
-    delete vBuffer;
-    delete iBuffer;
+// Spinning clusters above the checkerboard: every root has 9 children with 9 children each, 91 nodes per root.
+// A fraction of the nodes is moved every frame, only those and their subtrees get their world matrix rebuilt.
 
-    free(textureSlots);
+constexpr uint32_t SCENE_GRAPH_ROOTS = 1100; // about 100k nodes
+constexpr uint32_t SCENE_GRAPH_ROOTS_PER_ROW = 50;
 
-    free(quadBatch);
+SceneGraph* sceneGraph = nullptr;
+bool sceneGraphEnabled = false;
+float sceneGraphMovedPercent = 1.0f;
+bool sceneGraphFullUpdate = false; // every world matrix every frame, to compare
+uint32_t sceneGraphMoved = 0;
+uint32_t sceneGraphFrame = 0;
+float sceneGraphUpdateMs = 0.0f;
+float sceneGraphSubmitMs = 0.0f;
+
+void CreateSceneGraph()
+{
+    sceneGraph = new SceneGraph();
+
+    for (uint32_t root = 0; root < SCENE_GRAPH_ROOTS; root++)
+    {
+        float x = (root % SCENE_GRAPH_ROOTS_PER_ROW) * 1.5f;
+        float y = 3.0f + (root / SCENE_GRAPH_ROOTS_PER_ROW) * 1.5f;
+        uint32_t rootNode = sceneGraph->AddNode(SceneGraph::NoParent, { { x, y, -0.1f }, { 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f } }, myTexture);
+
+        for (uint32_t child = 0; child < 9; child++)
+        {
+            float angle = child * 40.0f;
+            Vec3 offset = { cosf(glm::radians(angle)) * 0.5f, sinf(glm::radians(angle)) * 0.5f, 0.0f };
+            uint32_t childNode = sceneGraph->AddNode(rootNode, { offset, { 0.0f, 0.0f, angle }, { 0.4f, 0.4f, 1.0f } }, myTexture, { 0.5f, 1.0f, 0.5f });
+
+            for (uint32_t leaf = 0; leaf < 9; leaf++)
+            {
+                float leafAngle = leaf * 40.0f;
+                Vec3 leafOffset = { cosf(glm::radians(leafAngle)) * 0.6f, sinf(glm::radians(leafAngle)) * 0.6f, 0.0f };
+                sceneGraph->AddNode(childNode, { leafOffset, { 0.0f, 0.0f, 0.0f }, { 0.3f, 0.3f, 1.0f } }, renderer->GetWhiteTexture(), { 1.0f, 0.6f, 0.3f });
+            }
+        }
+    }
 }
 
-void ImGuiRender();
+// spins a spread out set of nodes a bit further, a different set every frame
+void UpdateSceneGraph()
+{
+    uint32_t count = sceneGraph->GetNodeCount();
+    sceneGraphMoved = (uint32_t)(count * sceneGraphMovedPercent / 100.0f);
+    sceneGraphFrame++;
 
-void BeginScene(Camera camera)
+    for (uint32_t i = 0; i < sceneGraphMoved; i++)
+    {
+        uint32_t node = (uint32_t)(((uint64_t)i * 104729 + (uint64_t)sceneGraphFrame * 7919) % count);
+        Transform local = sceneGraph->GetLocal(node);
+        local.Rotation.Z += 10.0f;
+        sceneGraph->SetLocal(node, local);
+    }
+
+    if (sceneGraphFullUpdate)
+        sceneGraph->MarkAllDirty();
+
+    sceneGraph->Update();
+}
+
+////////////////////////////////////////////////
+/////////////// SPATIAL INDEX //////////////////
+////////////////////////////////////////////////
+
+// A million persistent quads to the left of the checkerboard. Only what the frustum query returns is drawn,
+// a few of them wander around every frame and left click picks the one under the cursor.
+
+constexpr uint32_t SPATIAL_QUADS = 1000000;
+constexpr uint32_t SPATIAL_QUADS_PER_ROW = 1000;
+constexpr float SPATIAL_SPACING = 0.5f;
+
+SpatialIndex* spatialIndex = nullptr;
+std::vector<Vec3> spatialColors; // by handle
+std::vector<uint32_t> spatialResults;
+bool spatialEnabled = false;
+int32_t spatialMovesPerFrame = 1000;
+uint32_t spatialPicked = SpatialIndex::InvalidItem;
+float spatialBuildMs = 0.0f;
+float spatialQueryMs = 0.0f;
+float spatialMoveMs = 0.0f;
+float spatialPickMs = 0.0f;
+uint32_t spatialVisible = 0;
+
+void CreateSpatialIndex()
 {
-    drawCalls = 0;
+    spatialIndex = new SpatialIndex(SPATIAL_SPACING * 2.0f);
+    spatialColors.resize(SPATIAL_QUADS);
 
-    glfwPollEvents();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 
-#if USE_IMGUI
+    for (uint32_t i = 0; i < SPATIAL_QUADS; i++)
+    {
+        float x = -2.0f - (i % SPATIAL_QUADS_PER_ROW) * SPATIAL_SPACING;
+        float y = (i / SPATIAL_QUADS_PER_ROW) * SPATIAL_SPACING;
+        uint32_t item = spatialIndex->Insert({ { x, y, 0.0f }, { 0.0f, 0.0f, (float)(i % 90) }, { 0.3f, 0.3f, 1.0f } });
+        spatialColors[item] = { 0.2f + (i % 5) * 0.15f, 0.4f, 0.9f - (i % 7) * 0.1f };
+    }
 
-    ImGui_ImplOpenGL3_NewFrame();
-    ImGui_ImplGlfw_NewFrame();
-    ImGui::NewFrame();
+    std::chrono::duration<float, std::milli> buildTime = std::chrono::steady_clock::now() - start;
+    spatialBuildMs = buildTime.count();
+}
 
-#endif
+// clears and inserts everything again, what it would cost to rebuild the index every frame instead of moving items
+void RebuildSpatialIndex()
+{
+    std::vector<Transform> transforms(spatialIndex->GetHandleRange());
+    for (uint32_t i = 0; i < spatialIndex->GetHandleRange(); i++)
+        transforms[i] = spatialIndex->GetTransform(i);
 
-    glEnable(GL_DEPTH_TEST);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 
-    view =
-        GetRotation(-camera.Transform.Rotation)
-        *
-        glm::translate(glm::mat4(1.0f), -(glm::vec3)camera.Transform.Location);
+    spatialIndex->Clear();
+    for (const Transform& transform : transforms)
+        spatialIndex->Insert(transform);
 
-    proj = glm::perspectiveLH(glm::radians(camera.FOV), camera.AspectRatio, 0.1f, 10000.0f);
+    std::chrono::duration<float, std::milli> buildTime = std::chrono::steady_clock::now() - start;
+    spatialBuildMs = buildTime.count();
 }
 
-void CalcVertices(TexturedQuad* batchData, Vertex* vertexData, uint32_t count)
+void MoveSpatialQuads()
 {
-    Vec2 quadTextCoords[4];
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 
-    for (uint32_t i = 0; i < count; i++)
+    for (int32_t i = 0; i < spatialMovesPerFrame; i++)
     {
-        glm::mat4 model =
-            glm::translate(glm::mat4(1.0f), (glm::vec3)(batchData->Transform.Location))
-            *
-            GetRotation(batchData->Transform.Rotation)
-            *
-            glm::scale(glm::mat4(1.0f), (glm::vec3)(batchData->Transform.Scale));
+        uint32_t item = rand() % spatialIndex->GetHandleRange();
+        Transform transform = spatialIndex->GetTransform(item);
+        transform.Location.X += ((rand() % 201) - 100) * 0.001f;
+        transform.Location.Y += ((rand() % 201) - 100) * 0.001f;
+        transform.Rotation.Z += 5.0f;
+        spatialIndex->Move(item, transform);
+    }
+
+    std::chrono::duration<float, std::milli> moveTime = std::chrono::steady_clock::now() - start;
+    spatialMoveMs = moveTime.count();
+}
+
+void DrawSpatialQuads()
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    spatialResults.clear();
+    spatialIndex->QueryFrustum(GetProjectionMatrix(cam) * GetViewMatrix(cam), spatialResults);
+
+    std::chrono::duration<float, std::milli> queryTime = std::chrono::steady_clock::now() - start;
+    spatialQueryMs = queryTime.count();
+    spatialVisible = (uint32_t)spatialResults.size();
+
+    for (uint32_t item : spatialResults)
+    {
+        renderer->DrawQuad(spatialIndex->GetTransform(item), item == spatialPicked ? Vec3{ 1.0f, 1.0f, 0.0f } : spatialColors[item]);
+    }
+}
+
+////////////////////////////////////////////////
+/////////////// GPU CULLING ////////////////////
+////////////////////////////////////////////////
+
+// The same kind of field as the spatial index but below the checkerboard, kept in a QuadStore and culled by a compute shader.
+// A slice of it is turned and recolored every frame to see what the retained updates upload, the benchmark runs
+// GPU_CULL_BENCHMARK_FRAMES frames at each of the fractions.
+
+constexpr uint32_t GPU_CULL_QUADS = 1000000;
+constexpr uint32_t GPU_CULL_QUADS_PER_ROW = 1000;
+constexpr float GPU_CULL_SPACING = 0.5f;
+constexpr uint32_t GPU_CULL_BENCHMARK_FRAMES = 60;
+const float gpuCullBenchmarkPercents[3] = { 0.1f, 1.0f, 10.0f };
+
+GpuQuadCuller* gpuCuller = nullptr;
+QuadStore* gpuQuads = nullptr;
+std::vector<QuadHandle> gpuQuadHandles;
+uint32_t gpuQuadWhiteSlot = 0;
+uint32_t gpuQuadTextureSlot = 0;
+bool gpuCullEnabled = false;
+float gpuCullCreateMs = 0.0f;
+
+float gpuQuadsChangedPercent = 0.0f;
+int32_t gpuQuadsMergeGap = 4;
+uint32_t gpuQuadsUpdateFrame = 0;
+uint32_t gpuQuadsChanged = 0;
+float gpuQuadsUpdateMs = 0.0f;
+
+int32_t gpuCullBenchmarkFrame = -1; // -1 when it's not running
+float gpuCullBenchmarkSavedPercent = 0.0f;
+double gpuCullBenchmarkBytes[3] = {}; // per frame, averaged
+double gpuCullBenchmarkRanges[3] = {};
+double gpuCullBenchmarkFlushMs[3] = {};
+
+// spin turns every quad a bit further, so an update always changes the record
+GpuQuad MakeFieldQuad(uint32_t i, uint32_t spin)
+{
+    float x = (i % GPU_CULL_QUADS_PER_ROW) * GPU_CULL_SPACING;
+    float y = -2.0f - (i / GPU_CULL_QUADS_PER_ROW) * GPU_CULL_SPACING;
+    Transform transform = { { x, y, 0.0f }, { 0.0f, 0.0f, (float)((i + spin * 7) % 90) }, { 0.3f, 0.3f, 1.0f } };
+    Vec3 color = { 0.9f - ((i + spin) % 7) * 0.1f, 0.4f, 0.2f + (i % 5) * 0.15f };
+
+    return MakeGpuQuad(transform, color, i % 3 ? gpuQuadWhiteSlot : gpuQuadTextureSlot);
+}
 
-        GetTextCoordinates((float*)quadTextCoords, batchData->TilingFactor);
+void CreateGpuCuller()
+{
+    std::chrono::steady_clock::time_point createStart = std::chrono::steady_clock::now();
+
+    gpuCuller = new GpuQuadCuller(GPU_CULL_QUADS);
+    gpuQuadWhiteSlot = gpuCuller->AddTexture(renderer->GetWhiteTexture());
+    gpuQuadTextureSlot = gpuCuller->AddTexture(myTexture);
+    if (gpuQuadTextureSlot == GpuQuadCuller::InvalidTextureSlot)
+        gpuQuadTextureSlot = gpuQuadWhiteSlot;
+
+    gpuQuads = new QuadStore(gpuCuller);
+    gpuQuads->SetMergeGap(gpuQuadsMergeGap);
+
+    gpuQuadHandles.resize(GPU_CULL_QUADS);
+    for (uint32_t i = 0; i < GPU_CULL_QUADS; i++)
+    {
+        gpuQuadHandles[i] = gpuQuads->CreateQuad(MakeFieldQuad(i, 0));
+    }
+
+    // all of them dirty, one range
+    gpuQuads->Flush();
+
+    std::chrono::duration<float, std::milli> createTime = std::chrono::steady_clock::now() - createStart;
+    gpuCullCreateMs = createTime.count();
+}
+
+// before the quads are drawn, Flush uploads whatever changed
+void UpdateGpuQuads()
+{
+    if (gpuCullBenchmarkFrame == 0)
+        gpuCullBenchmarkSavedPercent = gpuQuadsChangedPercent;
+    if (gpuCullBenchmarkFrame >= 0)
+        gpuQuadsChangedPercent = gpuCullBenchmarkPercents[gpuCullBenchmarkFrame / GPU_CULL_BENCHMARK_FRAMES];
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 
-        for (uint32_t j = 0; j < 4; j++)
+    gpuQuadsUpdateFrame++;
+    gpuQuadsChanged = (uint32_t)(GPU_CULL_QUADS * gpuQuadsChangedPercent / 100.0f);
+    for (uint32_t i = 0; i < gpuQuadsChanged; i++)
+    {
+        // rand only goes up to 32767 with msvc
+        uint32_t index = (((uint32_t)rand() << 15) | (uint32_t)rand()) % GPU_CULL_QUADS;
+        gpuQuads->UpdateQuad(gpuQuadHandles[index], MakeFieldQuad(index, gpuQuadsUpdateFrame));
+    }
+
+    std::chrono::duration<float, std::milli> updateTime = std::chrono::steady_clock::now() - start;
+    gpuQuadsUpdateMs = updateTime.count();
+
+    gpuQuads->Flush();
+
+    if (gpuCullBenchmarkFrame < 0)
+        return;
+
+    uint32_t pass = gpuCullBenchmarkFrame / GPU_CULL_BENCHMARK_FRAMES;
+    if (gpuCullBenchmarkFrame % GPU_CULL_BENCHMARK_FRAMES == 0)
+    {
+        gpuCullBenchmarkBytes[pass] = 0.0;
+        gpuCullBenchmarkRanges[pass] = 0.0;
+        gpuCullBenchmarkFlushMs[pass] = 0.0;
+    }
+
+    const QuadUploadStats& upload = gpuQuads->GetUploadStats();
+    gpuCullBenchmarkBytes[pass] += (double)upload.UploadBytes / GPU_CULL_BENCHMARK_FRAMES;
+    gpuCullBenchmarkRanges[pass] += (double)upload.Ranges / GPU_CULL_BENCHMARK_FRAMES;
+    gpuCullBenchmarkFlushMs[pass] += (double)upload.FlushMs / GPU_CULL_BENCHMARK_FRAMES;
+
+    gpuCullBenchmarkFrame++;
+    if (gpuCullBenchmarkFrame == 3 * GPU_CULL_BENCHMARK_FRAMES)
+    {
+        gpuQuadsChangedPercent = gpuCullBenchmarkSavedPercent;
+        gpuCullBenchmarkFrame = -1;
+    }
+}
+
+////////////////////////////////////////////////
+/////////////// IMPOSTORS //////////////////////
+////////////////////////////////////////////////
+
+// The checkerboard split into regions of IMPOSTOR_REGION_QUADS x IMPOSTOR_REGION_QUADS quads, every region
+// turns into one baked quad once it's smaller on screen than the threshold. The sweep moves the camera away from
+// the board over a couple hundred frames, once drawing everything and once with the impostors, to get the cost curves.
+
+constexpr uint32_t IMPOSTOR_REGION_QUADS = 50;
+constexpr uint32_t IMPOSTOR_RESOLUTION = 256;
+constexpr uint32_t IMPOSTOR_SWEEP_STEPS = 24;
+constexpr uint32_t IMPOSTOR_SWEEP_HOLD_FRAMES = 8; // per distance, the GPU timer comes back a few frames late
+constexpr float IMPOSTOR_SWEEP_NEAR = 5.0f;
+constexpr float IMPOSTOR_SWEEP_FAR = 2000.0f;
+
+ImpostorCache* impostors = nullptr;
+bool impostorsEnabled = false;
+float impostorThreshold = (float)IMPOSTOR_RESOLUTION;
+float checkerboardMs = 0.0f;
+
+// what the regions were built for, they're rebuilt when the board changes
+int32_t impostorBoardSize = 0;
+Vec3 impostorQuadScale = {};
+float impostorTilingFactor = 0.0f;
+
+int32_t impostorSweepFrame = -1; // -1 when it's not running
+Camera impostorSweepSavedCamera;
+bool impostorSweepSavedEnabled = false;
+float impostorSweepCpuMs[2][IMPOSTOR_SWEEP_STEPS] = {}; // [0] everything drawn, [1] with impostors
+float impostorSweepGpuMs[2][IMPOSTOR_SWEEP_STEPS] = {};
+float impostorSweepQuads[2][IMPOSTOR_SWEEP_STEPS] = {};
+
+// the board as the UI has it set up, the impostor regions draw their part of it with the same pattern
+CheckerboardDesc GetCheckerboardDesc()
+{
+    return { myTexture, checkerboardQuadScale, tilingFactor };
+}
+
+void CreateImpostorCache()
+{
+    Renderer2DConfig config;
+    config.MaxQuads = MAX_QUAD_BATCH;
+    config.ThreadCount = ThreadCount;
+    config.SubmissionContexts = 1;
+    config.FrameArenaSize = 1024 * 1024; // one region per scene
+    config.Backend = renderer->GetBackend();
+
+    impostors = new ImpostorCache(config, IMPOSTOR_RESOLUTION);
+}
+
+void CreateImpostorRegions()
+{
+    impostors->Clear();
+
+    uint32_t size = checherboardSize > 0 ? checherboardSize : 0;
+    Vec3 scale = checkerboardQuadScale;
+
+    for (uint32_t y0 = 0; y0 < size; y0 += IMPOSTOR_REGION_QUADS)
+    {
+        for (uint32_t x0 = 0; x0 < size; x0 += IMPOSTOR_REGION_QUADS)
         {
-            uint32_t vertexIndex = quadCount * 4;
+            uint32_t x1 = x0 + IMPOSTOR_REGION_QUADS < size ? x0 + IMPOSTOR_REGION_QUADS : size;
+            uint32_t y1 = y0 + IMPOSTOR_REGION_QUADS < size ? y0 + IMPOSTOR_REGION_QUADS : size;
 
-            glm::vec4 loc = QuadVertices[j];
-            glm::vec3 res = model * loc;
+            // quads are centered on their location
+            Vec3 min = { scale.X * (x0 - 0.5f), scale.Y * (y0 - 0.5f), 0.0f };
+            Vec3 max = { scale.X * (x1 - 0.5f), scale.Y * (y1 - 0.5f), 0.0f };
 
-            vertexData->Position = { res.x, res.y, res.z };
-            vertexData->Color = batchData->ColorTint;
-            vertexData->TextureCoordinates = quadTextCoords[j];
-            vertexData->TextureIndex = batchData->TextureIndex;
-            vertexData++;
+            impostors->AddRegion(min, max, [x0, y0, x1, y1](Renderer2D* target)
+            {
+                DrawCheckerboardRect(target, GetCheckerboardDesc(), x0, y0, x1, y1);
+            });
         }
+    }
 
-        batchData++;
+    impostorBoardSize = checherboardSize;
+    impostorQuadScale = scale;
+    impostorTilingFactor = tilingFactor;
+}
+
+// before the scene starts, the bakes go through the cache's own renderer
+void UpdateImpostors()
+{
+    bool boardChanged = impostorBoardSize != checherboardSize || impostorQuadScale.X != checkerboardQuadScale.X || impostorQuadScale.Y != checkerboardQuadScale.Y || impostorQuadScale.Z != checkerboardQuadScale.Z;
+    if (boardChanged)
+        CreateImpostorRegions();
+
+    // same regions, different contents
+    if (impostorTilingFactor != tilingFactor)
+    {
+        impostors->InvalidateAll();
+        impostorTilingFactor = tilingFactor;
     }
+
+    impostors->SetThreshold(impostorThreshold);
+    impostors->Update(cam, WndWidth, WndHeight);
 }
 
-void BuildVertexBuffer()
+// takes over the camera while it runs, right above the middle of the board looking straight at it
+void UpdateImpostorSweep()
 {
-    int32_t quadsPerThread = quadCount / ThreadCount;
-    TexturedQuad* batchData = quadBatch;
-    Vertex* vertexData = vertexBufferData;
+    if (impostorSweepFrame < 0)
+        return;
 
-    int32_t i;
-    for (i = 0; i < ThreadCount - 1; i++)
+    if (impostorSweepFrame == 0)
     {
-        threads[i] = std::async(std::launch::async, CalcVertices, batchData, vertexData, quadsPerThread);
+        impostorSweepSavedCamera = cam;
+        impostorSweepSavedEnabled = impostorsEnabled;
 
-        batchData += quadsPerThread;
-        vertexData += quadsPerThread * 4;
+        if (!impostors)
+            CreateImpostorCache();
     }
-    threads[i] = std::async(std::launch::async, CalcVertices, batchData, vertexData, quadCount - quadsPerThread * i);
 
-    for (int32_t j = 0; j < i + 1; j++)
+    uint32_t pass = impostorSweepFrame / (IMPOSTOR_SWEEP_STEPS * IMPOSTOR_SWEEP_HOLD_FRAMES);
+    uint32_t step = (impostorSweepFrame / IMPOSTOR_SWEEP_HOLD_FRAMES) % IMPOSTOR_SWEEP_STEPS;
+
+    // log spaced, the interesting part is where the regions go under the threshold one after the other
+    float distance = IMPOSTOR_SWEEP_NEAR * powf(IMPOSTOR_SWEEP_FAR / IMPOSTOR_SWEEP_NEAR, (float)step / (IMPOSTOR_SWEEP_STEPS - 1));
+
+    impostorsEnabled = pass == 1;
+    cam.Orthographic = false;
+    cam.Transform.Rotation = { 0.0f, 0.0f, 0.0f };
+    cam.Transform.Location =
+    {
+        (checherboardSize - 1) * checkerboardQuadScale.X * 0.5f,
+        (checherboardSize - 1) * checkerboardQuadScale.Y * 0.5f,
+        -distance
+    };
+}
+
+// after EndScene, cpu time is averaged over the second half of the frames spent at a distance
+void RecordImpostorSweep()
+{
+    if (impostorSweepFrame < 0)
+        return;
+
+    uint32_t pass = impostorSweepFrame / (IMPOSTOR_SWEEP_STEPS * IMPOSTOR_SWEEP_HOLD_FRAMES);
+    uint32_t step = (impostorSweepFrame / IMPOSTOR_SWEEP_HOLD_FRAMES) % IMPOSTOR_SWEEP_STEPS;
+    uint32_t frame = impostorSweepFrame % IMPOSTOR_SWEEP_HOLD_FRAMES;
+    const uint32_t measuredFrames = IMPOSTOR_SWEEP_HOLD_FRAMES / 2;
+
+    if (frame == 0)
+        impostorSweepCpuMs[pass][step] = 0.0f;
+
+    if (frame >= IMPOSTOR_SWEEP_HOLD_FRAMES - measuredFrames)
+        impostorSweepCpuMs[pass][step] += (checkerboardMs + endSceneMs) / measuredFrames;
+
+    if (frame == IMPOSTOR_SWEEP_HOLD_FRAMES - 1)
+    {
+        impostorSweepGpuMs[pass][step] = renderer->GetSceneTimeNs() / 1000000.0f;
+        impostorSweepQuads[pass][step] = (float)renderer->GetStats().QuadCount;
+    }
+
+    impostorSweepFrame++;
+    if (impostorSweepFrame == 2 * IMPOSTOR_SWEEP_STEPS * IMPOSTOR_SWEEP_HOLD_FRAMES)
     {
-        threads[j].wait();
+        cam = impostorSweepSavedCamera;
+        impostorsEnabled = impostorSweepSavedEnabled;
+        impostorSweepFrame = -1;
     }
 }
 
-void Flush()
+// both passes on the same scale so the curves can be compared at a glance
+void PlotImpostorSweep(const char* label, const float* full, const float* impostor)
 {
-    BuildVertexBuffer();
+    float scaleMax = 0.0f;
+    for (uint32_t i = 0; i < IMPOSTOR_SWEEP_STEPS; i++)
+    {
+        scaleMax = full[i] > scaleMax ? full[i] : scaleMax;
+        scaleMax = impostor[i] > scaleMax ? impostor[i] : scaleMax;
+    }
 
-    uint32_t indexCount = quadCount * 6;
+    std::string fullLabel = std::string(label) + " (all quads)";
+    std::string impostorLabel = std::string(label) + " (impostors)";
+    ImGui::PlotLines(fullLabel.c_str(), full, IMPOSTOR_SWEEP_STEPS, 0, nullptr, 0.0f, scaleMax, ImVec2(0.0f, 50.0f));
+    ImGui::PlotLines(impostorLabel.c_str(), impostor, IMPOSTOR_SWEEP_STEPS, 0, nullptr, 0.0f, scaleMax, ImVec2(0.0f, 50.0f));
+}
 
-    shader->SetUniformMat4("u_View", 1, glm::value_ptr(view), false);
-    shader->SetUniformMat4("u_Proj", 1, glm::value_ptr(proj), false);
+////////////////////////////////////////////////
+/////////////// LAYERS /////////////////////////
+////////////////////////////////////////////////
+
+// A background and a HUD panel from their own renderer, both cached in render layers. The background is tens of
+// thousands of small quads that only change with the window size or the tint, the HUD is a frame time graph
+// refreshed twice a second. Both are composited every frame, redrawing them every frame shows what they'd cost otherwise.
+
+constexpr float LAYER_BACKGROUND_CELL = 8.0f; // pixels
+constexpr uint32_t LAYER_HUD_BARS = 64;
+constexpr float LAYER_HUD_REFRESH = 0.5f; // seconds
+
+Renderer2D* layerRenderer = nullptr;
+RenderLayer* backgroundLayer = nullptr;
+RenderLayer* hudLayer = nullptr;
+bool layersEnabled = false;
+bool layersRedrawEveryFrame = false;
+Vec3 layerBackgroundTint = { 0.3f, 0.35f, 0.5f };
+float layerHudFrameMs[LAYER_HUD_BARS] = {}; // ring, oldest at layerHudNext
+uint32_t layerHudNext = 0;
+float layerHudRefreshTime = 0.0f;
+float layersMs = 0.0f;
+
+void CreateLayers()
+{
+    Renderer2DConfig config;
+    config.MaxQuads = MAX_QUAD_BATCH;
+    config.ThreadCount = ThreadCount;
+    config.SubmissionContexts = 1;
+
+    layerRenderer = new Renderer2D(config);
+    backgroundLayer = new RenderLayer("Background", WndWidth, WndHeight);
+    hudLayer = new RenderLayer("HUD", WndWidth, WndHeight);
+}
 
-    vBuffer->SetData((float*)vertexBufferData, sizeof(Vertex) * 4 * quadCount, 0);
+// pixels from the bottom left corner of the window
+Camera GetLayerCamera()
+{
+    Camera layerCamera;
+    layerCamera.FOV = 60.0f;
+    layerCamera.AspectRatio = (float)WndWidth / WndHeight;
+    layerCamera.Orthographic = true;
+    layerCamera.OrthographicHeight = (float)WndHeight;
+    layerCamera.Transform = { { WndWidth * 0.5f, WndHeight * 0.5f, -1.0f }, { 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f } };
+    return layerCamera;
+}
 
-    BindAllTextures();
+void DrawLayerBackground()
+{
+    uint32_t columns = (uint32_t)(WndWidth / LAYER_BACKGROUND_CELL) + 1;
+    uint32_t rows = (uint32_t)(WndHeight / LAYER_BACKGROUND_CELL) + 1;
 
-    glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, nullptr);
+    Transform cell = { {}, { 0.0f, 0.0f, 0.0f }, { LAYER_BACKGROUND_CELL - 1.0f, LAYER_BACKGROUND_CELL - 1.0f, 1.0f } };
 
-    quadCount = 0;
-    ClearTextures();
+    for (uint32_t y = 0; y < rows; y++)
+    {
+        for (uint32_t x = 0; x < columns; x++)
+        {
+            float fx = (float)x / columns;
+            float fy = (float)y / rows;
 
-    drawCalls++;
+            cell.Location = { (x + 0.5f) * LAYER_BACKGROUND_CELL, (y + 0.5f) * LAYER_BACKGROUND_CELL, 0.0f };
+            layerRenderer->DrawQuad(cell, { layerBackgroundTint.X * (0.5f + 0.5f * fx), layerBackgroundTint.Y * (0.5f + 0.5f * fy), layerBackgroundTint.Z });
+        }
+    }
 }
 
-void PushTexturedQuad(const TexturedQuad& quad)
+// top right corner, one bar per frame and a line at 16.7 ms
+void DrawLayerHud()
 {
-    memcpy(quadBatch + quadCount, &quad, sizeof(TexturedQuad));
+    const float barWidth = 4.0f;
+    const float graphHeight = 100.0f;
+    const float padding = 4.0f;
+    const float maxMs = 33.3f;
+
+    float panelWidth = LAYER_HUD_BARS * barWidth + padding * 2.0f;
+    float panelHeight = graphHeight + padding * 2.0f;
+    float left = WndWidth - panelWidth - 10.0f;
+    float bottom = WndHeight - panelHeight - 10.0f;
+
+    layerRenderer->DrawQuad({ { left + panelWidth * 0.5f, bottom + panelHeight * 0.5f, 0.0f }, { 0.0f, 0.0f, 0.0f }, { panelWidth, panelHeight, 1.0f } }, { 0.1f, 0.1f, 0.12f });
+
+    // a bit closer than the panel, so the depth test doesn't throw them away
+    for (uint32_t i = 0; i < LAYER_HUD_BARS; i++)
+    {
+        float ms = layerHudFrameMs[(layerHudNext + i) % LAYER_HUD_BARS];
+        float height = (ms < maxMs ? ms / maxMs : 1.0f) * graphHeight;
+        Vec3 color = ms < 16.7f ? Vec3{ 0.2f, 0.8f, 0.3f } : (ms < maxMs ? Vec3{ 0.9f, 0.8f, 0.2f } : Vec3{ 0.9f, 0.2f, 0.2f });
+
+        if (height > 0.0f)
+            layerRenderer->DrawQuad({ { left + padding + (i + 0.5f) * barWidth, bottom + padding + height * 0.5f, -0.1f }, { 0.0f, 0.0f, 0.0f }, { barWidth - 1.0f, height, 1.0f } }, color);
+    }
+
+    layerRenderer->DrawQuad({ { left + panelWidth * 0.5f, bottom + padding + graphHeight * 16.7f / maxMs, -0.2f }, { 0.0f, 0.0f, 0.0f }, { panelWidth - padding * 2.0f, 1.0f, 1.0f } }, { 0.8f, 0.8f, 0.8f });
 }
 
-void DrawQuad(Transform transform, Vec3 color)
+// after the world clears and before its scene, so the world draws over it
+void DrawBackgroundLayer()
 {
-    TexturedQuad desc;
-    desc.Transform = transform;
-    desc.TextureIndex = 0.0f; // white texture
-    desc.TilingFactor = 1.0f;
-    desc.ColorTint = color;
+    if (layersRedrawEveryFrame)
+        backgroundLayer->Invalidate();
 
-    PushTexturedQuad(desc);
+    if (layerRenderer->BeginScene(GetLayerCamera(), backgroundLayer))
+        DrawLayerBackground();
+    layerRenderer->EndScene();
+}
 
-    quadCount++;
-    totalQuadCount++;
+void DrawHudLayer()
+{
+    layerHudFrameMs[layerHudNext] = deltaTime * 1000.0f;
+    layerHudNext = (layerHudNext + 1) % LAYER_HUD_BARS;
 
-    if (quadCount == MaxQuads)
+    if (layersRedrawEveryFrame || totalTime - layerHudRefreshTime >= LAYER_HUD_REFRESH)
     {
-        Flush();
+        hudLayer->Invalidate();
+        layerHudRefreshTime = totalTime;
     }
+
+    if (layerRenderer->BeginScene(GetLayerCamera(), hudLayer))
+        DrawLayerHud();
+    layerRenderer->EndScene();
 }
 
-void DrawQuadTextured(const Transform& transform, Texture* texture, float tilingFactor = 1.0f, Vec3 colorTint = { 1.0f, 1.0f, 1.0f })
+////////////////////////////////////////////////
+/////////////// DEPTH SORT /////////////////////
+////////////////////////////////////////////////
+
+// Layers of quads stacked in front of each other and submitted back to front, the worst case for overdraw.
+// With the depth sort on only the nearest layer should get shaded, the fragment invocations show how close it gets.
+
+constexpr uint32_t OVERDRAW_GRID = 10;
+constexpr float OVERDRAW_QUAD_SIZE = 2.0f;
+constexpr float OVERDRAW_LAYER_SPACING = 0.02f; // 200 layers stay in front of the default camera
+
+int32_t overdrawLayers = 0;
+float overdrawMs = 0.0f;
+
+void DrawOverdrawStack()
 {
-    float textureLoc = FindTexture(texture);
-    if (textureLoc == -1)
+    for (int32_t layer = 0; layer < overdrawLayers; layer++)
     {
-        PushTexture(texture);
-        textureLoc = textureIndex - 1;
+        // layer 0 is the farthest, the camera looks down +Z
+        float z = -0.5f - layer * OVERDRAW_LAYER_SPACING;
+        Vec3 color = { 0.3f + (layer % 4) * 0.2f, 0.3f, 1.0f - (layer % 3) * 0.3f };
+
+        for (uint32_t i = 0; i < OVERDRAW_GRID * OVERDRAW_GRID; i++)
+        {
+            Transform transform;
+            transform.Location = { -15.0f + (i % OVERDRAW_GRID) * OVERDRAW_QUAD_SIZE, -15.0f + (i / OVERDRAW_GRID) * OVERDRAW_QUAD_SIZE, z };
+            transform.Rotation = { 0.0f, 0.0f, 0.0f };
+            transform.Scale = { OVERDRAW_QUAD_SIZE, OVERDRAW_QUAD_SIZE, 1.0f };
+
+            if (layer % 2)
+                renderer->DrawQuadTextured(transform, myTexture, 1.0f, color);
+            else
+                renderer->DrawQuad(transform, color);
+        }
     }
+}
+
+////////////////////////////////////////////////
+/////////////// OVERDRAW VIEW //////////////////
+////////////////////////////////////////////////
+
+// Swaps the frame for the overdraw heatmap of the world scene, the recording averages a few seconds of it into a JSON file.
+
+constexpr uint32_t OVERDRAW_RECORD_FRAMES = 120;
+const char* OVERDRAW_RECORD_PATH = "overdraw.json";
+
+OverdrawView* overdrawView = nullptr;
+bool overdrawViewEnabled = false;
+int32_t overdrawScale = 8;
+int32_t overdrawRecordFrame = -1; // -1 when not recording
+std::vector<OverdrawStats> overdrawRecording;
+bool overdrawRecordWritten = false;
+
+void CreateOverdrawView()
+{
+    Renderer2DConfig config;
+    config.MaxQuads = 16;
+    config.TextureSlots = 2;
+    config.ThreadCount = 1;
+    config.SubmissionContexts = 1;
+    config.Backend = renderer->GetBackend(); // doesn't create anything with the software one
+
+    overdrawView = new OverdrawView(config, WndWidth, WndHeight);
+}
+
+void RecordOverdraw()
+{
+    if (overdrawRecordFrame < 0)
+        return;
+
+    overdrawRecording.push_back(overdrawView->GetStats());
+
+    if (++overdrawRecordFrame < (int32_t)OVERDRAW_RECORD_FRAMES)
+        return;
+
+    overdrawRecordWritten = WriteOverdrawJSON(OVERDRAW_RECORD_PATH, tilemapEnabled ? "tilemap" : "checkerboard", overdrawRecording);
+    overdrawRecordFrame = -1;
+}
+
+////////////////////////////////////////////////
+/////////////// OVERLAY ////////////////////////
+////////////////////////////////////////////////
+
+// A second renderer with its own small batch and shaders, drawn over the world with a fixed camera.
+// Nothing it draws shares a batch with the world, so it doesn't change how the world batches either.
+
+Renderer2D* overlayRenderer = nullptr;
+bool overlayEnabled = false;
+
+void CreateOverlayRenderer()
+{
+    Renderer2DConfig config;
+    config.MaxQuads = 1000;
+    config.TextureSlots = 4;
+    config.ThreadCount = 1;
+    config.SubmissionContexts = 1;
+
+    overlayRenderer = new Renderer2D(config);
+}
+
+// crosshair in the middle of the screen
+void DrawOverlay()
+{
+    Camera overlayCamera;
+    overlayCamera.FOV = 60.0f;
+    overlayCamera.AspectRatio = (float)WndWidth / WndHeight;
+    overlayCamera.Transform = { { 0.0f, 0.0f, -5.0f }, { 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f } };
+
+    Vec3 color = { 1.0f, 1.0f, 1.0f };
+
+    overlayRenderer->ClearDepth();
+    overlayRenderer->BeginScene(overlayCamera);
 
-    TexturedQuad desc;
-    desc.Transform = transform;
-    desc.TextureIndex = textureLoc;
-    desc.TilingFactor = tilingFactor;
-    desc.ColorTint = colorTint;
+    overlayRenderer->DrawCircle({ 0.0f, 0.0f, 0.0f }, 0.08f, color, 0.015f);
+    overlayRenderer->DrawLine({ -0.2f, 0.0f, 0.0f }, { -0.1f, 0.0f, 0.0f }, 0.015f, color);
+    overlayRenderer->DrawLine({ 0.1f, 0.0f, 0.0f }, { 0.2f, 0.0f, 0.0f }, 0.015f, color);
+    overlayRenderer->DrawLine({ 0.0f, -0.2f, 0.0f }, { 0.0f, -0.1f, 0.0f }, 0.015f, color);
+    overlayRenderer->DrawLine({ 0.0f, 0.1f, 0.0f }, { 0.0f, 0.2f, 0.0f }, 0.015f, color);
 
-    PushTexturedQuad(desc);
+    overlayRenderer->EndScene();
+}
+
+////////////////////////////////////////////////
+/////////////// ON DEMAND //////////////////////
+////////////////////////////////////////////////
+
+// With on demand rendering a frame is only rendered when something could have changed it: input (which is all ImGui
+// reacts to), a resize, or anything that animates by itself. Otherwise the loop blocks in glfwWaitEventsTimeout, and
+// when the window has to be repainted without anything changing, the copy of the last frame is presented again.
+// The default scene never stops by itself (the main quad spins and particles keep coming), so switching it on pauses
+// both and switching it off brings them back; the particles still alive burn out within their lifetime.
+// CPU use is measured over one second windows, the windows without any input are the idle numbers.
+
+constexpr double ON_DEMAND_WAIT_TIMEOUT = 0.25; // seconds, the loop wakes up now and then anyway
+constexpr uint32_t ON_DEMAND_SETTLE_FRAMES = 3; // rendered after the last input, ImGui needs a couple to settle hover states
+constexpr double CPU_USAGE_WINDOW = 1.0;
+
+bool onDemandEnabled = false;
+uint32_t onDemandFramesLeft = ON_DEMAND_SETTLE_FRAMES;
+bool onDemandRepaint = false; // the window asked to be repainted
+RenderTarget* onDemandLastFrame = nullptr; // the whole window, ImGui included
+float onDemandSavedRotPerSec = 0.0f;
+int32_t onDemandSavedEmitRate = 0;
+
+// per second, from the last full window
+uint32_t onDemandFrameCounts[3] = {}; // counting: rendered, presented again, woken up for nothing
+uint32_t onDemandFrameRates[3] = {};
+
+double cpuUsageWindowStart = -1.0;
+double cpuUsageWindowCpuTime = 0.0;
+bool cpuUsageWindowInput = false;
+float cpuUsagePercent = 0.0f; // of one core
+float idleCpuUsagePercent[2] = { -1.0f, -1.0f }; // rendering continuously, on demand
+
+// anything that changes the picture, called from the input callbacks
+void InvalidateFrame()
+{
+    onDemandFramesLeft = ON_DEMAND_SETTLE_FRAMES;
+    cpuUsageWindowInput = true;
+}
+
+void OnWindowRefresh(GLFWwindow* window)
+{
+    onDemandRepaint = true;
+}
+
+void OnKey(GLFWwindow* window, int key, int scancode, int action, int mods) { InvalidateFrame(); }
+void OnChar(GLFWwindow* window, unsigned int codepoint) { InvalidateFrame(); }
+void OnMouseButton(GLFWwindow* window, int button, int action, int mods) { InvalidateFrame(); }
+void OnCursorPos(GLFWwindow* window, double x, double y) { InvalidateFrame(); }
+void OnCursorEnter(GLFWwindow* window, int entered) { InvalidateFrame(); }
+void OnWindowFocus(GLFWwindow* window, int focused) { InvalidateFrame(); }
 
-    quadCount++;
-    totalQuadCount++;
+void SetOnDemand(bool enabled)
+{
+    onDemandEnabled = enabled;
 
-    if (quadCount == MaxQuads || textureIndex == MAX_TEXTURE_SLOTS)
+    if (enabled)
     {
-        Flush();
+        onDemandSavedRotPerSec = rotPerSec;
+        onDemandSavedEmitRate = particleEmitRate;
+        rotPerSec = 0.0f;
+        particleEmitRate = 0;
+        return;
     }
+
+    // whatever was set again in the meantime stays
+    if (rotPerSec == 0.0f)
+        rotPerSec = onDemandSavedRotPerSec;
+    if (particleEmitRate == 0)
+        particleEmitRate = onDemandSavedEmitRate;
+
+    delete onDemandLastFrame;
+    onDemandLastFrame = nullptr;
 }
 
-void EndScene()
+// why the scene can't wait, nullptr when it can
+const char* GetAnimationReason()
 {
-    if (quadCount > 0 || textureIndex > 1)
-        Flush();
+    if (rotPerSec != 0.0f)
+        return "main quad rotation";
+    if (particleEmitRate > 0 || particles->GetCount() > 0)
+        return "particles";
+    if (sprite2DCount > 0 || parallelSpriteCount > 0)
+        return "animated sprites";
+    if (spatialEnabled && spatialMovesPerFrame > 0)
+        return "spatial index moves";
+    if (gpuCullEnabled && (gpuQuadsChangedPercent > 0.0f || gpuCullBenchmarkFrame >= 0))
+        return "GPU quad updates";
+    if (sceneGraphEnabled && sceneGraphMovedPercent > 0.0f)
+        return "scene graph moves";
+    if (layersEnabled && layersRedrawEveryFrame)
+        return "layers redrawn every frame";
+    if (impostorSweepFrame >= 0 || overdrawRecordFrame >= 0)
+        return "recording";
+
+    // held keys and buttons don't send events while they're down
+    static const int cameraKeys[] = { GLFW_KEY_W, GLFW_KEY_A, GLFW_KEY_S, GLFW_KEY_D, GLFW_KEY_Q, GLFW_KEY_E };
+    for (int key : cameraKeys)
+    {
+        if (glfwGetKey(window, key) == GLFW_PRESS)
+            return "camera movement";
+    }
 
 #if USE_IMGUI
-    ImGuiRender();
-    ImGui::Render();
-    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    if (ImGui::IsAnyItemActive())
+        return "ImGui item active";
 #endif
 
-    totalQuadCount = 0;
-    totalTextures = 1; // white texture
+    return nullptr;
+}
 
-    glfwSwapBuffers(window);
+bool NeedsFrame()
+{
+    return onDemandFramesLeft > 0 || GetAnimationReason() != nullptr;
 }
 
-float totalTime = 0.0f;
-float deltaTime = 0.0f;
+// last frame's back buffer, right before it's swapped
+void CopyLastFrame()
+{
+    // minimized, there's nothing to copy and a 0 sized target can't be made
+    if (!onDemandEnabled || WndWidth <= 0 || WndHeight <= 0)
+        return;
 
-float rotPerSec = 50.0f;
-float tilingFactor = 1.0f;
+    if (!onDemandLastFrame || onDemandLastFrame->GetWidth() != (uint32_t)WndWidth || onDemandLastFrame->GetHeight() != (uint32_t)WndHeight)
+    {
+        delete onDemandLastFrame;
+        onDemandLastFrame = new RenderTarget(WndWidth, WndHeight);
+    }
 
-float cameraMoveSpeed = 3.0f;
-float cameraScroolMultiplier = 100.0f;
-float mouseSens = 0.2f;
+    uint32_t framebufferID = onDemandLastFrame->GetFramebufferID();
+    int32_t width = WndWidth;
+    int32_t height = WndHeight;
+    RenderThread::Run([framebufferID, width, height]()
+    {
+        glBlitNamedFramebuffer(0, framebufferID, 0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    });
+}
 
-Transform mainQuadTransform = { { 0.0f, 0.0f, -0.2f }, { 0.0f, 0.0f, 0.0f }, { 1.5f, 1.5f, 1.0f} };
-Vec3 mainQuadColor = { 0.2f, 0.92f, 0.52f };
-Vec3 checkerboardQuadScale = { 1.0f, 1.0f, 1.0f };
+void PresentLastFrame()
+{
+    if (!onDemandLastFrame || WndWidth <= 0 || WndHeight <= 0)
+        return;
+
+    uint32_t framebufferID = onDemandLastFrame->GetFramebufferID();
+    int32_t width = onDemandLastFrame->GetWidth();
+    int32_t height = onDemandLastFrame->GetHeight();
+    RenderThread::Run([framebufferID, width, height]()
+    {
+        glBlitNamedFramebuffer(framebufferID, 0, 0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glfwSwapBuffers(window);
+    });
+
+    if (renderThread)
+        renderThread->EndFrame();
+}
+
+// user + kernel time of the whole process in seconds, render thread and workers included
+double GetProcessCpuTime()
+{
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (!GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime))
+        return 0.0;
+
+    uint64_t kernel = ((uint64_t)kernelTime.dwHighDateTime << 32) | kernelTime.dwLowDateTime;
+    uint64_t user = ((uint64_t)userTime.dwHighDateTime << 32) | userTime.dwLowDateTime;
+    return (kernel + user) * 100e-9;
+}
+
+// once per trip through the loop, whether it rendered or not
+void UpdateCpuUsage()
+{
+    double now = GetTime();
+    if (cpuUsageWindowStart < 0.0)
+    {
+        cpuUsageWindowStart = now;
+        cpuUsageWindowCpuTime = GetProcessCpuTime();
+        cpuUsageWindowInput = false;
+        return;
+    }
 
-Texture* myTexture;
+    double elapsed = now - cpuUsageWindowStart;
+    if (elapsed < CPU_USAGE_WINDOW)
+        return;
 
-Camera cam;
+    double cpuTime = GetProcessCpuTime();
+    cpuUsagePercent = (float)((cpuTime - cpuUsageWindowCpuTime) / elapsed * 100.0);
+    if (!cpuUsageWindowInput)
+        idleCpuUsagePercent[onDemandEnabled ? 1 : 0] = cpuUsagePercent;
+
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        onDemandFrameRates[i] = (uint32_t)(onDemandFrameCounts[i] / elapsed + 0.5);
+        onDemandFrameCounts[i] = 0;
+    }
+
+    cpuUsageWindowStart = now;
+    cpuUsageWindowCpuTime = cpuTime;
+    cpuUsageWindowInput = false;
+}
 
 float imguiPanelWidth = -1.0f;
 
@@ -537,10 +1392,7 @@ void ImGuiRender()
         {
             ImGui::PushItemWidth(200);
             
-            if (ImGui::ColorPicker3("Background color", &clearColor.X, 0))
-            {
-                glClearColor(clearColor.X, clearColor.Y, clearColor.Z, 1.0f);
-            }
+            ImGui::ColorPicker3("Background color", &clearColor.X, 0);
         }
     );
 
@@ -561,6 +1413,8 @@ void ImGuiRender()
             ImGui::DragFloat3("C_Location", &cam.Transform.Location.X, 0.01f);
             ImGui::DragFloat3("C_Rotation", &cam.Transform.Rotation.X, 0.01f);
             ImGui::DragFloat("C_FOV", &cam.FOV, .01f, 0.01f, 1000.0f, "%.3f");
+            ImGui::Checkbox("C_Orthographic", &cam.Orthographic);
+            ImGui::DragFloat("C_OrthographicHeight", &cam.OrthographicHeight, .01f, 0.01f, 10000.0f, "%.3f");
         }
     );
 
@@ -571,7 +1425,122 @@ void ImGuiRender()
             ImGui::DragInt("Checherboard size", &checherboardSize, 0.01f);
             ImGui::DragFloat3("Checherboard quad scale", &checkerboardQuadScale.X, 0.01f);
             ImGui::DragFloat("Rotation speed (deg/s)", &rotPerSec, 0.01f);
+            if (ImGui::Checkbox("VSync", &VSync))
+            {
+                bool vsync = VSync;
+                RenderThread::Run([vsync]()
+                {
+                    glfwSwapInterval(vsync);
+                });
+            }
+            if (ImGui::SliderInt("Max frames in flight (0 = driver)", &maxFramesInFlight, 0, 4))
+                framePacer->SetMaxFramesInFlight(maxFramesInFlight);
+            if (ImGui::SliderFloat("Frame rate cap (0 = off)", &targetFrameRate, 0.0f, 240.0f, "%.0f"))
+                framePacer->SetTargetFrameRate(targetFrameRate);
+            bool onDemand = onDemandEnabled;
+            if (ImGui::Checkbox("Render on demand (only when something changed, pauses rotation and particles)", &onDemand))
+                SetOnDemand(onDemand);
             ImGui::DragFloat("Texture tiling factor", &tilingFactor, 0.5f);
+            bool alphaTest = renderer->GetAlphaTest();
+            if (ImGui::Checkbox("Alpha test textures", &alphaTest))
+                renderer->SetAlphaTest(alphaTest);
+            if (renderer->GetBackend() == RendererBackend::OpenGL)
+            {
+                ImGui::Checkbox("Render thread", &renderThreadEnabled);
+                ImGui::SliderInt("Max queued frames", &MaxQueuedFrames, 1, 3);
+                if (ImGui::Checkbox("Overlay (second renderer)", &overlayEnabled) && overlayEnabled && !overlayRenderer)
+                {
+                    CreateOverlayRenderer();
+                }
+                if (ImGui::Checkbox("Cached layers (background + HUD)", &layersEnabled) && layersEnabled && !layerRenderer)
+                {
+                    CreateLayers();
+                }
+                ImGui::Checkbox("Redraw layers every frame", &layersRedrawEveryFrame);
+                if (ImGui::ColorEdit3("Background layer tint", &layerBackgroundTint.X) && backgroundLayer)
+                    backgroundLayer->Invalidate();
+            }
+            if (font)
+            {
+                ImGui::SliderInt("Text benchmark glyphs", &textBenchmarkGlyphs, 0, 100000);
+                ImGui::Checkbox("SDF text", &textBenchmarkSdf);
+                SdfTextStyle sdfStyle = renderer->GetSdfStyle();
+                ImGui::DragFloat("SDF outline (texels)", &sdfStyle.OutlineWidth, 0.05f, 0.0f, (float)Font::SdfPadding);
+                ImGui::DragFloat("SDF shadow offset (texels)", &sdfStyle.ShadowOffset, 0.05f, 0.0f, (float)Font::SdfPadding);
+                renderer->SetSdfStyle(sdfStyle);
+            }
+            if (ImGui::Checkbox("Tilemap 4096x4096 (instead of the checkerboard)", &tilemapEnabled) && tilemapEnabled && !tilemap)
+            {
+                CreateTilemap();
+            }
+            ImGui::SliderInt("Tilemap edits per frame", &tilemapEditsPerFrame, 0, 10000);
+            if (ImGui::Checkbox("Checkerboard impostors", &impostorsEnabled) && impostorsEnabled && !impostors)
+            {
+                CreateImpostorCache();
+            }
+            ImGui::DragFloat("Impostor threshold (px)", &impostorThreshold, 1.0f, 0.0f, 4096.0f);
+            if (!tilemapEnabled && impostorSweepFrame < 0 && ImGui::Button("Run impostor distance sweep"))
+                impostorSweepFrame = 0;
+            if (ImGui::Checkbox("Scene graph (100k nodes)", &sceneGraphEnabled) && sceneGraphEnabled && !sceneGraph)
+            {
+                CreateSceneGraph();
+            }
+            ImGui::SliderFloat("Scene graph nodes moved (%)", &sceneGraphMovedPercent, 0.0f, 100.0f);
+            if (ImGui::Checkbox("Spatial index (1M quads, left click picks)", &spatialEnabled) && spatialEnabled && !spatialIndex)
+            {
+                CreateSpatialIndex();
+            }
+            ImGui::SliderInt("Spatial index moves per frame", &spatialMovesPerFrame, 0, 100000);
+            if (renderer->GetBackend() == RendererBackend::OpenGL && GpuQuadCuller::IsSupported())
+            {
+                if (ImGui::Checkbox("GPU culled quads (1M, compute shader)", &gpuCullEnabled) && gpuCullEnabled && !gpuCuller)
+                {
+                    CreateGpuCuller();
+                }
+                if (gpuCullEnabled)
+                {
+                    ImGui::SliderFloat("GPU quads changed per frame (%)", &gpuQuadsChangedPercent, 0.0f, 10.0f);
+                    if (ImGui::SliderInt("GPU quads upload merge gap (slots)", &gpuQuadsMergeGap, 0, 64))
+                        gpuQuads->SetMergeGap(gpuQuadsMergeGap);
+                    if (gpuCullBenchmarkFrame < 0 && ImGui::Button("Run retained update benchmark (0.1%, 1%, 10% changed)"))
+                        gpuCullBenchmarkFrame = 0;
+                }
+            }
+            if (spatialIndex && ImGui::Button("Rebuild spatial index"))
+                RebuildSpatialIndex();
+            ImGui::Checkbox("Scene graph full update", &sceneGraphFullUpdate);
+            ImGui::SliderInt("Particles per second", &particleEmitRate, 0, MAX_PARTICLES);
+            ImGui::DragFloat("Particle lifetime (s)", &particleLifeTime, 0.01f, 0.01f, 60.0f);
+            ImGui::DragFloat("Particle size", &particleSize, 0.001f, 0.001f, 1.0f);
+            ImGui::DragFloat3("Particle gravity", &particleGravity.X, 0.01f);
+            ImGui::SliderInt("Debug shapes", &debugShapeCount, 0, 100000);
+            ImGui::SliderInt("Parallel sprites", &parallelSpriteCount, 0, 1000000);
+            ImGui::SliderInt("Submitting threads", &parallelSubmitThreads, 1, MAX_SUBMISSION_CONTEXTS);
+            ImGui::SliderInt("Sprites 2D", &sprite2DCount, 0, 1000000);
+            ImGui::Checkbox("Sprites 2D through DrawQuadTextured", &sprite2DAsQuads);
+            bool sortSubmissions = renderer->GetSortSubmissions();
+            if (ImGui::Checkbox("Sort submissions by texture", &sortSubmissions))
+                renderer->SetSortSubmissions(sortSubmissions);
+            bool depthSort = renderer->GetDepthSort();
+            if (ImGui::Checkbox("Depth sort (opaque front to back)", &depthSort))
+                renderer->SetDepthSort(depthSort);
+            ImGui::SliderInt("Overdraw stack layers", &overdrawLayers, 0, 200);
+            if (ImGui::Checkbox("Overdraw heatmap", &overdrawViewEnabled) && overdrawViewEnabled && !overdrawView)
+            {
+                CreateOverdrawView();
+            }
+            if (overdrawView && ImGui::SliderInt("Overdraw heatmap scale (red)", &overdrawScale, 1, 64))
+                overdrawView->SetScale(overdrawScale);
+            if (overdrawViewEnabled && renderer->GetBackend() == RendererBackend::OpenGL && overdrawRecordFrame < 0 && ImGui::Button("Record overdraw to overdraw.json"))
+            {
+                overdrawRecording.clear();
+                overdrawRecordWritten = false;
+                overdrawRecordFrame = 0;
+            }
+            if (ImGui::Button("Run submission scaling benchmark (1-32 threads)"))
+                runSubmissionScaling = true;
+            if (ImGui::Button("Run math benchmark"))
+                runMathBenchmark = true;
             ImGui::DragFloat("Camera speed (units/s)", &cameraMoveSpeed, 0.01f);
             ImGui::DragFloat("Camera scroll multiplier", &cameraScroolMultiplier, 0.01f);
             ImGui::DragFloat("Mouse sensitivity", &mouseSens, 0.01f);
@@ -582,14 +1551,212 @@ void ImGuiRender()
     (
         "Info",
         {
-            ImGui::Text((char*)glGetString(GL_VENDOR));
-            ImGui::Text((char*)glGetString(GL_RENDERER));
-            ImGui::Text((char*)glGetString(GL_VERSION));
+            const Renderer2DStats& stats = renderer->GetStats();
+
+            ImGui::Text("%s", glVendor.c_str());
+            ImGui::Text("%s", glRenderer.c_str());
+            ImGui::Text("%s", glVersion.c_str());
             ImGui::Spacing();
             ImGui::Text("Frametime: %.3f ms (%i FPS )", deltaTime * 1000, (int32_t)(1.0f / deltaTime));
-            ImGui::Text("Draw calls: %i", drawCalls);
-            ImGui::Text("Quad count: %i", totalQuadCount);
-            ImGui::Text("Texture count: %i", totalTextures);
+            ImGui::Text("Input to present: %.3f ms", inputLatencyMs.load());
+            ImGui::Text("Frame interval: %.3f ms, %.3f ms jitter (%.3f ms worst), %.3f ms paced sleep", framePacer->GetIntervalMs(), framePacer->GetJitterMs(), framePacer->GetMaxDeviationMs(), framePacer->GetSleepMs());
+            ImGui::Text("  %i frames in flight, CPU ahead of the GPU by %.3f ms, %.3f ms waiting on the fence", framePacer->GetFramesInFlight(), framePacer->GetCpuAheadMs(), framePacer->GetFenceWaitMs());
+            ImGui::Text("CPU: %.1f%% of a core, idle %.1f%% rendering continuously, %.1f%% on demand (-1 = not measured yet)", cpuUsagePercent, idleCpuUsagePercent[0], idleCpuUsagePercent[1]);
+            if (onDemandEnabled)
+            {
+                const char* reason = GetAnimationReason();
+                ImGui::Text("  On demand: %i rendered, %i presented again, %i woken up for nothing per second", onDemandFrameRates[0], onDemandFrameRates[1], onDemandFrameRates[2]);
+                ImGui::Text("  Can't idle: %s", reason ? reason : "-");
+            }
+            if (renderThread)
+            {
+                ImGui::Text("Render thread: %.3f ms executing %i commands, game waited %.3f ms", renderThread->GetExecuteTimeMs(), renderThread->GetRecordedCommands(), renderThread->GetWaitTimeMs());
+            }
+            ImGui::Text("Draw calls: %i", stats.DrawCalls);
+            if (overlayEnabled)
+            {
+                ImGui::Text("Overlay draw calls: %i (%i quads)", overlayRenderer->GetStats().DrawCalls, overlayRenderer->GetStats().QuadCount);
+            }
+            ImGui::Text("Quad count: %i", stats.QuadCount);
+            if (layersEnabled)
+            {
+                ImGui::Text("Layers: %.3f ms to record", layersMs);
+                for (RenderLayer* layer : { backgroundLayer, hudLayer })
+                {
+                    ImGui::Text("  %s: %i invalidations, %i redraws, %i composites", layer->GetName().c_str(), layer->GetInvalidationCount(), layer->GetRedrawCount(), layer->GetCompositeCount());
+                }
+            }
+            ImGui::Text("Texture count: %i", stats.TextureCount);
+            ImGui::Text("Frame arena: %.1f KB used, %.1f KB high water, %.1f KB x %i frames%s", stats.FrameArenaUsed / 1024.0f, stats.FrameArenaHighWater / 1024.0f, stats.FrameArenaCapacity / 1024.0f, stats.FrameArenaCount, stats.FrameArenaLargePages ? " (large pages)" : "");
+            if (stats.FrameArenaOverflows > 0)
+            {
+                ImGui::Text("  %i overflow blocks, grows on the next reset", stats.FrameArenaOverflows);
+            }
+            ImGui::Text("GPU scene time: %.3f ms", renderer->GetSceneTimeNs() / 1000000.0);
+            if (font)
+            {
+                const GlyphAtlas& bitmapAtlas = font->GetBitmapAtlasInfo();
+                const GlyphAtlas& sdfAtlas = font->GetSdfAtlasInfo();
+
+                ImGui::Text("Glyphs: %i (%.3f ms to submit)", stats.GlyphCount, textBenchmarkMs);
+                ImGui::Text("  Bitmap atlas: %i glyphs, %.1f KB used, %i resets", (int32_t)bitmapAtlas.Glyphs.size(), bitmapAtlas.GetUsedBytes() / 1024.0f, bitmapAtlas.Resets);
+                ImGui::Text("  SDF atlas: %i glyphs, %.1f KB used, %i resets", (int32_t)sdfAtlas.Glyphs.size(), sdfAtlas.GetUsedBytes() / 1024.0f, sdfAtlas.Resets);
+            }
+            if (tilemapEnabled)
+            {
+                ImGui::Text("Tilemap: %i / %i chunks visible, %i resident, %i uploaded (%.3f ms)", stats.TilemapVisibleChunks, tilemap->GetChunkCount(), tilemap->GetResidentChunkCount(), stats.TilemapUploads, tilemapMs);
+                if (stats.TilemapOverBudget > 0)
+                    ImGui::Text("  %i visible chunks not drawn, over the resident chunk budget", stats.TilemapOverBudget);
+            }
+            if (sceneGraphEnabled)
+            {
+                ImGui::Text("Scene graph: %i nodes, %i moved, %i world matrices rebuilt (%.3f ms update, %.3f ms submit)", sceneGraph->GetNodeCount(), sceneGraphMoved, sceneGraph->GetUpdatedCount(), sceneGraphUpdateMs, sceneGraphSubmitMs);
+            }
+            if (!tilemapEnabled)
+            {
+                ImGui::Text("Checkerboard: %.3f ms to submit", checkerboardMs);
+            }
+            if (impostorsEnabled)
+            {
+                const ImpostorStats& impostorStats = impostors->GetStats();
+                if (renderer->GetBackend() == RendererBackend::OpenGL)
+                    ImGui::Text("  Impostors: %i of %i regions, %i baked this frame (%.3f ms), %i bakes total", impostorStats.Impostors, impostorStats.Regions, impostorStats.Bakes, impostorStats.BakeMs, impostorStats.TotalBakes);
+                else
+                    ImGui::Text("  Impostors need the OpenGL backend");
+            }
+            if (impostorSweepFrame >= 0)
+            {
+                ImGui::Text("Impostor sweep: frame %i of %i", impostorSweepFrame, 2 * IMPOSTOR_SWEEP_STEPS * IMPOSTOR_SWEEP_HOLD_FRAMES);
+            }
+            else if (impostorSweepQuads[1][0] > 0.0f)
+            {
+                ImGui::Text("Impostor sweep, camera distance %.0f to %.0f (log scale):", IMPOSTOR_SWEEP_NEAR, IMPOSTOR_SWEEP_FAR);
+                PlotImpostorSweep("CPU ms", impostorSweepCpuMs[0], impostorSweepCpuMs[1]);
+                PlotImpostorSweep("GPU ms", impostorSweepGpuMs[0], impostorSweepGpuMs[1]);
+                PlotImpostorSweep("Quads", impostorSweepQuads[0], impostorSweepQuads[1]);
+            }
+            if (spatialEnabled)
+            {
+                ImGui::Text("Spatial index: %i quads in %i cells (%i large), built in %.3f ms", spatialIndex->GetItemCount(), spatialIndex->GetCellCount(), spatialIndex->GetLargeItemCount(), spatialBuildMs);
+                ImGui::Text("  Frustum query: %i visible in %.3f ms, %i moves in %.3f ms", spatialVisible, spatialQueryMs, spatialMovesPerFrame, spatialMoveMs);
+                if (spatialPicked != SpatialIndex::InvalidItem)
+                    ImGui::Text("  Picked: %i (%.4f ms)", spatialPicked, spatialPickMs);
+            }
+            if (renderer->GetDepthSort())
+            {
+                ImGui::Text("Depth sort: %i quads bucketed in %.3f ms", stats.DepthSortedQuads, stats.DepthSortMs);
+            }
+            if (overdrawViewEnabled)
+            {
+                const OverdrawStats& overdrawStats = overdrawView->GetStats();
+                if (renderer->GetBackend() == RendererBackend::OpenGL)
+                {
+                    ImGui::Text("Overdraw: %.2f average, %.2f where drawn, %i max (%.3f ms to resolve)", overdrawStats.AverageOverdraw, overdrawStats.AverageCoveredOverdraw, overdrawStats.MaxOverdraw, overdrawStats.ResolveMs);
+                    ImGui::Text("  %llu fragments passed the depth test over %llu screen pixels, %i covered, %i saturated", (unsigned long long)overdrawStats.DepthPassedFragments, (unsigned long long)overdrawStats.ScreenPixels, overdrawStats.CoveredPixels, overdrawStats.SaturatedPixels);
+                }
+                else
+                {
+                    ImGui::Text("Overdraw heatmap needs the OpenGL backend");
+                }
+                if (overdrawRecordFrame >= 0)
+                    ImGui::Text("  Recording frame %i of %i", overdrawRecordFrame, OVERDRAW_RECORD_FRAMES);
+                else if (overdrawRecordWritten)
+                    ImGui::Text("  Recorded %i frames to %s", (int32_t)overdrawRecording.size(), OVERDRAW_RECORD_PATH);
+            }
+            if (overdrawLayers > 0)
+            {
+                uint64_t invocations = 0;
+                ImGui::Text("Overdraw stack: %i layers (%.3f ms to submit)", overdrawLayers, overdrawMs);
+                if (renderer->GetFragmentInvocations(invocations))
+                    ImGui::Text("  Fragment shader invocations: %llu (%.2f per pixel)", (unsigned long long)invocations, (double)invocations / ((double)WndWidth * WndHeight));
+                else
+                    ImGui::Text("  Fragment shader invocations: not available");
+            }
+            if (gpuCullEnabled)
+            {
+                uint32_t visible = gpuCuller->GetVisibleCount();
+                const QuadUploadStats& upload = gpuQuads->GetUploadStats();
+                ImGui::Text("GPU culling: %i quads, %i visible, %i culled (a few frames late), created in %.3f ms", gpuQuads->GetQuadCount(), visible, gpuCuller->GetQuadCount() - visible, gpuCullCreateMs);
+                ImGui::Text("  Retained updates: %i changed (%.3f ms), %i dirty slots in %i ranges, %.1f KB uploaded of %.1f MB (%.3f ms to flush)",
+                    gpuQuadsChanged, gpuQuadsUpdateMs, upload.DirtySlots, upload.Ranges, upload.UploadBytes / 1024.0, (double)gpuQuads->GetSlotCount() * sizeof(GpuQuad) / (1024.0 * 1024.0), upload.FlushMs);
+                if (gpuCullBenchmarkFrame >= 0)
+                {
+                    ImGui::Text("  Retained update benchmark: frame %i of %i", gpuCullBenchmarkFrame, 3 * GPU_CULL_BENCHMARK_FRAMES);
+                }
+                else if (gpuCullBenchmarkRanges[2] > 0.0)
+                {
+                    for (uint32_t i = 0; i < 3; i++)
+                        ImGui::Text("  %.1f%% changed: %.1f KB per frame in %.0f ranges, %.3f ms to flush", gpuCullBenchmarkPercents[i], gpuCullBenchmarkBytes[i] / 1024.0, gpuCullBenchmarkRanges[i], gpuCullBenchmarkFlushMs[i]);
+                }
+            }
+            if (debugShapeCount > 0)
+            {
+                ImGui::Text("Debug shapes: %i (%.3f ms to submit)", debugShapeCount, debugShapesMs);
+            }
+            if (parallelSpriteCount > 0)
+            {
+                ImGui::Text("Parallel sprites: %i on %i threads (%.3f ms to submit, %.3f ms to merge)", stats.SubmittedQuads, parallelSubmitThreads, parallelSubmitMs, stats.SubmissionMergeMs);
+            }
+            if (sprite2DCount > 0)
+            {
+                // EndScene covers the rest of the scene too, turn everything else off for a clean number
+                float totalMs = sprite2DSubmitMs + endSceneMs;
+                ImGui::Text("Sprites 2D: %i through %s (%.3f ms to submit, %.3f ms EndScene, %.2f Mquads/s)", sprite2DCount, sprite2DAsQuads ? "DrawQuadTextured" : "DrawSprite2D",
+                    sprite2DSubmitMs, endSceneMs, totalMs > 0.0f ? sprite2DCount / (totalMs * 1000.0f) : 0.0f);
+            }
+            if (submissionScalingSubmitMs[1] > 0.0f)
+            {
+                ImGui::Text("Submission scaling (%i sprites):", SUBMISSION_SCALING_SPRITES);
+                for (uint32_t i = 1; i <= MAX_SUBMISSION_CONTEXTS; i++)
+                {
+                    ImGui::Text("  %i threads: %.3f ms submit (%.2fx), %.3f ms sort", i, submissionScalingSubmitMs[i], submissionScalingSubmitMs[1] / submissionScalingSubmitMs[i], submissionScalingSortMs[i]);
+                }
+            }
+            if (mathBenchmarkDone)
+            {
+                ImGui::Text("SinCos max error: %.3g sin, %.3g cos, %.3g on vertex positions", sinCosMaxError, cosMaxError, rotationMaxError);
+                ImGui::Text("  CalcVertices Z only: %.2f ns/quad (glm::rotate %.2f ns/quad)", calcVerticesNs[0], calcVerticesReferenceNs[0]);
+                ImGui::Text("  CalcVertices XYZ: %.2f ns/quad (glm::rotate %.2f ns/quad)", calcVerticesNs[1], calcVerticesReferenceNs[1]);
+            }
+            ImGui::Text("Particles: %i / %i (%.3f ms update, %.3f ms submit)", particles->GetCount(), particles->GetMaxParticles(), particleUpdateMs, particleSubmitMs);
+            if (renderer->GetBackend() == RendererBackend::Software)
+            {
+                SoftwareRasterizer* rasterizer = renderer->GetRasterizer();
+
+                ImGui::Spacing();
+                ImGui::Text("Software raster: %.3f ms, %.1f Mpixels/s", rasterizer->GetRasterTimeMs(), rasterizer->GetMPixelsPerSecond());
+                if (ImGui::SliderInt("Raster threads", &rasterThreadCount, 1, ThreadCount))
+                {
+                    rasterizer->SetThreadCount(rasterThreadCount);
+                }
+                for (int32_t i = 1; i <= ThreadCount; i++)
+                {
+                    if (rasterMPixelsPerThread[i] > 0.0f)
+                        ImGui::Text("  %i threads: %.1f Mpixels/s", i, rasterMPixelsPerThread[i]);
+                }
+            }
+            ShaderLibrary* shaderLibrary = renderer->GetShaderLibrary();
+            if (shaderLibrary)
+            {
+                ImGui::Spacing();
+                ImGui::Text("Shaders (%s compile):", shaderLibrary->IsParallel() ? "parallel" : "serial");
+                for (const ShaderProgramEntry& entry : shaderLibrary->GetEntries())
+                {
+                    if (!entry.Ready)
+                        ImGui::Text("  %s: compiling...", entry.Name.c_str());
+                    else if (!entry.Program->IsValid())
+                        ImGui::Text("  %s: FAILED (%.2f ms), using fallback", entry.Name.c_str(), entry.CompileTimeMs);
+                    else
+                        ImGui::Text("  %s: %.2f ms", entry.Name.c_str(), entry.CompileTimeMs);
+                }
+            }
+            ImGui::Spacing();
+            ImGui::Text("Draw calls per permutation:");
+            for (uint32_t features = 0; features < SHADER_PERMUTATION_COUNT; features++)
+            {
+                if (stats.PermutationDraws[features] > 0)
+                    ImGui::Text("  %s: %i", renderer->GetPermutationName(features).c_str(), stats.PermutationDraws[features]);
+            }
         }
     );
 
@@ -612,9 +1779,26 @@ void ImGuiRender()
 
 void OnWindowResize(GLFWwindow* window, int width, int height)
 {
-    glViewport(0, 0, width, height);
+    RenderThread::Run([width, height]()
+    {
+        glViewport(0, 0, width, height);
+    });
     WndWidth = width;
     WndHeight = height;
+
+    if (renderer)
+        renderer->Resize(width, height);
+
+    if (backgroundLayer)
+    {
+        backgroundLayer->Resize(width, height);
+        hudLayer->Resize(width, height);
+    }
+
+    if (overdrawView)
+        overdrawView->Resize(width, height);
+
+    InvalidateFrame();
 }
 
 float rot = 0.0f;
@@ -651,6 +1835,8 @@ inline void MoveCameraUp(float direction)
 
 void ScrollCallback(GLFWwindow* window, double xoffset, double yoffset)
 {
+    InvalidateFrame();
+
     double mouseX, mouseY;
     glfwGetCursorPos(window, &mouseX, &mouseY);
     if (mouseX > imguiPanelWidth)
@@ -711,25 +1897,266 @@ void UpdateCameraRotation()
     mouseY = newY;
 }
 
+// the cursor ray against the Z = 0 plane the spatial index quads sit on, overlapping quads pick the newest handle
+void UpdatePicking()
+{
+    if (!spatialEnabled || mouseX <= imguiPanelWidth || glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) != GLFW_PRESS)
+        return;
+
+    glm::mat4 inverse = glm::inverse(GetProjectionMatrix(cam) * GetViewMatrix(cam));
+    float ndcX = 2.0f * mouseX / WndWidth - 1.0f;
+    float ndcY = 1.0f - 2.0f * mouseY / WndHeight;
+
+    glm::vec4 nearPoint = inverse * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+    glm::vec4 farPoint = inverse * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+    glm::vec3 from = glm::vec3(nearPoint) / nearPoint.w;
+    glm::vec3 to = glm::vec3(farPoint) / farPoint.w;
+
+    if (from.z == to.z)
+        return;
+
+    float t = -from.z / (to.z - from.z);
+    if (t < 0.0f || t > 1.0f)
+        return;
+
+    glm::vec3 hit = from + (to - from) * t;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    spatialResults.clear();
+    spatialIndex->QueryPoint({ hit.x, hit.y }, spatialResults);
+
+    std::chrono::duration<float, std::milli> pickTime = std::chrono::steady_clock::now() - start;
+    spatialPickMs = pickTime.count();
+
+    spatialPicked = SpatialIndex::InvalidItem;
+    for (uint32_t item : spatialResults)
+    {
+        if (spatialPicked == SpatialIndex::InvalidItem || item > spatialPicked)
+            spatialPicked = item;
+    }
+}
+
 void DrawCheckerboard()
 {
-    Transform quadTransform = {};
-    quadTransform.Scale = checkerboardQuadScale;
+    uint32_t size = checherboardSize > 0 ? checherboardSize : 0;
+    DrawCheckerboardRect(renderer, GetCheckerboardDesc(), 0, 0, size, size);
+}
+
+// lines of text below the checkerboard until we get to the requested glyph count
+void DrawTextBenchmark()
+{
+    static const char* line = "The quick brown fox jumps over the lazy dog 0123456789 !?#%&() The quick brown fox jumps over";
+
+    uint32_t lineGlyphs = 0;
+    for (const char* c = line; *c; c++)
+    {
+        if (*c != ' ')
+            lineGlyphs++;
+    }
+
+    uint32_t drawn = 0;
+    float y = -2.0f;
+    while (drawn < (uint32_t)textBenchmarkGlyphs)
+    {
+        if (textBenchmarkSdf)
+            renderer->DrawStringSdf(font, line, { 0.0f, y, -0.1f }, 0.5f, { 1.0f, 0.85f, 0.2f });
+        else
+            renderer->DrawString(font, line, { 0.0f, y, -0.1f }, 0.5f, { 1.0f, 0.85f, 0.2f }, 24);
+        drawn += lineGlyphs;
+        y -= 0.6f;
+    }
+}
+
+void UpdateParticles()
+{
+    ParticleEmitDesc desc;
+    desc.Position = mainQuadTransform.Location;
+    desc.PositionVariance = { 0.1f, 0.1f, 0.0f };
+    desc.Velocity = { 0.0f, 1.5f, 0.0f };
+    desc.VelocityVariance = { 0.8f, 0.5f, 0.0f };
+    desc.ColorBegin = { 1.0f, 0.9f, 0.3f };
+    desc.ColorEnd = { 0.8f, 0.1f, 0.05f };
+    desc.LifeTime = particleLifeTime;
+    desc.Size = particleSize;
+
+    // carry the fraction over so low rates still emit at high framerates
+    particleEmitAccumulator += particleEmitRate * deltaTime;
+    uint32_t emitCount = (uint32_t)particleEmitAccumulator;
+    particleEmitAccumulator -= emitCount;
+
+    particles->Emit(desc, emitCount);
+    particles->Update(deltaTime, particleGravity);
+}
+
+// a grid of spinning sprites to the right of the checkerboard, on four layers
+void DrawSprites2D()
+{
+    const uint32_t spritesPerRow = 1000;
+    Vec2 scale = { 0.08f, 0.08f };
+
+    for (int32_t i = 0; i < sprite2DCount; i++)
+    {
+        Vec2 position = { 2.0f + (i % spritesPerRow) * 0.1f, 2.0f - (i / spritesPerRow) * 0.1f };
+        float rotation = totalTime * 45.0f + (i % 360);
+
+        if (sprite2DAsQuads)
+            renderer->DrawQuadTextured({ { position.X, position.Y, 0.0f }, { 0.0f, 0.0f, rotation }, { scale.X, scale.Y, 1.0f } }, myTexture);
+        else
+            renderer->DrawSprite2D(GetAffine2D(position, rotation, scale), myTexture, i % 4);
+    }
+}
+
+// every submitting thread emits its own slice of the sprites through its own context
+void SubmitParallelSprites(uint32_t threadCount, uint32_t spriteCount)
+{
+    uint32_t spritesPerThread = spriteCount / threadCount;
+
+    WorkerPool::Get().Run(threadCount, [=](uint32_t thread)
+    {
+        uint32_t first = spritesPerThread * thread;
+        uint32_t count = thread == threadCount - 1 ? spriteCount - first : spritesPerThread;
+        EmitParallelSprites(renderer->GetSubmissionContext(thread), myTexture, first, count, totalTime);
+    });
+}
+
+// runs between frames, every thread count submits the same sprites and then the contexts are thrown away.
+// only submission and the cpu side of the sorted merge are timed, nothing reaches the batch
+void RunSubmissionScalingBenchmark()
+{
+    const uint32_t iterations = 5;
+
+    for (uint32_t threadCount = 1; threadCount <= MAX_SUBMISSION_CONTEXTS; threadCount++)
+    {
+        // grows the context vectors first, so reallocation isn't part of the measurement
+        SubmitParallelSprites(threadCount, SUBMISSION_SCALING_SPRITES);
+        renderer->ClearSubmissionContexts();
+
+        std::chrono::duration<float, std::milli> submitTime(0.0f);
+        std::chrono::duration<float, std::milli> sortTime(0.0f);
+
+        for (uint32_t i = 0; i < iterations; i++)
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            SubmitParallelSprites(threadCount, SUBMISSION_SCALING_SPRITES);
+            std::chrono::steady_clock::time_point submitEnd = std::chrono::steady_clock::now();
+            renderer->BuildSubmissionOrder();
+            sortTime += std::chrono::steady_clock::now() - submitEnd;
+            submitTime += submitEnd - start;
+
+            renderer->ClearSubmissionContexts();
+        }
+
+        submissionScalingSubmitMs[threadCount] = submitTime.count() / iterations;
+        submissionScalingSortMs[threadCount] = sortTime.count() / iterations;
+    }
+}
 
-    bool white = !(checherboardSize % 2);
+// what CalcVertices did before SinCos, kept to compare against
+static void CalcVerticesReference(const TexturedQuad* batchData, Vertex* vertexData, uint32_t count)
+{
+    static const glm::vec4 corners[] =
+    {
+        { -0.5f, -0.5f, 0.0f, 1.0f },
+        {  0.5f, -0.5f, 0.0f, 1.0f },
+        {  0.5f,  0.5f, 0.0f, 1.0f },
+        { -0.5f,  0.5f, 0.0f, 1.0f }
+    };
 
-    for (uint32_t height = 0; height < checherboardSize; height++)
+    for (uint32_t i = 0; i < count; i++, batchData++)
     {
-        if (!(checherboardSize % 2))
+        const Transform& transform = batchData->Transform;
+        glm::mat4 model =
+            glm::translate(glm::mat4(1.0f), (glm::vec3)transform.Location)
+            *
+            glm::rotate(glm::mat4(1.0f), glm::radians(transform.Rotation.X), glm::vec3(1.0f, 0.0f, 0.0f))
+            *
+            glm::rotate(glm::mat4(1.0f), glm::radians(transform.Rotation.Y), glm::vec3(0.0f, 1.0f, 0.0f))
+            *
+            glm::rotate(glm::mat4(1.0f), glm::radians(transform.Rotation.Z), glm::vec3(0.0f, 0.0f, 1.0f))
+            *
+            glm::scale(glm::mat4(1.0f), (glm::vec3)transform.Scale);
+
+        for (uint32_t j = 0; j < 4; j++, vertexData++)
         {
-            white = !white;
+            glm::vec3 res = model * corners[j];
+            vertexData->Position = { res.x, res.y, res.z };
+            vertexData->Color = batchData->ColorTint;
+            vertexData->TextureIndex = batchData->Shape.X > 0.5f ? PackShape(batchData->Shape) : batchData->TextureIndex;
         }
-        for (uint32_t width = 0; width < checherboardSize; width++)
+    }
+}
+
+// single threaded so the numbers are per core, the accuracy sweep covers every angle the renderer can reasonably see
+void RunMathBenchmark()
+{
+    const uint32_t sweepCount = 1000000;
+    const float sweepRange = 8192.0f;
+
+    std::vector<float> angles(sweepCount);
+    std::vector<float> sines(sweepCount);
+    std::vector<float> cosines(sweepCount);
+    for (uint32_t i = 0; i < sweepCount; i++)
+        angles[i] = -sweepRange + 2.0f * sweepRange * i / sweepCount;
+
+    SinCos(angles.data(), sines.data(), cosines.data(), sweepCount);
+
+    sinCosMaxError = 0.0f;
+    cosMaxError = 0.0f;
+    for (uint32_t i = 0; i < sweepCount; i++)
+    {
+        float sinError = (float)fabs(sines[i] - sin((double)angles[i]));
+        float cosError = (float)fabs(cosines[i] - cos((double)angles[i]));
+        sinCosMaxError = sinError > sinCosMaxError ? sinError : sinCosMaxError;
+        cosMaxError = cosError > cosMaxError ? cosError : cosMaxError;
+    }
+
+    std::vector<TexturedQuad> quads(MATH_BENCHMARK_QUADS);
+    std::vector<Vertex> vertices(MATH_BENCHMARK_QUADS * 4);
+    std::vector<Vertex> referenceVertices(MATH_BENCHMARK_QUADS * 4);
+
+    for (uint32_t pass = 0; pass < 2; pass++)
+    {
+        bool zOnly = pass == 0;
+        for (uint32_t i = 0; i < MATH_BENCHMARK_QUADS; i++)
         {
-            quadTransform.Location = { quadTransform.Scale.X * width, quadTransform.Scale.Y * height, 0.0f };
-            DrawQuadTextured(quadTransform, (white = !white) ? whiteTexture : myTexture, tilingFactor, { 1.0f, 1.0f, 1.0f });
+            TexturedQuad& quad = quads[i];
+            float t = (float)i / MATH_BENCHMARK_QUADS;
+            quad.Transform.Location = { t * 100.0f, t * 50.0f, 0.0f };
+            quad.Transform.Rotation = { zOnly ? 0.0f : t * 720.0f - 360.0f, zOnly ? 0.0f : t * 1080.0f, t * 3600.0f - 1800.0f };
+            quad.Transform.Scale = { 1.0f + t, 2.0f - t, 1.0f };
+            quad.ColorTint = { 1.0f, 1.0f, 1.0f };
+            quad.TextureIndex = 0.0f;
+            quad.TextureRect = GetTilingRect(1.0f);
+            quad.Shape = {};
         }
+
+        const uint32_t iterations = 10;
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < iterations; i++)
+            CalcVertices(quads.data(), vertices.data(), MATH_BENCHMARK_QUADS);
+        std::chrono::duration<float, std::nano> time = std::chrono::steady_clock::now() - start;
+        calcVerticesNs[pass] = time.count() / (iterations * MATH_BENCHMARK_QUADS);
+
+        start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < iterations; i++)
+            CalcVerticesReference(quads.data(), referenceVertices.data(), MATH_BENCHMARK_QUADS);
+        time = std::chrono::steady_clock::now() - start;
+        calcVerticesReferenceNs[pass] = time.count() / (iterations * MATH_BENCHMARK_QUADS);
+    }
+
+    // the XYZ pass is still in the buffers, positions are at most 150 units out so this is mostly the rotation
+    rotationMaxError = 0.0f;
+    for (uint32_t i = 0; i < MATH_BENCHMARK_QUADS * 4; i++)
+    {
+        Vec3 a = vertices[i].Position;
+        Vec3 b = referenceVertices[i].Position;
+        float error = fabsf(a.X - b.X) + fabsf(a.Y - b.Y) + fabsf(a.Z - b.Z);
+        rotationMaxError = error > rotationMaxError ? error : rotationMaxError;
     }
+
+    mathBenchmarkDone = true;
 }
 
 #define GLFW_TIMER 0
@@ -763,23 +2190,126 @@ double GetTime()
 
 #endif
 
-int main()
+int main(int argc, char** argv)
 {
+    bool runTests = false;
+    bool runGpuTests = false;
+    bool goldenCapture = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--software")
+            Backend = RendererBackend::Software;
+        else if (arg == "--test")
+            runTests = true;
+        else if (arg == "--test-gpu")
+            runGpuTests = true;
+        else if (arg == "--golden-capture")
+            goldenCapture = true;
+        else
+            std::cout << "Unknown argument " << arg << std::endl;
+    }
+
+    // no window and no context, the exit code is the number of failures
+    if (goldenCapture)
+        return RunGoldenTests(true);
+    if (runTests)
+        return RunTests();
+    // only a hidden window of its own
+    if (runGpuTests)
+        return RunGpuTests();
+
     if (Init())
     {
-        InitRenderer(MAX_QUAD_BATCH);
+        InitRenderer(MAX_QUAD_BATCH, Backend);
+
+
+        myTexture = Texture::FromFile("res/doom.png", renderer->UsesCpuTextures());
+        if (!myTexture)
+        {
+            std::cout << "Can't load res/doom.png" << std::endl;
+
+            ShutdownRenderer();
+            Shutdown();
+
+            return -1;
+        }
 
+        // shipped in res/ (SIL OFL, see res/Lato-OFL.txt), text is still just skipped if it's missing
+        font = Font::FromFile("res/Lato-Regular.ttf", sdfAtlasSize, renderer->UsesCpuTextures());
+        if (font)
+            font->PrewarmSdf(32, 126, ThreadCount);
 
-        myTexture = Texture::FromFile("res/doom.png");
+        particles = new ParticleSystem(MAX_PARTICLES, ThreadCount);
 
         cam.FOV = 60.0f;
         cam.Transform.Location = { 0.0f, 0.0f, -5.0f };
         cam.Transform.Rotation = { 0.0f, 0.0f, 0.0f };
 
+        renderThreadEnabled = UseRenderThread;
+
+        framePacer = new FramePacer();
+        framePacer->SetMaxFramesInFlight(maxFramesInFlight);
+
         InitTimer();
 
         while (!glfwWindowShouldClose(window))
         {
+            // switched between frames, so the context changes hands with nothing half recorded
+            bool wantRenderThread = renderThreadEnabled && renderer->GetBackend() == RendererBackend::OpenGL;
+            if (wantRenderThread && !renderThread)
+            {
+                renderThread = new RenderThread(window, MaxQueuedFrames);
+            }
+            else if (!wantRenderThread && renderThread)
+            {
+                delete renderThread;
+                renderThread = nullptr;
+            }
+            if (renderThread)
+                renderThread->SetMaxQueuedFrames(MaxQueuedFrames);
+
+            UpdateCpuUsage();
+
+            if (onDemandEnabled && !NeedsFrame())
+            {
+                glfwWaitEventsTimeout(ON_DEMAND_WAIT_TIMEOUT);
+
+                if (!NeedsFrame())
+                {
+                    if (onDemandRepaint)
+                        PresentLastFrame();
+
+                    onDemandFrameCounts[onDemandRepaint ? 1 : 2]++;
+                    onDemandRepaint = false;
+                    continue;
+                }
+
+                // picks up from the last frame's delta instead of jumping by the time spent waiting
+                totalTime = (float)GetTime() - deltaTime;
+            }
+
+            onDemandFrameCounts[0]++;
+            onDemandRepaint = false;
+            if (onDemandFramesLeft > 0)
+                onDemandFramesLeft--;
+
+            if (runSubmissionScaling)
+            {
+                RunSubmissionScalingBenchmark();
+                runSubmissionScaling = false;
+            }
+
+            if (runMathBenchmark)
+            {
+                RunMathBenchmark();
+                runMathBenchmark = false;
+            }
+
+            // before the time is taken and input polled, so what the pacer and fence waits hold back isn't stale
+            framePacer->BeginFrame();
+
             double currentTime = GetTime();
             deltaTime = currentTime - totalTime;
             totalTime = currentTime;
@@ -790,16 +2320,170 @@ int main()
 
             UpdateCameraLocation();
             UpdateCameraRotation();
+            UpdatePicking();
+            UpdateImpostorSweep();
+
+            if (font)
+                font->NewFrame();
+
+            BeginFrame();
+
+            if (impostorsEnabled && !tilemapEnabled)
+                UpdateImpostors();
+
+            renderer->Clear(clearColor);
+
+            if (layersEnabled)
+            {
+                double layersStart = GetTime();
+                DrawBackgroundLayer();
+                layersMs = (GetTime() - layersStart) * 1000.0;
+            }
+
+            if (overdrawViewEnabled)
+                overdrawView->Begin(renderer);
+
+            renderer->BeginScene(cam);
+
+            DrawMainQuad(renderer, mainQuadTransform, mainQuadColor);
+
+            if (tilemapEnabled)
+            {
+                double tilemapStart = GetTime();
+                EditTilemap();
+                renderer->DrawTilemap(tilemap);
+                tilemapMs = (GetTime() - tilemapStart) * 1000.0;
+            }
+            else
+            {
+                double checkerboardStart = GetTime();
+                if (impostorsEnabled)
+                    impostors->Draw(renderer);
+                else
+                    DrawCheckerboard();
+                checkerboardMs = (GetTime() - checkerboardStart) * 1000.0;
+            }
+
+            if (spatialEnabled)
+            {
+                MoveSpatialQuads();
+                DrawSpatialQuads();
+            }
+
+            if (gpuCullEnabled)
+            {
+                UpdateGpuQuads();
+                renderer->DrawGpuQuads(gpuCuller);
+            }
+
+            if (sceneGraphEnabled)
+            {
+                double sceneGraphStart = GetTime();
+                UpdateSceneGraph();
+                double sceneGraphUpdateEnd = GetTime();
+                renderer->DrawSceneGraph(sceneGraph);
+                sceneGraphUpdateMs = (sceneGraphUpdateEnd - sceneGraphStart) * 1000.0;
+                sceneGraphSubmitMs = (GetTime() - sceneGraphUpdateEnd) * 1000.0;
+            }
+
+            if (particleEmitRate > 0 || particles->GetCount() > 0)
+            {
+                double particleStart = GetTime();
+                UpdateParticles();
+                double particleUpdateEnd = GetTime();
+                renderer->DrawParticles(particles);
+                particleUpdateMs = (particleUpdateEnd - particleStart) * 1000.0;
+                particleSubmitMs = (GetTime() - particleUpdateEnd) * 1000.0;
+            }
+
+            if (debugShapeCount > 0)
+            {
+                double shapesStart = GetTime();
+                DrawDebugShapes(renderer, debugShapeCount);
+                debugShapesMs = (GetTime() - shapesStart) * 1000.0;
+            }
+
+            if (overdrawLayers > 0)
+            {
+                double overdrawStart = GetTime();
+                DrawOverdrawStack();
+                overdrawMs = (GetTime() - overdrawStart) * 1000.0;
+            }
+
+            if (parallelSpriteCount > 0)
+            {
+                double submitStart = GetTime();
+                SubmitParallelSprites(parallelSubmitThreads, parallelSpriteCount);
+                parallelSubmitMs = (GetTime() - submitStart) * 1000.0;
+            }
+
+            if (font && textBenchmarkGlyphs > 0)
+            {
+                double textStart = GetTime();
+                DrawTextBenchmark();
+                textBenchmarkMs = (GetTime() - textStart) * 1000.0;
+            }
+
+            if (sprite2DCount > 0)
+            {
+                double spritesStart = GetTime();
+                DrawSprites2D();
+                sprite2DSubmitMs = (GetTime() - spritesStart) * 1000.0;
+            }
+
+            double endSceneStart = GetTime();
+            renderer->EndScene();
+            endSceneMs = (GetTime() - endSceneStart) * 1000.0;
+            RecordImpostorSweep();
+
+            if (overdrawViewEnabled)
+            {
+                overdrawView->End(renderer);
+                RecordOverdraw();
+            }
 
-            BeginScene(cam);
+            renderer->Present();
 
-            DrawQuad(mainQuadTransform, mainQuadColor);
+            if (overdrawViewEnabled)
+                overdrawView->Draw();
 
-            DrawCheckerboard();
+            if (layersEnabled)
+            {
+                double hudStart = GetTime();
+                DrawHudLayer();
+                layersMs += (GetTime() - hudStart) * 1000.0;
+            }
 
-            EndScene();
+            if (overlayEnabled)
+                DrawOverlay();
+
+            EndFrame();
         }
 
+        // gives the context back, everything below deletes GL objects
+        delete renderThread;
+        renderThread = nullptr;
+
+#if USE_IMGUI
+        imguiFrames.clear();
+#endif
+
+        delete framePacer;
+        delete font;
+        delete particles;
+        delete tilemap;
+        delete sceneGraph;
+        delete spatialIndex;
+        delete gpuQuads;
+        delete gpuCuller;
+        delete impostors;
+        delete backgroundLayer;
+        delete hudLayer;
+        delete layerRenderer;
+        delete overlayRenderer;
+        delete overdrawView;
+        delete onDemandLastFrame;
+
         ShutdownRenderer();
         Shutdown();
 
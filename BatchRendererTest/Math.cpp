@@ -1,25 +1,137 @@
 #include "Math.h"
 #include "glm/ext.hpp"
 
-glm::mat4 GetRotation(Vec3 rotation)
+#include <emmintrin.h>
+
+// pi/2 in three parts, the first ones have few enough bits that q * part is exact for the q we care about
+static const float PiOver2Hi = 1.5703125f;
+static const float PiOver2Mid = 4.837512969970703125e-4f;
+static const float PiOver2Lo = 7.54978995489188216e-8f;
+
+static inline void SinCos4(__m128 x, __m128& sines, __m128& cosines)
+{
+    // quadrant, x = q * pi/2 + r with r in [-pi/4, pi/4]
+    __m128i q = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(0.636619772f)));
+    __m128 qf = _mm_cvtepi32_ps(q);
+
+    __m128 r = _mm_sub_ps(x, _mm_mul_ps(qf, _mm_set1_ps(PiOver2Hi)));
+    r = _mm_sub_ps(r, _mm_mul_ps(qf, _mm_set1_ps(PiOver2Mid)));
+    r = _mm_sub_ps(r, _mm_mul_ps(qf, _mm_set1_ps(PiOver2Lo)));
+
+    __m128 r2 = _mm_mul_ps(r, r);
+
+    // cephes sinf/cosf coefficients
+    __m128 s = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-1.9515295891e-4f), r2), _mm_set1_ps(8.3321608736e-3f));
+    s = _mm_add_ps(_mm_mul_ps(s, r2), _mm_set1_ps(-1.6666654611e-1f));
+    s = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(s, r2), r), r);
+
+    __m128 c = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(2.443315711809948e-5f), r2), _mm_set1_ps(-1.388731625493765e-3f));
+    c = _mm_add_ps(_mm_mul_ps(c, r2), _mm_set1_ps(4.166664568298827e-2f));
+    c = _mm_mul_ps(_mm_mul_ps(c, r2), r2);
+    c = _mm_add_ps(_mm_sub_ps(c, _mm_mul_ps(r2, _mm_set1_ps(0.5f))), _mm_set1_ps(1.0f));
+
+    // odd quadrants swap sin and cos, quadrants 1-2 negate sin's source and 2-3 cos's
+    __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+    __m128 sinResult = _mm_or_ps(_mm_and_ps(swap, c), _mm_andnot_ps(swap, s));
+    __m128 cosResult = _mm_or_ps(_mm_and_ps(swap, s), _mm_andnot_ps(swap, c));
+
+    __m128 sinSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(q, _mm_set1_epi32(2)), 30));
+    __m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(q, _mm_set1_epi32(1)), _mm_set1_epi32(2)), 30));
+
+    sines = _mm_xor_ps(sinResult, sinSign);
+    cosines = _mm_xor_ps(cosResult, cosSign);
+}
+
+void SinCos(const float* radians, float* sines, float* cosines, uint32_t count)
+{
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 s, c;
+        SinCos4(_mm_loadu_ps(radians + i), s, c);
+        _mm_storeu_ps(sines + i, s);
+        _mm_storeu_ps(cosines + i, c);
+    }
+
+    if (i < count)
+    {
+        float tail[4] = {};
+        float tailSines[4];
+        float tailCosines[4];
+        for (uint32_t j = i; j < count; j++)
+            tail[j - i] = radians[j];
+
+        __m128 s, c;
+        SinCos4(_mm_loadu_ps(tail), s, c);
+        _mm_storeu_ps(tailSines, s);
+        _mm_storeu_ps(tailCosines, c);
+
+        for (uint32_t j = i; j < count; j++)
+        {
+            sines[j] = tailSines[j - i];
+            cosines[j] = tailCosines[j - i];
+        }
+    }
+}
+
+Affine2D GetAffine2D(Vec2 position, float rotation, Vec2 scale)
+{
+    float radians = glm::radians(rotation);
+    float s = sinf(radians);
+    float c = cosf(radians);
+
+    return { c * scale.X, s * scale.X, -s * scale.Y, c * scale.Y, position.X, position.Y };
+}
+
+Affine2D Combine(const Affine2D& parent, const Affine2D& local)
+{
+    return
+    {
+        parent.A * local.A + parent.C * local.B,
+        parent.B * local.A + parent.D * local.B,
+        parent.A * local.C + parent.C * local.D,
+        parent.B * local.C + parent.D * local.D,
+        parent.A * local.TX + parent.C * local.TY + parent.TX,
+        parent.B * local.TX + parent.D * local.TY + parent.TY
+    };
+}
+
+glm::mat3 GetRotation(Vec3 sines, Vec3 cosines)
 {
+    float sx = sines.X, cx = cosines.X;
+    float sy = sines.Y, cy = cosines.Y;
+    float sz = sines.Z, cz = cosines.Z;
+
+    // Rx * Ry * Rz multiplied out, glm is column major
     return
     {
-        glm::rotate(glm::mat4(1.0f), glm::radians(rotation.X), glm::vec3(1.0f, 0.0f, 0.0f))
-        *
-        glm::rotate(glm::mat4(1.0f), glm::radians(rotation.Y), glm::vec3(0.0f, 1.0f, 0.0f))
-        *
-        glm::rotate(glm::mat4(1.0f), glm::radians(rotation.Z), glm::vec3(0.0f, 0.0f, 1.0f))
+        {  cy * cz,  sx * sy * cz + cx * sz, -cx * sy * cz + sx * sz },
+        { -cy * sz, -sx * sy * sz + cx * cz,  cx * sy * sz + sx * cz },
+        {  sy,      -sx * cy,                 cx * cy                }
     };
 }
 
+glm::mat4 GetRotation(Vec3 rotation)
+{
+    float radians[3] = { glm::radians(rotation.X), glm::radians(rotation.Y), glm::radians(rotation.Z) };
+    float sines[3];
+    float cosines[3];
+    SinCos(radians, sines, cosines, 3);
+
+    return glm::mat4(GetRotation({ sines[0], sines[1], sines[2] }, { cosines[0], cosines[1], cosines[2] }));
+}
+
 Vec3 GetForwardVector(Vec3 rotation)
 {
     Vec3 forward;
 
-    forward.X = cos(glm::radians(rotation.X)) * sin(glm::radians(rotation.Y));
-    forward.Y = -sin(glm::radians(rotation.X));
-    forward.Z = cos(glm::radians(rotation.X)) * cos(glm::radians(rotation.Y));
+    float pitch = glm::radians(rotation.X);
+    float yaw = glm::radians(rotation.Y);
+    float cosPitch = cos(pitch);
+
+    forward.X = cosPitch * sin(yaw);
+    forward.Y = -sin(pitch);
+    forward.Z = cosPitch * cos(yaw);
 
     return forward;
 }
@@ -28,9 +140,11 @@ Vec3 GetRightVector(Vec3 rotation)
 {
     Vec3 right;
 
-    right.X = cos(glm::radians(rotation.Y));
+    float yaw = glm::radians(rotation.Y);
+
+    right.X = cos(yaw);
     right.Y = 0.0f;
-    right.Z = -sin(glm::radians(rotation.Y));
+    right.Z = -sin(yaw);
 
     return right;
 }
@@ -40,4 +154,4 @@ Vec3 GetUpVector(Vec3 rotation)
     glm::vec3 up = glm::cross((glm::vec3)GetForwardVector(rotation), (glm::vec3)GetRightVector(rotation));
 
     return { up.x, up.y, up.z };
-}
\ No newline at end of file
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <stdint.h>
+
 #include "glm/glm.hpp"
 
 struct Vec2
@@ -86,7 +88,29 @@ struct Vec4
     }
 };
 
+// 2x3 affine transform for 2D, x' = A * x + C * y + TX and y' = B * x + D * y + TY
+struct Affine2D
+{
+    float A, B;
+    float C, D;
+    float TX, TY;
+};
+
+// scale, then rotation (degrees, counter clockwise like Transform.Rotation.Z), then translation
+Affine2D GetAffine2D(Vec2 position, float rotation, Vec2 scale);
+// local applied first, then parent
+Affine2D Combine(const Affine2D& parent, const Affine2D& local);
+
+// sin and cos of count angles in radians, 4 at a time with SSE.
+// Range reduced to [-pi/4, pi/4] and minimax polynomials from there, max abs error 8e-8 for |angle| up to 8192
+// (sinf is 3.3e-8), it gets worse above that as the reduction loses bits, 5e-7 at 30000.
+// The arrays don't need any alignment and can be the same for input and one output.
+void SinCos(const float* radians, float* sines, float* cosines, uint32_t count);
+
+// X then Y then Z in degrees, same as the three glm::rotate but in closed form
 glm::mat4 GetRotation(Vec3 rotation);
+// the 3x3 part from angles that already went through SinCos, for building a lot of them
+glm::mat3 GetRotation(Vec3 sines, Vec3 cosines);
 Vec3 GetForwardVector(Vec3 rotation);
 Vec3 GetRightVector(Vec3 rotation);
 Vec3 GetUpVector(Vec3 rotation);
\ No newline at end of file
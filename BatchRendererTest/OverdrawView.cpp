@@ -0,0 +1,218 @@
+#include "OverdrawView.h"
+
+#include "GL/glew.h"
+
+#include "RenderTarget.h"
+#include "RenderThread.h"
+#include "Texture.h"
+
+#include <fstream>
+#include <chrono>
+
+static inline uint32_t PackColor(float r, float g, float b)
+{
+	return (uint32_t)(r * 255.0f) | ((uint32_t)(g * 255.0f) << 8) | ((uint32_t)(b * 255.0f) << 16) | 0xff000000;
+}
+
+OverdrawView::OverdrawView(const Renderer2DConfig& config, uint32_t width, uint32_t height)
+	: m_Width(width), m_Height(height), m_Scale(8), m_Active(false), m_Stats()
+{
+	if (config.Backend == RendererBackend::OpenGL)
+		m_Renderer.reset(new Renderer2D(config));
+
+	BuildPalette();
+}
+
+OverdrawView::~OverdrawView()
+{
+}
+
+void OverdrawView::Resize(uint32_t width, uint32_t height)
+{
+	m_Width = width;
+	m_Height = height;
+}
+
+void OverdrawView::SetScale(uint32_t scale)
+{
+	m_Scale = scale > 0 ? scale : 1;
+	BuildPalette();
+}
+
+// 1 is blue and the scale is red, going through green and yellow
+void OverdrawView::BuildPalette()
+{
+	static const float stops[4][3] = { { 0.0f, 0.0f, 1.0f }, { 0.0f, 1.0f, 0.0f }, { 1.0f, 1.0f, 0.0f }, { 1.0f, 0.0f, 0.0f } };
+
+	m_Palette[0] = PackColor(0.0f, 0.0f, 0.0f);
+
+	for (uint32_t count = 1; count < 256; count++)
+	{
+		if (count > m_Scale)
+		{
+			m_Palette[count] = PackColor(1.0f, 1.0f, 1.0f);
+			continue;
+		}
+
+		float t = m_Scale > 1 ? (count - 1) * 3.0f / (m_Scale - 1) : 3.0f;
+		uint32_t stop = t < 3.0f ? (uint32_t)t : 2;
+		float f = t - stop;
+
+		m_Palette[count] = PackColor
+		(
+			stops[stop][0] + (stops[stop + 1][0] - stops[stop][0]) * f,
+			stops[stop][1] + (stops[stop + 1][1] - stops[stop][1]) * f,
+			stops[stop][2] + (stops[stop + 1][2] - stops[stop][2]) * f
+		);
+	}
+}
+
+void OverdrawView::Begin(Renderer2D* renderer)
+{
+	m_Active = m_Renderer && renderer->GetBackend() == RendererBackend::OpenGL && m_Width > 0 && m_Height > 0;
+	if (!m_Active)
+		return;
+
+	if (!m_Target || m_Target->GetWidth() != m_Width || m_Target->GetHeight() != m_Height)
+		m_Target.reset(new RenderTarget(m_Width, m_Height));
+
+	renderer->SetRenderTarget(m_Target.get());
+	renderer->Clear({ 0.0f, 0.0f, 0.0f }, 0.0f);
+	renderer->SetOverdrawMode(true);
+}
+
+void OverdrawView::End(Renderer2D* renderer)
+{
+	if (!m_Active)
+		return;
+
+	m_Active = false;
+
+	renderer->SetOverdrawMode(false);
+	renderer->SetRenderTarget(nullptr);
+
+	std::chrono::steady_clock::time_point resolveStart = std::chrono::steady_clock::now();
+
+	uint32_t width = m_Target->GetWidth();
+	uint32_t height = m_Target->GetHeight();
+	uint32_t pixelCount = width * height;
+	m_Counts.resize(pixelCount);
+	m_HeatmapPixels.resize(pixelCount);
+
+	// waits for everything queued so far, the scene included
+	uint32_t colorID = m_Target->GetTexture()->GetRendererID();
+	uint32_t* counts = m_Counts.data();
+	RenderThread::RunSync([colorID, counts, pixelCount]()
+	{
+		glGetTextureImage(colorID, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixelCount * 4, counts);
+	});
+
+	// nothing queued can still bind the old heatmap after that sync
+	if (!m_Heatmap || m_Heatmap->GetWidth() != width || m_Heatmap->GetHeight() != height)
+		m_Heatmap.reset(new Texture(width, height, 4, nullptr));
+
+	uint64_t depthPassed = 0;
+	uint32_t covered = 0;
+	uint32_t saturated = 0;
+	uint32_t maxOverdraw = 0;
+
+	for (uint32_t i = 0; i < pixelCount; i++)
+	{
+		uint32_t count = counts[i] & 0xff;
+
+		depthPassed += count;
+		covered += count > 0;
+		saturated += count == 0xff;
+		maxOverdraw = count > maxOverdraw ? count : maxOverdraw;
+
+		m_HeatmapPixels[i] = m_Palette[count];
+	}
+
+	m_Heatmap->SetData(0, 0, width, height, (const unsigned char*)m_HeatmapPixels.data());
+
+	std::chrono::duration<float, std::milli> resolveTime = std::chrono::steady_clock::now() - resolveStart;
+
+	m_Stats.DepthPassedFragments = depthPassed;
+	m_Stats.ScreenPixels = pixelCount;
+	m_Stats.CoveredPixels = covered;
+	m_Stats.SaturatedPixels = saturated;
+	m_Stats.MaxOverdraw = maxOverdraw;
+	m_Stats.AverageOverdraw = (float)((double)depthPassed / pixelCount);
+	m_Stats.AverageCoveredOverdraw = covered > 0 ? (float)((double)depthPassed / covered) : 0.0f;
+	m_Stats.ResolveMs = resolveTime.count();
+}
+
+void OverdrawView::Draw()
+{
+	if (!m_Renderer || !m_Heatmap)
+		return;
+
+	float width = (float)m_Heatmap->GetWidth();
+	float height = (float)m_Heatmap->GetHeight();
+
+	// one unit per pixel, the origin in the bottom left corner
+	Camera camera = {};
+	camera.Transform = { { width * 0.5f, height * 0.5f, -1.0f }, { 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f } };
+	camera.FOV = 60.0f;
+	camera.AspectRatio = width / height;
+	camera.Orthographic = true;
+	camera.OrthographicHeight = height;
+
+	Transform transform;
+	transform.Location = { width * 0.5f, height * 0.5f, 0.0f };
+	transform.Rotation = { 0.0f, 0.0f, 0.0f };
+	transform.Scale = { width, height, 1.0f };
+
+	m_Renderer->ClearDepth();
+	m_Renderer->BeginScene(camera);
+	// rows came back bottom first like a render target, so V goes up the quad
+	m_Renderer->DrawQuadTexturedRect(transform, m_Heatmap.get(), { 0.0f, 1.0f, 1.0f, 0.0f }, { 1.0f, 1.0f, 1.0f }, ShaderFeature_Textured);
+	m_Renderer->EndScene();
+}
+
+bool WriteOverdrawJSON(const char* path, const char* scene, const std::vector<OverdrawStats>& frames)
+{
+	std::ofstream file(path);
+	if (!file.is_open())
+		return false;
+
+	double averageOverdraw = 0.0;
+	double averageCoveredOverdraw = 0.0;
+	uint32_t maxOverdraw = 0;
+	for (const OverdrawStats& frame : frames)
+	{
+		averageOverdraw += frame.AverageOverdraw;
+		averageCoveredOverdraw += frame.AverageCoveredOverdraw;
+		maxOverdraw = frame.MaxOverdraw > maxOverdraw ? frame.MaxOverdraw : maxOverdraw;
+	}
+	if (!frames.empty())
+	{
+		averageOverdraw /= frames.size();
+		averageCoveredOverdraw /= frames.size();
+	}
+
+	// scene goes out as is, it's one of our own names
+	file << "{\n";
+	file << "  \"scene\": \"" << scene << "\",\n";
+	file << "  \"frames\": " << frames.size() << ",\n";
+	file << "  \"average_overdraw\": " << averageOverdraw << ",\n";
+	file << "  \"average_covered_overdraw\": " << averageCoveredOverdraw << ",\n";
+	file << "  \"max_overdraw\": " << maxOverdraw << ",\n";
+	file << "  \"per_frame\": [\n";
+
+	for (size_t i = 0; i < frames.size(); i++)
+	{
+		const OverdrawStats& frame = frames[i];
+		file << "    { \"depth_passed_fragments\": " << frame.DepthPassedFragments << ", \"screen_pixels\": " << frame.ScreenPixels
+			<< ", \"covered_pixels\": " << frame.CoveredPixels << ", \"saturated_pixels\": " << frame.SaturatedPixels
+			<< ", \"max_overdraw\": " << frame.MaxOverdraw << ", \"average_overdraw\": " << frame.AverageOverdraw
+			<< ", \"average_covered_overdraw\": " << frame.AverageCoveredOverdraw << ", \"resolve_ms\": " << frame.ResolveMs
+			<< (i + 1 < frames.size() ? " },\n" : " }\n");
+	}
+
+	file << "  ]\n";
+	file << "}\n";
+
+	file.close();
+	return true;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+#include <memory>
+
+#include "Renderer2D.h"
+
+class RenderTarget;
+class Texture;
+
+struct OverdrawStats
+{
+	// fragments that passed the depth test and got blended into the counts, every layer of every pixel. Not what was shaded:
+	// fragments that fail a late depth test are shaded and not counted, Renderer2D::GetFragmentInvocations counts those
+	uint64_t DepthPassedFragments;
+	uint64_t ScreenPixels;
+	uint32_t CoveredPixels; // drawn at least once
+	uint32_t SaturatedPixels; // drawn 255 times or more, the count stops there
+	uint32_t MaxOverdraw;
+	float AverageOverdraw; // depth passed fragments / screen pixels
+	float AverageCoveredOverdraw; // depth passed fragments / covered pixels
+	float ResolveMs; // readback, stats and heatmap
+};
+
+// Overdraw heatmap. Between Begin and End the scene renders into a window sized target with the renderer in
+// overdraw mode, End reads the counts back, works out the stats and turns them into a heatmap that Draw puts
+// over the window: black never drawn, then blue, green, yellow and red up to the scale, white above it.
+// The readback waits for the GPU, it's a debug view. OpenGL only, with the software backend Begin/End do nothing.
+class OverdrawView
+{
+public:
+	// the config is for the renderer that draws the heatmap
+	OverdrawView(const Renderer2DConfig& config, uint32_t width, uint32_t height);
+	~OverdrawView();
+
+	OverdrawView(const OverdrawView&) = delete;
+	OverdrawView& operator=(const OverdrawView&) = delete;
+
+	// the window size, the target is recreated by the next Begin
+	void Resize(uint32_t width, uint32_t height);
+
+	// before the scene's BeginScene, after whatever else clears the window
+	void Begin(Renderer2D* renderer);
+	// after the scene's EndScene
+	void End(Renderer2D* renderer);
+	void Draw();
+
+	// overdraw that maps to red, anything above is white
+	void SetScale(uint32_t scale);
+	inline uint32_t GetScale() const { return m_Scale; }
+
+	inline const OverdrawStats& GetStats() const { return m_Stats; }
+
+private:
+	void BuildPalette();
+
+private:
+	std::unique_ptr<Renderer2D> m_Renderer;
+	std::unique_ptr<RenderTarget> m_Target;
+	std::unique_ptr<Texture> m_Heatmap;
+	std::vector<uint32_t> m_Counts; // readback, RGBA8 with the count in red
+	std::vector<uint32_t> m_HeatmapPixels;
+	uint32_t m_Palette[256];
+	uint32_t m_Width;
+	uint32_t m_Height;
+	uint32_t m_Scale;
+	bool m_Active; // between a Begin and End that actually redirected the scene
+
+	OverdrawStats m_Stats;
+};
+
+// every recorded frame plus their averages and the worst frame, for comparing scenes and settings offline
+bool WriteOverdrawJSON(const char* path, const char* scene, const std::vector<OverdrawStats>& frames);
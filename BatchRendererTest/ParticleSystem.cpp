@@ -0,0 +1,202 @@
+#include "ParticleSystem.h"
+
+#include "WorkerPool.h"
+
+#include <xmmintrin.h>
+
+static float* AllocateLane(uint32_t count)
+{
+	return (float*)_mm_malloc(sizeof(float) * count, 16);
+}
+
+ParticleSystem::ParticleSystem(uint32_t maxParticles, uint32_t threadCount)
+	: m_MaxParticles(maxParticles), m_Count(0), m_ThreadCount(threadCount < 1 ? 1 : threadCount), m_RandomState(0x9e3779b9)
+{
+	uint32_t padded = (maxParticles + 3) & ~3u;
+
+	m_PositionX = AllocateLane(padded);
+	m_PositionY = AllocateLane(padded);
+	m_PositionZ = AllocateLane(padded);
+	m_VelocityX = AllocateLane(padded);
+	m_VelocityY = AllocateLane(padded);
+	m_VelocityZ = AllocateLane(padded);
+	m_Life = AllocateLane(padded);
+	m_InvLifeTime = AllocateLane(padded);
+	m_Size = AllocateLane(padded);
+
+	m_ColorBegin = new Vec3[padded];
+	m_ColorEnd = new Vec3[padded];
+
+	m_Dead.resize(m_ThreadCount);
+}
+
+ParticleSystem::~ParticleSystem()
+{
+	_mm_free(m_PositionX);
+	_mm_free(m_PositionY);
+	_mm_free(m_PositionZ);
+	_mm_free(m_VelocityX);
+	_mm_free(m_VelocityY);
+	_mm_free(m_VelocityZ);
+	_mm_free(m_Life);
+	_mm_free(m_InvLifeTime);
+	_mm_free(m_Size);
+
+	delete[] m_ColorBegin;
+	delete[] m_ColorEnd;
+}
+
+uint32_t ParticleSystem::Emit(const ParticleEmitDesc& desc, uint32_t count)
+{
+	if (count > m_MaxParticles - m_Count)
+		count = m_MaxParticles - m_Count;
+
+	for (uint32_t i = m_Count; i < m_Count + count; i++)
+	{
+		m_PositionX[i] = desc.Position.X + desc.PositionVariance.X * RandomFloat();
+		m_PositionY[i] = desc.Position.Y + desc.PositionVariance.Y * RandomFloat();
+		m_PositionZ[i] = desc.Position.Z + desc.PositionVariance.Z * RandomFloat();
+		m_VelocityX[i] = desc.Velocity.X + desc.VelocityVariance.X * RandomFloat();
+		m_VelocityY[i] = desc.Velocity.Y + desc.VelocityVariance.Y * RandomFloat();
+		m_VelocityZ[i] = desc.Velocity.Z + desc.VelocityVariance.Z * RandomFloat();
+		m_Life[i] = desc.LifeTime;
+		m_InvLifeTime[i] = 1.0f / desc.LifeTime;
+		m_Size[i] = desc.Size;
+		m_ColorBegin[i] = desc.ColorBegin;
+		m_ColorEnd[i] = desc.ColorEnd;
+	}
+
+	m_Count += count;
+	return count;
+}
+
+void ParticleSystem::Update(float deltaTime, Vec3 gravity)
+{
+	if (m_Count == 0)
+		return;
+
+	// ranges are multiples of 4 so every thread starts on an aligned lane, the padding absorbs the tail
+	uint32_t groups = (m_Count + 3) / 4;
+	uint32_t groupsPerThread = groups / m_ThreadCount;
+
+	// room for the whole range to die, so the workers never grow them, this only allocates when a range is
+	// bigger than it has ever been
+	for (uint32_t t = 0; t < m_ThreadCount; t++)
+		m_Dead[t].reserve(t == m_ThreadCount - 1 ? m_Count - t * groupsPerThread * 4 : groupsPerThread * 4);
+
+	WorkerPool::Get().Run(m_ThreadCount, [this, groupsPerThread, deltaTime, gravity](uint32_t thread)
+	{
+		uint32_t begin = thread * groupsPerThread * 4;
+		uint32_t end = thread == m_ThreadCount - 1 ? m_Count : begin + groupsPerThread * 4;
+		Integrate(thread, begin, end, deltaTime, gravity);
+	});
+
+	// swap-remove from the highest index down: everything after the current index is already
+	// compacted, so the particle we move in from the back is always alive
+	for (int32_t t = m_ThreadCount - 1; t >= 0; t--)
+	{
+		std::vector<uint32_t>& dead = m_Dead[t];
+		for (int32_t i = (int32_t)dead.size() - 1; i >= 0; i--)
+		{
+			Kill(dead[i]);
+		}
+		dead.clear();
+	}
+}
+
+void ParticleSystem::Integrate(uint32_t thread, uint32_t begin, uint32_t end, float deltaTime, Vec3 gravity)
+{
+	const __m128 dt = _mm_set1_ps(deltaTime);
+	const __m128 gx = _mm_set1_ps(gravity.X * deltaTime);
+	const __m128 gy = _mm_set1_ps(gravity.Y * deltaTime);
+	const __m128 gz = _mm_set1_ps(gravity.Z * deltaTime);
+	const __m128 zero = _mm_setzero_ps();
+
+	std::vector<uint32_t>& dead = m_Dead[thread];
+
+	// only the last range can end unaligned, the lanes after it are padding (or stale dead particles)
+	// so integrating them is harmless, they are just never reported as dead
+	for (uint32_t i = begin; i < end; i += 4)
+	{
+		__m128 vx = _mm_add_ps(_mm_load_ps(m_VelocityX + i), gx);
+		__m128 vy = _mm_add_ps(_mm_load_ps(m_VelocityY + i), gy);
+		__m128 vz = _mm_add_ps(_mm_load_ps(m_VelocityZ + i), gz);
+
+		_mm_store_ps(m_VelocityX + i, vx);
+		_mm_store_ps(m_VelocityY + i, vy);
+		_mm_store_ps(m_VelocityZ + i, vz);
+
+		_mm_store_ps(m_PositionX + i, _mm_add_ps(_mm_load_ps(m_PositionX + i), _mm_mul_ps(vx, dt)));
+		_mm_store_ps(m_PositionY + i, _mm_add_ps(_mm_load_ps(m_PositionY + i), _mm_mul_ps(vy, dt)));
+		_mm_store_ps(m_PositionZ + i, _mm_add_ps(_mm_load_ps(m_PositionZ + i), _mm_mul_ps(vz, dt)));
+
+		__m128 life = _mm_sub_ps(_mm_load_ps(m_Life + i), dt);
+		_mm_store_ps(m_Life + i, life);
+
+		int32_t deadMask = _mm_movemask_ps(_mm_cmple_ps(life, zero));
+		if (deadMask)
+		{
+			for (uint32_t lane = 0; lane < 4 && i + lane < end; lane++)
+			{
+				if (deadMask & (1 << lane))
+					dead.push_back(i + lane);
+			}
+		}
+	}
+}
+
+void ParticleSystem::Kill(uint32_t index)
+{
+	uint32_t last = --m_Count;
+	if (index == last)
+		return;
+
+	m_PositionX[index] = m_PositionX[last];
+	m_PositionY[index] = m_PositionY[last];
+	m_PositionZ[index] = m_PositionZ[last];
+	m_VelocityX[index] = m_VelocityX[last];
+	m_VelocityY[index] = m_VelocityY[last];
+	m_VelocityZ[index] = m_VelocityZ[last];
+	m_Life[index] = m_Life[last];
+	m_InvLifeTime[index] = m_InvLifeTime[last];
+	m_Size[index] = m_Size[last];
+	m_ColorBegin[index] = m_ColorBegin[last];
+	m_ColorEnd[index] = m_ColorEnd[last];
+}
+
+void ParticleSystem::WriteVertices(Vertex* vertices, uint32_t first, uint32_t count, float textureIndex) const
+{
+	for (uint32_t i = first; i < first + count; i++)
+	{
+		float halfSize = m_Size[i] * 0.5f;
+		float x = m_PositionX[i];
+		float y = m_PositionY[i];
+		float z = m_PositionZ[i];
+
+		// goes from ColorBegin to ColorEnd over the lifetime
+		float t = m_Life[i] * m_InvLifeTime[i];
+		Vec3 color =
+		{
+			m_ColorEnd[i].X + (m_ColorBegin[i].X - m_ColorEnd[i].X) * t,
+			m_ColorEnd[i].Y + (m_ColorBegin[i].Y - m_ColorEnd[i].Y) * t,
+			m_ColorEnd[i].Z + (m_ColorBegin[i].Z - m_ColorEnd[i].Z) * t
+		};
+
+		// same corner order and texture coordinates as QuadVertices / GetTextCoordinates
+		vertices[0] = { { x - halfSize, y - halfSize, z }, color, { 0.0f, 1.0f }, textureIndex };
+		vertices[1] = { { x + halfSize, y - halfSize, z }, color, { 1.0f, 1.0f }, textureIndex };
+		vertices[2] = { { x + halfSize, y + halfSize, z }, color, { 1.0f, 0.0f }, textureIndex };
+		vertices[3] = { { x - halfSize, y + halfSize, z }, color, { 0.0f, 0.0f }, textureIndex };
+		vertices += 4;
+	}
+}
+
+float ParticleSystem::RandomFloat()
+{
+	// xorshift32, plenty for spreading particles around
+	m_RandomState ^= m_RandomState << 13;
+	m_RandomState ^= m_RandomState >> 17;
+	m_RandomState ^= m_RandomState << 5;
+
+	return (m_RandomState & 0xffffff) / (float)0x800000 - 1.0f;
+}
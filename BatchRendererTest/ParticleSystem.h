@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "Math.h"
+#include "Vertex.h"
+
+struct ParticleEmitDesc
+{
+	Vec3 Position;
+	Vec3 PositionVariance;
+	Vec3 Velocity;
+	Vec3 VelocityVariance;
+	Vec3 ColorBegin;
+	Vec3 ColorEnd;
+	float LifeTime;
+	float Size;
+};
+
+// Particles stored as structure of arrays so integration runs 4 at a time with SSE, split across threads.
+// Dead particles are swap-removed so the live ones are always packed at the front,
+// and they go straight to vertices (WriteVertices) without building a TexturedQuad each.
+class ParticleSystem
+{
+public:
+	ParticleSystem(uint32_t maxParticles, uint32_t threadCount);
+	~ParticleSystem();
+
+	// returns how many were actually emitted, it stops when the pool is full
+	uint32_t Emit(const ParticleEmitDesc& desc, uint32_t count);
+
+	void Update(float deltaTime, Vec3 gravity);
+
+	// 4 vertices per particle for [first, first + count), flat squares on the XY plane
+	void WriteVertices(Vertex* vertices, uint32_t first, uint32_t count, float textureIndex) const;
+
+	inline uint32_t GetCount() const { return m_Count; }
+	inline uint32_t GetMaxParticles() const { return m_MaxParticles; }
+	inline uint32_t GetThreadCount() const { return m_ThreadCount; }
+
+private:
+	void Integrate(uint32_t thread, uint32_t begin, uint32_t end, float deltaTime, Vec3 gravity);
+	void Kill(uint32_t index);
+
+	float RandomFloat(); // -1..1
+
+private:
+	uint32_t m_MaxParticles;
+	uint32_t m_Count;
+
+	// all 16 byte aligned and padded to a multiple of 4
+	float* m_PositionX;
+	float* m_PositionY;
+	float* m_PositionZ;
+	float* m_VelocityX;
+	float* m_VelocityY;
+	float* m_VelocityZ;
+	float* m_Life;
+	float* m_InvLifeTime;
+	float* m_Size;
+	Vec3* m_ColorBegin;
+	Vec3* m_ColorEnd;
+
+	uint32_t m_ThreadCount;
+	std::vector<std::vector<uint32_t>> m_Dead; // per thread, ascending
+
+	uint32_t m_RandomState;
+};
@@ -0,0 +1,152 @@
+#include "QuadStore.h"
+
+#include <chrono>
+
+QuadStore::QuadStore(GpuQuadCuller* culler)
+	: m_Culler(culler), m_SlotCount(0), m_QuadCount(0), m_MergeGap(4), m_Stats()
+{
+	// the slot index has to fit under the generation bits, and slot MaxQuads would collide with InvalidQuad
+	uint32_t capacity = culler->GetCapacity() < MaxQuads ? culler->GetCapacity() : MaxQuads;
+	m_Quads.resize(capacity);
+	m_Generations.resize(capacity, 0);
+	m_Dirty.resize((capacity + 63) / 64, 0);
+}
+
+QuadHandle QuadStore::CreateQuad(const Transform& transform, Vec3 color, uint32_t textureSlot, Vec4 textureRect)
+{
+	return CreateQuad(MakeGpuQuad(transform, color, textureSlot, textureRect));
+}
+
+QuadHandle QuadStore::CreateQuad(const GpuQuad& record)
+{
+	uint32_t slot;
+	if (!m_FreeSlots.empty())
+	{
+		slot = m_FreeSlots.back();
+		m_FreeSlots.pop_back();
+	}
+	else if (m_SlotCount < (uint32_t)m_Quads.size())
+	{
+		slot = m_SlotCount++;
+	}
+	else
+	{
+		return InvalidQuad;
+	}
+
+	// alpha only says whether the slot is taken
+	m_Quads[slot] = record;
+	m_Quads[slot].Color.W = 1.0f;
+	MarkDirty(slot);
+
+	m_QuadCount++;
+	return MakeHandle(slot);
+}
+
+bool QuadStore::UpdateQuad(QuadHandle quad, const Transform& transform, Vec3 color, uint32_t textureSlot, Vec4 textureRect)
+{
+	return UpdateQuad(quad, MakeGpuQuad(transform, color, textureSlot, textureRect));
+}
+
+bool QuadStore::UpdateQuad(QuadHandle quad, const GpuQuad& record)
+{
+	// a free slot stays free, the record would be drawn again otherwise
+	if (!IsValid(quad))
+		return false;
+
+	uint32_t slot = quad & SlotMask;
+	m_Quads[slot] = record;
+	m_Quads[slot].Color.W = 1.0f;
+	MarkDirty(slot);
+	return true;
+}
+
+bool QuadStore::DestroyQuad(QuadHandle quad)
+{
+	// twice would put the slot on the free list twice and hand it out to two quads
+	if (!IsValid(quad))
+		return false;
+
+	// still uploaded, the old record would keep being drawn otherwise
+	uint32_t slot = quad & SlotMask;
+	m_Quads[slot].Color.W = 0.0f;
+	MarkDirty(slot);
+
+	m_Generations[slot]++;
+	m_FreeSlots.push_back(slot);
+	m_QuadCount--;
+	return true;
+}
+
+bool QuadStore::IsValid(QuadHandle quad) const
+{
+	uint32_t slot = quad & SlotMask;
+	return slot < m_SlotCount && m_Generations[slot] == (quad >> SlotBits) && m_Quads[slot].Color.W != 0.0f;
+}
+
+void QuadStore::Flush()
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	m_Ranges.clear();
+	uint32_t dirtySlots = 0;
+	uint64_t uploadSlots = 0;
+
+	uint32_t wordCount = (m_SlotCount + 63) / 64;
+	for (uint32_t word = 0; word < wordCount; word++)
+	{
+		uint64_t bits = m_Dirty[word];
+		if (bits == 0)
+			continue;
+
+		m_Dirty[word] = 0;
+
+		// one run of set bits at a time: skip the zeros below it, then count the ones
+		uint32_t base = word * 64;
+		uint32_t bit = 0;
+		while (bits != 0)
+		{
+			while ((bits & 1) == 0)
+			{
+				bits >>= 1;
+				bit++;
+			}
+
+			uint32_t first = base + bit;
+			uint32_t count = 0;
+			while (bits & 1)
+			{
+				bits >>= 1;
+				bit++;
+				count++;
+			}
+			dirtySlots += count;
+
+			// a run can carry on in the next word, that and close runs both extend the last range
+			if (!m_Ranges.empty())
+			{
+				GpuQuadRange& last = m_Ranges.back();
+				uint32_t gap = first - (last.First + last.Count);
+				if (gap <= m_MergeGap)
+				{
+					uploadSlots += gap + count;
+					last.Count += gap + count;
+					continue;
+				}
+			}
+
+			m_Ranges.push_back({ first, count });
+			uploadSlots += count;
+		}
+	}
+
+	m_Culler->SetQuadRanges(m_Quads.data(), m_Ranges.data(), (uint32_t)m_Ranges.size());
+	m_Culler->SetQuadCount(m_SlotCount);
+
+	std::chrono::duration<float, std::milli> flushTime = std::chrono::steady_clock::now() - start;
+
+	m_Stats.DirtySlots = dirtySlots;
+	m_Stats.Ranges = (uint32_t)m_Ranges.size();
+	m_Stats.UploadBytes = uploadSlots * sizeof(GpuQuad);
+	m_Stats.FlushMs = flushTime.count();
+}
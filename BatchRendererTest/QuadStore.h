@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "GpuQuadCuller.h"
+
+typedef uint32_t QuadHandle;
+
+// last Flush
+struct QuadUploadStats
+{
+	uint32_t DirtySlots; // created, updated or destroyed since the flush before
+	uint32_t Ranges; // glNamedBufferSubData calls
+	uint64_t UploadBytes; // dirty slots plus the clean ones ranges were merged across
+	float FlushMs; // finding the ranges and packing them, on the calling thread
+};
+
+// Retained quads on top of a GpuQuadCuller: every quad owns one slot of its storage buffer until it's destroyed.
+// Create/Update/Destroy only change a CPU copy and set the slot's bit in a dirty bitset, Flush turns the set bits
+// into runs and uploads just those, so a frame where nothing moved uploads nothing.
+// Runs closer than the merge gap are uploaded as one range together with the clean slots between them,
+// a handful of extra bytes is cheaper than another call. Destroyed slots get alpha 0 so the cull pass skips them,
+// and go on a free list for the next Create.
+// A handle is the slot index with the slot's generation in the top bits. Destroy bumps the generation, so a handle
+// that was destroyed, or whose slot went to someone else since, is turned down by Update and Destroy instead of
+// touching the new owner. The generation has 8 bits: a handle kept through 256 reuses of its slot looks alive again.
+class QuadStore
+{
+public:
+	static const QuadHandle InvalidQuad = 0xffffffff;
+
+	// the culler's capacity is the most quads there can be at once, up to MaxQuads
+	QuadStore(GpuQuadCuller* culler);
+
+	static const uint32_t MaxQuads = (1u << 24) - 1;
+
+	// InvalidQuad when every slot is taken
+	QuadHandle CreateQuad(const Transform& transform, Vec3 color, uint32_t textureSlot, Vec4 textureRect = { 0.0f, 0.0f, 1.0f, 1.0f });
+	QuadHandle CreateQuad(const GpuQuad& record);
+	// false and nothing changes when the handle isn't alive
+	bool UpdateQuad(QuadHandle quad, const Transform& transform, Vec3 color, uint32_t textureSlot, Vec4 textureRect = { 0.0f, 0.0f, 1.0f, 1.0f });
+	bool UpdateQuad(QuadHandle quad, const GpuQuad& record);
+	bool DestroyQuad(QuadHandle quad);
+
+	// once a frame before the culler draws
+	void Flush();
+
+	// in slots, 0 only merges runs that touch
+	inline void SetMergeGap(uint32_t slots) { m_MergeGap = slots; }
+	inline uint32_t GetMergeGap() const { return m_MergeGap; }
+
+	// created and not destroyed since
+	bool IsValid(QuadHandle quad) const;
+	// only for a valid handle
+	inline const GpuQuad& GetQuad(QuadHandle quad) const { return m_Quads[quad & SlotMask]; }
+
+	inline uint32_t GetQuadCount() const { return m_QuadCount; }
+	inline uint32_t GetSlotCount() const { return m_SlotCount; } // highest slot ever used + 1, what the culler goes through
+	inline const QuadUploadStats& GetUploadStats() const { return m_Stats; }
+
+private:
+	static const uint32_t SlotBits = 24;
+	static const uint32_t SlotMask = (1u << SlotBits) - 1;
+
+	inline QuadHandle MakeHandle(uint32_t slot) const { return ((QuadHandle)m_Generations[slot] << SlotBits) | slot; }
+	inline void MarkDirty(uint32_t slot) { m_Dirty[slot >> 6] |= 1ull << (slot & 63); }
+
+private:
+	GpuQuadCuller* m_Culler;
+
+	std::vector<GpuQuad> m_Quads; // what the buffer holds after the next Flush, alpha 0 for a free slot
+	std::vector<uint8_t> m_Generations; // per slot, goes up on every Destroy
+	std::vector<uint64_t> m_Dirty; // one bit per slot
+	std::vector<uint32_t> m_FreeSlots;
+	std::vector<GpuQuadRange> m_Ranges; // kept for the capacity
+	uint32_t m_SlotCount;
+	uint32_t m_QuadCount;
+	uint32_t m_MergeGap;
+
+	QuadUploadStats m_Stats;
+};
@@ -0,0 +1,45 @@
+#include "RenderLayer.h"
+
+#include "RenderTarget.h"
+
+RenderLayer::RenderLayer(const std::string& name, uint32_t width, uint32_t height)
+	: m_Name(name), m_Width(width), m_Height(height), m_Dirty(true), m_Invalidations(0), m_Redraws(0), m_Composites(0)
+{
+}
+
+RenderLayer::~RenderLayer()
+{
+}
+
+void RenderLayer::Invalidate()
+{
+	m_Dirty = true;
+	m_Invalidations++;
+}
+
+void RenderLayer::Resize(uint32_t width, uint32_t height)
+{
+	if (width == m_Width && height == m_Height)
+		return;
+
+	m_Width = width;
+	m_Height = height;
+	Invalidate();
+}
+
+bool RenderLayer::BeginRedraw()
+{
+	if (!m_Target || m_Target->GetWidth() != m_Width || m_Target->GetHeight() != m_Height)
+	{
+		m_Target.reset(new RenderTarget(m_Width, m_Height));
+		m_Dirty = true;
+	}
+
+	if (!m_Dirty)
+		return false;
+
+	// cleared before drawing, so an Invalidate in the middle of the scene still gets the next frame redrawn
+	m_Dirty = false;
+	m_Redraws++;
+	return true;
+}
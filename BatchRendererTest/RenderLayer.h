@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <memory>
+
+class RenderTarget;
+
+// A scene that rarely changes (a background, a HUD panel) cached in its own window sized render target.
+// Renderer2D::BeginScene with a layer only draws into the target while the layer is dirty, EndScene composites it
+// over the window with one full screen quad every time. Invalidate whenever what the layer draws changes.
+class RenderLayer
+{
+public:
+	RenderLayer(const std::string& name, uint32_t width, uint32_t height);
+	~RenderLayer();
+
+	RenderLayer(const RenderLayer&) = delete;
+	RenderLayer& operator=(const RenderLayer&) = delete;
+
+	void Invalidate();
+	// the window size, the target is recreated (and redrawn) by the next scene
+	void Resize(uint32_t width, uint32_t height);
+
+	inline bool IsDirty() const { return m_Dirty; }
+	inline const std::string& GetName() const { return m_Name; }
+	inline uint32_t GetWidth() const { return m_Width; }
+	inline uint32_t GetHeight() const { return m_Height; }
+
+	inline uint32_t GetInvalidationCount() const { return m_Invalidations; }
+	inline uint32_t GetRedrawCount() const { return m_Redraws; }
+	inline uint32_t GetCompositeCount() const { return m_Composites; }
+
+private:
+	friend class Renderer2D;
+
+	// creates the target when the size changed, true when the scene has to be drawn
+	bool BeginRedraw();
+
+private:
+	std::string m_Name;
+	std::unique_ptr<RenderTarget> m_Target;
+	uint32_t m_Width;
+	uint32_t m_Height;
+	bool m_Dirty;
+
+	uint32_t m_Invalidations;
+	uint32_t m_Redraws;
+	uint32_t m_Composites;
+};
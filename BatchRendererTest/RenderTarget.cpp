@@ -0,0 +1,45 @@
+#include "RenderTarget.h"
+
+#include "GL/glew.h"
+
+#include "Texture.h"
+#include "RenderThread.h"
+
+RenderTarget::RenderTarget(uint32_t width, uint32_t height, bool mipmaps)
+	: m_FramebufferID(0), m_DepthID(0), m_Width(width), m_Height(height)
+{
+	uint32_t levels = 1;
+	while (mipmaps && ((width | height) >> levels))
+		levels++;
+
+	m_Texture.reset(new Texture(width, height, 4, nullptr, levels));
+
+	uint32_t colorID = m_Texture->GetRendererID();
+	RenderThread::RunSync([this, colorID]()
+	{
+		// whatever is rendered covers the texture exactly once, repeating would bleed the opposite edge in
+		glTextureParameteri(colorID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(colorID, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+		glCreateRenderbuffers(1, &m_DepthID);
+		glNamedRenderbufferStorage(m_DepthID, GL_DEPTH_COMPONENT24, m_Width, m_Height);
+
+		glCreateFramebuffers(1, &m_FramebufferID);
+		glNamedFramebufferTexture(m_FramebufferID, GL_COLOR_ATTACHMENT0, colorID, 0);
+		glNamedFramebufferRenderbuffer(m_FramebufferID, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_DepthID);
+	});
+}
+
+RenderTarget::~RenderTarget()
+{
+	uint32_t framebufferID = m_FramebufferID;
+	uint32_t depthID = m_DepthID;
+
+	// the last reference goes with the command, so the texture is deleted over there after everything that binds it
+	std::shared_ptr<Texture> texture = std::move(m_Texture);
+	RenderThread::Run([framebufferID, depthID, texture]()
+	{
+		glDeleteFramebuffers(1, &framebufferID);
+		glDeleteRenderbuffers(1, &depthID);
+	});
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <memory>
+
+class Texture;
+
+// Offscreen RGBA8 color texture with a depth buffer, drawn into with Renderer2D::SetRenderTarget.
+// The color attachment is a regular Texture, so once rendered it goes through the batcher like any other.
+// OpenGL only, create and delete it on the thread that records GL commands. Batches already recorded may still sample
+// the texture, so it's only deleted once the render thread got past them.
+class RenderTarget
+{
+public:
+	// with mipmaps the texture gets a full chain, call GenerateMipmaps on it after drawing
+	RenderTarget(uint32_t width, uint32_t height, bool mipmaps = false);
+	~RenderTarget();
+
+	RenderTarget(const RenderTarget&) = delete;
+	RenderTarget& operator=(const RenderTarget&) = delete;
+
+	inline Texture* GetTexture() const { return m_Texture.get(); }
+	inline uint32_t GetFramebufferID() const { return m_FramebufferID; }
+	inline uint32_t GetWidth() const { return m_Width; }
+	inline uint32_t GetHeight() const { return m_Height; }
+
+private:
+	std::shared_ptr<Texture> m_Texture;
+	uint32_t m_FramebufferID;
+	uint32_t m_DepthID;
+	uint32_t m_Width;
+	uint32_t m_Height;
+};
@@ -0,0 +1,199 @@
+#include "RenderThread.h"
+
+#include "GLFW/glfw3.h"
+
+#include <future>
+#include <chrono>
+
+RenderThread* RenderThread::s_Instance = nullptr;
+
+RenderThread::RenderThread(GLFWwindow* window, uint32_t maxQueuedFrames)
+	: m_Window(window), m_HasImmediate(false), m_Executing(false), m_Stop(false),
+	m_MaxQueuedFrames(maxQueuedFrames < 1 ? 1 : maxQueuedFrames), m_RecordedCommands(0), m_ExecuteTimeMs(0.0f), m_WaitTimeMs(0.0f)
+{
+	ReserveFrames();
+
+	// a context can only be current on one thread
+	glfwMakeContextCurrent(nullptr);
+
+	m_Thread = std::thread(&RenderThread::ThreadMain, this);
+	s_Instance = this;
+}
+
+RenderThread::~RenderThread()
+{
+	if (!m_Recording.empty())
+		EndFrame();
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stop = true;
+	}
+	m_Condition.notify_all();
+	m_Thread.join();
+
+	s_Instance = nullptr;
+	glfwMakeContextCurrent(m_Window);
+}
+
+void RenderThread::Submit(RenderCommand command)
+{
+	m_Recording.push_back(std::move(command));
+}
+
+void RenderThread::EndFrame()
+{
+	auto start = std::chrono::steady_clock::now();
+
+	m_RecordedCommands = (uint32_t)m_Recording.size();
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_Condition.wait(lock, [this]() { return m_Queue.size() < m_MaxQueuedFrames; });
+
+	m_Queue.push_back(std::move(m_Recording));
+
+	if (!m_FreeFrames.empty())
+	{
+		m_Recording = std::move(m_FreeFrames.back());
+		m_FreeFrames.pop_back();
+	}
+	else
+	{
+		m_Recording = std::vector<RenderCommand>();
+	}
+
+	lock.unlock();
+	m_Condition.notify_all();
+
+	std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	m_WaitTimeMs = elapsed.count();
+}
+
+void RenderThread::WaitIdle()
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_Condition.wait(lock, [this]() { return m_Queue.empty() && !m_Executing; });
+}
+
+void RenderThread::SetMaxQueuedFrames(uint32_t count)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_MaxQueuedFrames = count < 1 ? 1 : count;
+		ReserveFrames();
+	}
+	m_Condition.notify_all();
+}
+
+void RenderThread::ReserveFrames()
+{
+	// the queued ones, the one executing and the one recording are all there is, so neither list grows while they go around
+	m_Queue.reserve(m_MaxQueuedFrames);
+	m_FreeFrames.reserve(m_MaxQueuedFrames + 2);
+}
+
+void RenderThread::Run(RenderCommand command)
+{
+	if (IsRecording())
+		s_Instance->Submit(std::move(command));
+	else
+		command();
+}
+
+void RenderThread::RunSync(RenderCommand command)
+{
+	if (!IsRecording())
+	{
+		command();
+		return;
+	}
+
+	std::promise<void> done;
+	{
+		std::lock_guard<std::mutex> lock(s_Instance->m_Mutex);
+		s_Instance->m_Immediate.push_back([&command, &done]()
+		{
+			command();
+			done.set_value();
+		});
+		s_Instance->m_HasImmediate = true;
+	}
+	s_Instance->m_Condition.notify_all();
+
+	done.get_future().wait();
+}
+
+bool RenderThread::IsRecording()
+{
+	return s_Instance && std::this_thread::get_id() != s_Instance->m_Thread.get_id();
+}
+
+void RenderThread::RunImmediateCommands(std::unique_lock<std::mutex>& lock)
+{
+	std::vector<RenderCommand> immediate;
+	immediate.swap(m_Immediate);
+	m_HasImmediate = false;
+
+	lock.unlock();
+	for (RenderCommand& command : immediate)
+		command();
+	lock.lock();
+}
+
+void RenderThread::ThreadMain()
+{
+	glfwMakeContextCurrent(m_Window);
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	while (true)
+	{
+		m_Condition.wait(lock, [this]() { return m_Stop || m_HasImmediate || !m_Queue.empty(); });
+
+		if (m_HasImmediate)
+			RunImmediateCommands(lock);
+
+		if (m_Queue.empty())
+		{
+			if (m_Stop)
+				break;
+			continue;
+		}
+
+		std::vector<RenderCommand> frame = std::move(m_Queue.front());
+		m_Queue.erase(m_Queue.begin());
+		m_Executing = true;
+		lock.unlock();
+
+		// the game thread may be waiting in EndFrame for the slot we just freed
+		m_Condition.notify_all();
+
+		auto start = std::chrono::steady_clock::now();
+
+		for (RenderCommand& command : frame)
+		{
+			// a RunSync caller is blocked on us, don't make it wait for the whole frame
+			if (m_HasImmediate)
+			{
+				lock.lock();
+				RunImmediateCommands(lock);
+				lock.unlock();
+			}
+
+			command();
+		}
+
+		std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		m_ExecuteTimeMs = elapsed.count();
+
+		// destroyed here so whatever the commands captured is freed on this side
+		frame.clear();
+
+		lock.lock();
+		m_FreeFrames.push_back(std::move(frame));
+		m_Executing = false;
+		m_Condition.notify_all();
+	}
+
+	lock.unlock();
+	glfwMakeContextCurrent(nullptr);
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <new>
+#include <utility>
+#include <type_traits>
+
+struct GLFWwindow;
+
+// A callable stored inside the command itself, so recording one never allocates. Captures are a few pointers,
+// shared_ptrs and ints everywhere, anything bigger than StorageSize doesn't compile: capture a pointer into the
+// frame arena instead. Move only, the one copy of the capture is destroyed where the command ran.
+// 64 bytes with the function pointer, a cache line.
+class RenderCommand
+{
+public:
+	static const size_t StorageSize = 56;
+
+	RenderCommand() : m_Manage(nullptr) {}
+
+	template<typename Function, typename = typename std::enable_if<!std::is_same<typename std::decay<Function>::type, RenderCommand>::value>::type>
+	RenderCommand(Function&& function)
+	{
+		typedef typename std::decay<Function>::type Stored;
+		static_assert(sizeof(Stored) <= StorageSize, "render command capture too big, capture a pointer instead");
+		static_assert(alignof(Stored) <= alignof(void*), "render command capture over-aligned");
+
+		new (m_Storage) Stored(std::forward<Function>(function));
+		m_Manage = &Manage<Stored>;
+	}
+
+	RenderCommand(RenderCommand&& other) noexcept : m_Manage(other.m_Manage)
+	{
+		if (m_Manage)
+			m_Manage(Operation::Move, m_Storage, other.m_Storage);
+		other.m_Manage = nullptr;
+	}
+
+	RenderCommand& operator=(RenderCommand&& other) noexcept
+	{
+		if (this != &other)
+		{
+			Reset();
+			m_Manage = other.m_Manage;
+			if (m_Manage)
+				m_Manage(Operation::Move, m_Storage, other.m_Storage);
+			other.m_Manage = nullptr;
+		}
+		return *this;
+	}
+
+	RenderCommand(const RenderCommand&) = delete;
+	RenderCommand& operator=(const RenderCommand&) = delete;
+
+	~RenderCommand() { Reset(); }
+
+	inline void operator()() { m_Manage(Operation::Invoke, m_Storage, nullptr); }
+	inline explicit operator bool() const { return m_Manage != nullptr; }
+
+private:
+	enum class Operation { Invoke, Move, Destroy };
+
+	// Move destroys what it moved from, the caller clears the other command's pointer
+	template<typename Stored>
+	static void Manage(Operation operation, void* storage, void* other)
+	{
+		switch (operation)
+		{
+			case Operation::Invoke:
+				(*(Stored*)storage)();
+				break;
+			case Operation::Move:
+				new (storage) Stored(std::move(*(Stored*)other));
+				((Stored*)other)->~Stored();
+				break;
+			case Operation::Destroy:
+				((Stored*)storage)->~Stored();
+				break;
+		}
+	}
+
+	inline void Reset()
+	{
+		if (m_Manage)
+			m_Manage(Operation::Destroy, m_Storage, nullptr);
+		m_Manage = nullptr;
+	}
+
+private:
+	void (*m_Manage)(Operation operation, void* storage, void* other);
+	alignas(void*) unsigned char m_Storage[StorageSize];
+};
+
+// Owns the GL context on its own thread: the game thread records frame N while frame N-1 executes.
+// EndFrame hands the recorded commands over and blocks while MaxQueuedFrames are already waiting,
+// so the game can't run further ahead than that (1 = plain double buffering, lowest latency).
+// Anything that touches GL goes through Run, which executes right away when there's no render thread.
+class RenderThread
+{
+public:
+	RenderThread(GLFWwindow* window, uint32_t maxQueuedFrames);
+	~RenderThread(); // runs whatever is queued and gives the context back to the calling thread
+
+	void Submit(RenderCommand command);
+	void EndFrame();
+
+	// blocks until every frame handed over so far has executed
+	void WaitIdle();
+
+	void SetMaxQueuedFrames(uint32_t count);
+	inline uint32_t GetMaxQueuedFrames() const { return m_MaxQueuedFrames; }
+
+	inline float GetExecuteTimeMs() const { return m_ExecuteTimeMs; } // last frame, on the render thread
+	inline float GetWaitTimeMs() const { return m_WaitTimeMs; } // last EndFrame, on the game thread
+	inline uint32_t GetRecordedCommands() const { return m_RecordedCommands; }
+
+	// recorded in the current frame when called from the game thread while a render thread runs, executed right away otherwise
+	static void Run(RenderCommand command);
+	// same but waits for it, it jumps ahead of the queued frames so only use it for things nothing queued depends on (creating resources)
+	static void RunSync(RenderCommand command);
+	// true on the game thread while a render thread is running, that's when GL can't be called directly
+	static bool IsRecording();
+
+private:
+	void ThreadMain();
+	void ReserveFrames(); // with m_Mutex held or before the thread starts
+	void RunImmediateCommands(std::unique_lock<std::mutex>& lock);
+
+private:
+	GLFWwindow* m_Window;
+	std::thread m_Thread;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_Condition;
+
+	std::vector<RenderCommand> m_Recording;
+	std::vector<std::vector<RenderCommand>> m_Queue; // oldest first, never more than MaxQueuedFrames (a deque allocates as it goes)
+	std::vector<std::vector<RenderCommand>> m_FreeFrames; // recycled so the command vectors keep their capacity
+	std::vector<RenderCommand> m_Immediate;
+	std::atomic<bool> m_HasImmediate;
+	bool m_Executing;
+	bool m_Stop;
+
+	uint32_t m_MaxQueuedFrames;
+	uint32_t m_RecordedCommands;
+
+	std::atomic<float> m_ExecuteTimeMs;
+	float m_WaitTimeMs;
+
+	static RenderThread* s_Instance;
+};
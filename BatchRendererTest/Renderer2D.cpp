@@ -0,0 +1,1631 @@
+#include "Renderer2D.h"
+
+#include "GL/glew.h"
+#include "glm/ext.hpp"
+
+#include "Buffer.h"
+#include "Shader.h"
+#include "ShaderLibrary.h"
+#include "GpuQuery.h"
+#include "Texture.h"
+#include "RenderTarget.h"
+#include "RenderLayer.h"
+#include "GpuQuadCuller.h"
+#include "SoftwareRasterizer.h"
+#include "ParticleSystem.h"
+#include "Tilemap.h"
+#include "SceneGraph.h"
+#include "Font.h"
+#include "RenderThread.h"
+#include "WorkerPool.h"
+
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <float.h>
+
+static void GetTextCoordinates(float* coords, Vec4 textureRect)
+{
+	coords[0] = textureRect.X;
+	coords[1] = textureRect.W;
+
+	coords[2] = textureRect.Z;
+	coords[3] = textureRect.W;
+
+	coords[4] = textureRect.Z;
+	coords[5] = textureRect.Y;
+
+	coords[6] = textureRect.X;
+	coords[7] = textureRect.Y;
+}
+
+static inline bool IsWhite(Vec3 color)
+{
+	return color.X == 1.0f && color.Y == 1.0f && color.Z == 1.0f;
+}
+
+glm::mat4 GetViewMatrix(const Camera& camera)
+{
+	return
+		GetRotation(-camera.Transform.Rotation)
+		*
+		glm::translate(glm::mat4(1.0f), -(glm::vec3)camera.Transform.Location);
+}
+
+glm::mat4 GetProjectionMatrix(const Camera& camera)
+{
+	if (camera.Orthographic)
+	{
+		float halfHeight = camera.OrthographicHeight * 0.5f;
+		float halfWidth = halfHeight * camera.AspectRatio;
+		return glm::orthoLH(-halfWidth, halfWidth, -halfHeight, halfHeight, 0.1f, 10000.0f);
+	}
+
+	return glm::perspectiveLH(glm::radians(camera.FOV), camera.AspectRatio, 0.1f, 10000.0f);
+}
+
+static inline void WriteQuadVertices(const TexturedQuad& quad, glm::vec3 location, glm::vec3 halfX, glm::vec3 halfY, Vertex* vertexData)
+{
+	Vec2 quadTextCoords[4];
+	GetTextCoordinates((float*)quadTextCoords, quad.TextureRect);
+	float textureIndex = quad.Shape.X > 0.5f ? PackShape(quad.Shape) : quad.TextureIndex;
+
+	// the unit quad from -0.5 to 0.5, it's flat so only the first two rotation columns matter
+	glm::vec3 corners[4] =
+	{
+		location - halfX - halfY,
+		location + halfX - halfY,
+		location + halfX + halfY,
+		location - halfX + halfY
+	};
+
+	for (uint32_t j = 0; j < 4; j++)
+	{
+		vertexData->Position = { corners[j].x, corners[j].y, corners[j].z };
+		vertexData->Color = quad.ColorTint;
+		vertexData->TextureCoordinates = quadTextCoords[j];
+		vertexData->TextureIndex = textureIndex;
+		vertexData++;
+	}
+}
+
+void CalcVertices(const TexturedQuad* batchData, Vertex* vertexData, uint32_t count)
+{
+	// angles go through SinCos a block at a time, Z first so a block of 2D quads only needs a third of the work
+	const uint32_t blockSize = 64;
+	float angles[blockSize * 3];
+	float sines[blockSize * 3];
+	float cosines[blockSize * 3];
+
+	for (uint32_t first = 0; first < count; first += blockSize)
+	{
+		uint32_t blockCount = count - first < blockSize ? count - first : blockSize;
+		bool zOnly = true;
+
+		for (uint32_t i = 0; i < blockCount; i++)
+		{
+			const Vec3& rotation = batchData[i].Transform.Rotation;
+			angles[i] = glm::radians(rotation.Z);
+			angles[blockCount + i] = glm::radians(rotation.X);
+			angles[blockCount * 2 + i] = glm::radians(rotation.Y);
+			zOnly = zOnly && rotation.X == 0.0f && rotation.Y == 0.0f;
+		}
+
+		SinCos(angles, sines, cosines, zOnly ? blockCount : blockCount * 3);
+
+		for (uint32_t i = 0; i < blockCount; i++)
+		{
+			const TexturedQuad& quad = *batchData;
+			const Transform& transform = quad.Transform;
+			float halfWidth = transform.Scale.X * 0.5f;
+			float halfHeight = transform.Scale.Y * 0.5f;
+
+			glm::vec3 halfX;
+			glm::vec3 halfY;
+
+			if (transform.Rotation.X == 0.0f && transform.Rotation.Y == 0.0f)
+			{
+				float s = sines[i];
+				float c = cosines[i];
+				halfX = { c * halfWidth, s * halfWidth, 0.0f };
+				halfY = { -s * halfHeight, c * halfHeight, 0.0f };
+			}
+			else
+			{
+				glm::mat3 rotation = GetRotation(
+					{ sines[blockCount + i], sines[blockCount * 2 + i], sines[i] },
+					{ cosines[blockCount + i], cosines[blockCount * 2 + i], cosines[i] });
+				halfX = rotation[0] * halfWidth;
+				halfY = rotation[1] * halfHeight;
+			}
+
+			WriteQuadVertices(quad, (glm::vec3)transform.Location, halfX, halfY, vertexData);
+
+			vertexData += 4;
+			batchData++;
+		}
+	}
+}
+
+void CalcSpriteVertices(const SubmittedSprite* sprites, const uint64_t* order, Vertex* vertexData, uint32_t count)
+{
+	Vec2 quadTextCoords[4];
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		const SubmittedSprite& sprite = sprites[(uint32_t)order[i]];
+		const Affine2D& transform = sprite.Transform;
+
+		// the unit quad corners are +-0.5 along both axes, so every corner is the translation +- half of each column
+		float halfAX = transform.A * 0.5f, halfAY = transform.B * 0.5f;
+		float halfCX = transform.C * 0.5f, halfCY = transform.D * 0.5f;
+
+		Vec2 corners[4] =
+		{
+			{ transform.TX - halfAX - halfCX, transform.TY - halfAY - halfCY },
+			{ transform.TX + halfAX - halfCX, transform.TY + halfAY - halfCY },
+			{ transform.TX + halfAX + halfCX, transform.TY + halfAY + halfCY },
+			{ transform.TX - halfAX + halfCX, transform.TY - halfAY + halfCY }
+		};
+
+		GetTextCoordinates((float*)quadTextCoords, sprite.TextureRect);
+
+		for (uint32_t j = 0; j < 4; j++)
+		{
+			vertexData->Position = { corners[j].X, corners[j].Y, 0.0f };
+			vertexData->Color = sprite.Color;
+			vertexData->TextureCoordinates = quadTextCoords[j];
+			vertexData->TextureIndex = sprite.TextureIndex;
+			vertexData++;
+		}
+	}
+}
+
+void CalcSceneGraphVertices(const SceneGraph* scene, const uint32_t* nodes, const float* textureSlots, Vertex* vertexData, uint32_t count)
+{
+	const Vec4 textureRect = GetTilingRect(1.0f);
+	Vec2 quadTextCoords[4];
+	GetTextCoordinates((float*)quadTextCoords, textureRect);
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		uint32_t node = nodes[i];
+		const glm::mat4& world = scene->GetWorld(node);
+		Vec3 color = scene->GetColor(node);
+
+		// same as the Transform path, the unit quad only needs the first two columns
+		glm::vec3 location = world[3];
+		glm::vec3 halfX = glm::vec3(world[0]) * 0.5f;
+		glm::vec3 halfY = glm::vec3(world[1]) * 0.5f;
+
+		glm::vec3 corners[4] =
+		{
+			location - halfX - halfY,
+			location + halfX - halfY,
+			location + halfX + halfY,
+			location - halfX + halfY
+		};
+
+		for (uint32_t j = 0; j < 4; j++)
+		{
+			vertexData->Position = { corners[j].x, corners[j].y, corners[j].z };
+			vertexData->Color = color;
+			vertexData->TextureCoordinates = quadTextCoords[j];
+			vertexData->TextureIndex = textureSlots[i];
+			vertexData++;
+		}
+	}
+}
+
+////////////////////////////////////////////////
+/////////////// SUBMISSION CONTEXT /////////////
+////////////////////////////////////////////////
+
+void SubmissionContext::DrawQuad(const Transform& transform, Vec3 color)
+{
+	DrawQuadTexturedRect(transform, m_Renderer->GetWhiteTexture(), GetTilingRect(1.0f), color, ShaderFeature_None);
+}
+
+void SubmissionContext::DrawQuadTextured(const Transform& transform, Texture* texture, float tilingFactor, Vec3 colorTint)
+{
+	uint32_t features = ShaderFeature_None;
+	if (texture != m_Renderer->GetWhiteTexture())
+		features = m_Renderer->GetAlphaTest() ? (ShaderFeature_Textured | ShaderFeature_AlphaTest) : ShaderFeature_Textured;
+
+	DrawQuadTexturedRect(transform, texture, GetTilingRect(tilingFactor), colorTint, features);
+}
+
+void SubmissionContext::DrawQuadTexturedRect(const Transform& transform, Texture* texture, Vec4 textureRect, Vec3 colorTint, uint32_t features)
+{
+	SubmittedQuad submitted;
+	submitted.Quad.Transform = transform;
+	submitted.Quad.ColorTint = colorTint;
+	submitted.Quad.TextureIndex = 0.0f; // resolved on merge
+	submitted.Quad.TextureRect = textureRect;
+	submitted.Quad.Shape = {};
+	submitted.BoundTexture = texture;
+	submitted.Features = IsWhite(colorTint) ? features : (features | ShaderFeature_Tinted);
+
+	m_Quads.push_back(submitted);
+}
+
+////////////////////////////////////////////////
+/////////////// RENDERER 2D ////////////////////
+////////////////////////////////////////////////
+
+// everything the GL side needs to draw a batch, captured by value so it can run a frame later on the render thread
+struct QuadBatchCommand
+{
+	uint32_t Features;
+	uint32_t QuadCount;
+	// GL names rather than Texture*, a texture deleted after the draw was recorded
+	// is only gone once its glDeleteTextures runs, and that's queued behind this
+	uint32_t TextureIDs[MAX_TEXTURE_SLOTS];
+	uint32_t TextureCount;
+	glm::mat4 View;
+	glm::mat4 Proj;
+	SdfTextStyle SdfStyle;
+	uint32_t SdfAtlasSize;
+	bool DepthTest;
+	bool Overdraw;
+	bool Premultiplied;
+};
+
+// the batch, tilemap and gpu quads commands are allocated in the frame arena and captured by pointer,
+// that keeps the lambdas small enough for std::function to store without allocating
+struct GpuQuadsCommand
+{
+	GpuQuadCuller* Culler;
+	uint32_t QuadCount;
+	glm::mat4 View;
+	glm::mat4 Proj;
+};
+
+struct TilemapCommand
+{
+	Tilemap* Map;
+	const TilemapFrame* Frame;
+	uint32_t Features;
+	glm::mat4 View;
+	glm::mat4 Proj;
+	bool Overdraw;
+};
+
+Renderer2DFrame::Renderer2DFrame(uint64_t arenaSize)
+	: Arena(arenaSize), TilemapCount(0), InFlight(false)
+{
+}
+
+Renderer2DFrame::~Renderer2DFrame()
+{
+}
+
+Renderer2DResources::~Renderer2DResources()
+{
+	if (PresentFramebuffer)
+	{
+		glDeleteFramebuffers(1, &PresentFramebuffer);
+		glDeleteTextures(1, &PresentTexture);
+	}
+}
+
+Renderer2D::Renderer2D(const Renderer2DConfig& config)
+	: m_Config(config), m_Resources(std::make_shared<Renderer2DResources>()), m_Frame(nullptr), m_RenderTarget(nullptr), m_Layer(nullptr), m_BatchVertices(nullptr), m_QuadCount(0), m_BatchFeatures(0), m_TextureCount(1),
+	m_SpriteBatch(false), m_CompositeBatch(false), m_SortSubmissions(false), m_DepthSort(false), m_View(1.0f), m_Proj(1.0f), m_AlphaTest(false), m_Overdraw(false), m_SdfAtlasSize(1024), m_Stats()
+{
+	if (m_Config.ThreadCount == 0)
+		m_Config.ThreadCount = std::thread::hardware_concurrency();
+	if (m_Config.ThreadCount == 0)
+		m_Config.ThreadCount = 1;
+
+	// slot 0 is the white texture, so a textured quad needs at least a second one
+	if (m_Config.TextureSlots < 2)
+		m_Config.TextureSlots = 2;
+	if (m_Config.TextureSlots > MAX_TEXTURE_SLOTS)
+		m_Config.TextureSlots = MAX_TEXTURE_SLOTS;
+
+	if (m_Config.MaxQuads < 1)
+		m_Config.MaxQuads = 1;
+	if (m_Config.SubmissionContexts < 1)
+		m_Config.SubmissionContexts = 1;
+
+	m_SdfStyle = { { 0.0f, 0.0f, 0.0f }, 2.0f, { 0.05f, 0.05f, 0.05f }, 3.0f };
+
+	m_QuadBatch.resize(m_Config.MaxQuads);
+	m_TextureSlots.resize(m_Config.TextureSlots, nullptr);
+
+	m_SubmissionContexts.resize(m_Config.SubmissionContexts);
+	for (SubmissionContext& context : m_SubmissionContexts)
+		context.m_Renderer = this;
+
+	Renderer2DResources& resources = *m_Resources;
+
+	if (m_Config.Backend == RendererBackend::Software)
+	{
+		m_Rasterizer.reset(new SoftwareRasterizer(m_Config.Width, m_Config.Height, m_Config.ThreadCount));
+	}
+	else
+	{
+		uint32_t maxQuads = m_Config.MaxQuads;
+
+		RenderThread::RunSync([&resources, maxQuads]()
+		{
+			std::vector<uint32_t> indices(maxQuads * 6);
+			for (uint32_t i = 0, offset = 0, valOffset = 0; i < maxQuads; i++, offset += 6, valOffset = 4 * i)
+			{
+				indices[0 + offset] = 0 + valOffset;
+				indices[1 + offset] = 1 + valOffset;
+				indices[2 + offset] = 2 + valOffset;
+				indices[3 + offset] = 2 + valOffset;
+				indices[4 + offset] = 3 + valOffset;
+				indices[5 + offset] = 0 + valOffset;
+			}
+
+			resources.Vertices.reset(new VertexBuffer(nullptr, sizeof(Vertex) * maxQuads * 4));
+			resources.Vertices->SetLayout(GetVertexLayout());
+			resources.Indices.reset(new IndexBuffer(indices.data(), sizeof(uint32_t) * indices.size()));
+
+			// doesn't own the buffers, they're deleted with the resources
+			resources.QuadArray.reset(new VertexArray(resources.Vertices.get(), resources.Indices.get()));
+
+			// compiled in the background, batches draw with the fallback until it's ready
+			resources.Shaders.reset(new ShaderLibrary());
+			for (uint32_t features = 0; features < SHADER_PERMUTATION_COUNT; features++)
+			{
+				resources.Permutations[features] = ::GetPermutationName("quad", features);
+				resources.Shaders->Add(resources.Permutations[features], "res/vertex.txt", "res/fragment.txt", GetPermutationDefines(features));
+			}
+
+			resources.SceneTimer.reset(new GpuQuery(GL_TIME_ELAPSED));
+			if (GLEW_VERSION_4_6 || GLEW_ARB_pipeline_statistics_query)
+				resources.FragmentInvocations.reset(new GpuQuery(GL_FRAGMENT_SHADER_INVOCATIONS));
+		});
+	}
+
+	uint32_t whitePixel = 0xffffffff;
+	resources.WhiteTexture.reset(new Texture(1, 1, 4, (unsigned char*)&whitePixel, 1, UsesCpuTextures()));
+	m_TextureSlots[0] = resources.WhiteTexture.get();
+}
+
+Renderer2D::~Renderer2D()
+{
+	// hands the last reference to the GL side, so the objects are deleted after whatever is still queued for them
+	std::shared_ptr<Renderer2DResources> resources = std::move(m_Resources);
+	RenderThread::Run([resources]() {});
+}
+
+VertexLayout Renderer2D::GetVertexLayout()
+{
+	return VertexLayout
+	({
+		{ ShaderDataType::Float3, false },
+		{ ShaderDataType::Float3, false },
+		{ ShaderDataType::Float2, false },
+		{ ShaderDataType::Float, false }
+	});
+}
+
+uint64_t Renderer2D::GetSceneTimeNs() const
+{
+	return m_Resources->SceneTimer ? m_Resources->SceneTimer->GetResult() : 0;
+}
+
+bool Renderer2D::GetFragmentInvocations(uint64_t& invocations) const
+{
+	if (!m_Resources->FragmentInvocations)
+		return false;
+
+	invocations = m_Resources->FragmentInvocations->GetResult();
+	return true;
+}
+
+// the first frame the render thread is done with, a new one only while the number of frames in flight goes up
+void Renderer2D::AcquireFrame()
+{
+	std::vector<std::unique_ptr<Renderer2DFrame>>& frames = m_Resources->Frames;
+
+	m_Frame = nullptr;
+	for (std::unique_ptr<Renderer2DFrame>& frame : frames)
+	{
+		if (!frame->InFlight.load())
+		{
+			m_Frame = frame.get();
+			break;
+		}
+	}
+
+	if (!m_Frame)
+	{
+		frames.emplace_back(new Renderer2DFrame(m_Config.FrameArenaSize));
+		m_Frame = frames.back().get();
+	}
+
+	m_Frame->Arena.Reset();
+	m_Frame->TilemapCount = 0;
+	m_Frame->InFlight = true;
+}
+
+TilemapFrame* Renderer2D::AcquireTilemapFrame()
+{
+	std::vector<std::unique_ptr<TilemapFrame>>& tilemaps = m_Frame->Tilemaps;
+
+	if (m_Frame->TilemapCount == tilemaps.size())
+		tilemaps.emplace_back(new TilemapFrame());
+
+	return tilemaps[m_Frame->TilemapCount++].get();
+}
+
+void Renderer2D::BeginScene(const Camera& camera)
+{
+	memset(&m_Stats, 0, sizeof(m_Stats));
+	m_Stats.TextureCount = 1; // white texture
+
+	AcquireFrame();
+
+	if (m_Config.Backend == RendererBackend::OpenGL)
+	{
+		std::shared_ptr<Renderer2DResources> resources = m_Resources;
+		RenderThread::Run([resources]()
+		{
+			resources->Shaders->Poll();
+
+			// another renderer (or ImGui) may have bound its own program since our last scene
+			resources->BoundShader = nullptr;
+
+			glEnable(GL_DEPTH_TEST);
+
+			resources->SceneTimer->Begin();
+			if (resources->FragmentInvocations)
+				resources->FragmentInvocations->Begin();
+		});
+	}
+
+	m_View = GetViewMatrix(camera);
+	m_Proj = GetProjectionMatrix(camera);
+}
+
+bool Renderer2D::BeginScene(const Camera& camera, RenderLayer* layer)
+{
+	if (m_Config.Backend == RendererBackend::Software || layer->GetWidth() == 0 || layer->GetHeight() == 0)
+	{
+		BeginScene(camera);
+		return m_Config.Backend == RendererBackend::Software;
+	}
+
+	bool redraw = layer->BeginRedraw();
+	if (redraw)
+	{
+		SetRenderTarget(layer->m_Target.get());
+		Clear({ 0.0f, 0.0f, 0.0f }, 0.0f);
+	}
+
+	BeginScene(camera);
+	m_Layer = layer;
+
+	return redraw;
+}
+
+void Renderer2D::EndScene()
+{
+	MergeSubmissionContexts();
+
+	if (m_QuadCount > 0 || m_TextureCount > 1)
+		Flush();
+
+	FlushDepthSorted();
+	FlushSprites();
+
+	if (m_Layer)
+		CompositeLayer();
+
+	m_Stats.FrameArenaUsed = m_Frame->Arena.GetUsed();
+	m_Stats.FrameArenaOverflows = m_Frame->Arena.GetOverflowCount();
+	m_Stats.FrameArenaLargePages = m_Frame->Arena.IsLargePages();
+	m_Stats.FrameArenaCount = (uint32_t)m_Resources->Frames.size();
+	for (const std::unique_ptr<Renderer2DFrame>& frame : m_Resources->Frames)
+	{
+		if (frame->Arena.GetHighWater() > m_Stats.FrameArenaHighWater)
+			m_Stats.FrameArenaHighWater = frame->Arena.GetHighWater();
+		if (frame->Arena.GetCapacity() > m_Stats.FrameArenaCapacity)
+			m_Stats.FrameArenaCapacity = frame->Arena.GetCapacity();
+	}
+
+	Renderer2DFrame* frame = m_Frame;
+	m_Frame = nullptr;
+
+	if (m_Config.Backend == RendererBackend::OpenGL)
+	{
+		// last command of the scene, once it ran nothing reads the arena anymore
+		std::shared_ptr<Renderer2DResources> resources = m_Resources;
+		RenderThread::Run([resources, frame]()
+		{
+			resources->SceneTimer->End();
+			if (resources->FragmentInvocations)
+				resources->FragmentInvocations->End();
+			frame->InFlight = false;
+		});
+	}
+	else
+	{
+		frame->InFlight = false;
+	}
+}
+
+void Renderer2D::Clear(Vec3 color, float alpha)
+{
+	if (m_Config.Backend == RendererBackend::Software)
+	{
+		m_Rasterizer->Clear(color);
+		return;
+	}
+
+	RenderThread::Run([color, alpha]()
+	{
+		glClearColor(color.X, color.Y, color.Z, alpha);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	});
+}
+
+void Renderer2D::SetOverdrawMode(bool enabled)
+{
+	if (m_Config.Backend == RendererBackend::Software)
+		return;
+
+	// a batch still waiting for its flush would be drawn in the new mode
+	if (m_QuadCount > 0 || m_TextureCount > 1)
+		Flush();
+
+	m_Overdraw = enabled;
+
+	if (!enabled)
+		return;
+
+	// the names only change over there, until they're set GetProgram keeps handing out the regular permutations
+	std::shared_ptr<Renderer2DResources> resources = m_Resources;
+	RenderThread::Run([resources]()
+	{
+		if (!resources->OverdrawPermutations[0].empty())
+			return;
+
+		for (uint32_t features = 0; features < SHADER_PERMUTATION_COUNT; features++)
+		{
+			std::string name = ::GetPermutationName("quad", features) + "_overdraw";
+			resources->Shaders->Add(name, "res/vertex.txt", "res/fragment.txt", GetPermutationDefines(features) + "#define OVERDRAW 1\n");
+			resources->OverdrawPermutations[features] = name;
+		}
+	});
+}
+
+void Renderer2D::ClearDepth()
+{
+	if (m_Config.Backend == RendererBackend::Software)
+	{
+		m_Rasterizer->ClearDepth();
+		return;
+	}
+
+	RenderThread::Run([]()
+	{
+		glClear(GL_DEPTH_BUFFER_BIT);
+	});
+}
+
+void Renderer2D::SetRenderTarget(RenderTarget* target)
+{
+	if (m_Config.Backend == RendererBackend::Software || target == m_RenderTarget)
+		return;
+
+	// only the viewport of the window is worth saving, switching between two targets doesn't overwrite it
+	bool fromWindow = !m_RenderTarget;
+	m_RenderTarget = target;
+
+	std::shared_ptr<Renderer2DResources> resources = m_Resources;
+
+	if (target)
+	{
+		uint32_t framebufferID = target->GetFramebufferID();
+		uint32_t width = target->GetWidth();
+		uint32_t height = target->GetHeight();
+
+		RenderThread::Run([resources, framebufferID, width, height, fromWindow]()
+		{
+			if (fromWindow)
+				glGetIntegerv(GL_VIEWPORT, resources->WindowViewport);
+
+			glBindFramebuffer(GL_FRAMEBUFFER, framebufferID);
+			glViewport(0, 0, width, height);
+		});
+	}
+	else
+	{
+		RenderThread::Run([resources]()
+		{
+			const int32_t* viewport = resources->WindowViewport;
+			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+			glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+		});
+	}
+}
+
+void Renderer2D::Resize(uint32_t width, uint32_t height)
+{
+	m_Config.Width = width;
+	m_Config.Height = height;
+
+	if (m_Rasterizer)
+		m_Rasterizer->Resize(width, height);
+}
+
+// copies the software color buffer into the window, ImGui still draws on top with GL
+void Renderer2D::Present()
+{
+	if (m_Config.Backend != RendererBackend::Software)
+		return;
+
+	Renderer2DResources& resources = *m_Resources;
+
+	uint32_t width = m_Rasterizer->GetWidth();
+	uint32_t height = m_Rasterizer->GetHeight();
+
+	if (width == 0 || height == 0)
+		return;
+
+	if (width != resources.PresentWidth || height != resources.PresentHeight)
+	{
+		glDeleteFramebuffers(1, &resources.PresentFramebuffer);
+		glDeleteTextures(1, &resources.PresentTexture);
+
+		glCreateTextures(GL_TEXTURE_2D, 1, &resources.PresentTexture);
+		glTextureStorage2D(resources.PresentTexture, 1, GL_RGBA8, width, height);
+
+		glCreateFramebuffers(1, &resources.PresentFramebuffer);
+		glNamedFramebufferTexture(resources.PresentFramebuffer, GL_COLOR_ATTACHMENT0, resources.PresentTexture, 0);
+
+		resources.PresentWidth = width;
+		resources.PresentHeight = height;
+	}
+
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, m_Rasterizer->GetStride());
+	glTextureSubImage2D(resources.PresentTexture, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, m_Rasterizer->GetColorBuffer());
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+	glBlitNamedFramebuffer(resources.PresentFramebuffer, 0, 0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+}
+
+int32_t Renderer2D::FindTexture(Texture* texture) const
+{
+	for (uint32_t i = 0; i < m_TextureCount; i++)
+	{
+		if (m_TextureSlots[i] == texture)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+uint32_t Renderer2D::GetTextureSlot(Texture* texture)
+{
+	int32_t slot = FindTexture(texture);
+	if (slot != -1)
+		return slot;
+
+	m_TextureSlots[m_TextureCount++] = texture;
+	m_Stats.TextureCount++;
+
+	return m_TextureCount - 1;
+}
+
+void Renderer2D::ClearTextures()
+{
+	m_TextureCount = 1;
+	for (uint32_t i = 1; i < m_Config.TextureSlots; i++)
+	{
+		m_TextureSlots[i] = nullptr;
+	}
+}
+
+void Renderer2D::BuildVertexBuffer()
+{
+	uint32_t threadCount = m_Config.ThreadCount;
+	uint32_t quadCount = m_QuadCount;
+	uint32_t quadsPerThread = quadCount / threadCount;
+	const TexturedQuad* batchData = m_QuadBatch.data();
+	Vertex* vertexData = m_BatchVertices;
+
+	// the last thread takes the remainder
+	WorkerPool::Get().Run(threadCount, [=](uint32_t thread)
+	{
+		uint32_t first = quadsPerThread * thread;
+		uint32_t count = thread == threadCount - 1 ? quadCount - first : quadsPerThread;
+		CalcVertices(batchData + first, vertexData + first * 4, count);
+	});
+}
+
+void Renderer2D::BindShader(Renderer2DResources& resources, Shader* program)
+{
+	if (program == resources.BoundShader)
+		return;
+
+	resources.BoundShader = program;
+	program->Bind();
+
+	int samplers[MAX_TEXTURE_SLOTS];
+	for (int i = 0; i < MAX_TEXTURE_SLOTS; i++)
+		samplers[i] = i;
+	program->SetUniform1iv("u_TexSlots", MAX_TEXTURE_SLOTS, samplers);
+}
+
+// the overdraw permutation once it's there, the regular one while it's still being added or compiled
+Shader* Renderer2D::GetProgram(Renderer2DResources& resources, uint32_t features, bool overdraw)
+{
+	if (overdraw && !resources.OverdrawPermutations[features].empty() && resources.Shaders->IsReady(resources.OverdrawPermutations[features]))
+		return resources.Shaders->Get(resources.OverdrawPermutations[features]);
+
+	return resources.Shaders->Get(resources.Permutations[features]);
+}
+
+void Renderer2D::ExecuteBatch(Renderer2DResources& resources, const QuadBatchCommand& batch, const Vertex* vertices)
+{
+	uint32_t indexCount = batch.QuadCount * 6;
+
+	BindShader(resources, GetProgram(resources, batch.Features, batch.Overdraw));
+	Shader* shader = resources.BoundShader;
+
+	shader->SetUniformMat4("u_View", 1, (float*)glm::value_ptr(batch.View), false);
+	shader->SetUniformMat4("u_Proj", 1, (float*)glm::value_ptr(batch.Proj), false);
+
+	if (batch.Features & ShaderFeature_SDF)
+	{
+		const SdfTextStyle& style = batch.SdfStyle;
+		float texelDistance = Font::SdfPixelDistScale / 255.0f;
+		float shadowOffset = style.ShadowOffset / batch.SdfAtlasSize;
+
+		shader->SetUniform4f("u_SdfOutline", style.OutlineColor.X, style.OutlineColor.Y, style.OutlineColor.Z, style.OutlineWidth * texelDistance);
+		shader->SetUniform4f("u_SdfShadow", style.ShadowColor.X, style.ShadowColor.Y, style.ShadowColor.Z, style.ShadowOffset > 0.0f ? 1.0f : 0.0f);
+		shader->SetUniform2f("u_SdfShadowOffset", shadowOffset, shadowOffset);
+	}
+
+	resources.QuadArray->Bind();
+	resources.Vertices->SetData((float*)vertices, sizeof(Vertex) * 4 * batch.QuadCount, 0);
+
+	for (uint32_t i = 0; i < batch.TextureCount; i++)
+	{
+		glBindTextureUnit(i, batch.TextureIDs[i]);
+	}
+
+	// shape and SDF edge coverage goes out as alpha and layer composites are premultiplied,
+	// the rest of the renderer doesn't blend (overdraw counts add up)
+	bool blend = batch.Overdraw || batch.Premultiplied || (batch.Features & (ShaderFeature_Shape | ShaderFeature_SDF));
+	// the soft edges still test against depth but don't write it, or they'd cut holes in whatever is drawn behind them later
+	bool depthWrite = !blend || batch.Overdraw;
+	if (blend)
+	{
+		glEnable(GL_BLEND);
+		if (batch.Overdraw)
+			glBlendFunc(GL_ONE, GL_ONE);
+		else if (batch.Premultiplied)
+			glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+		else // alpha adds up as coverage, so whatever is drawn into a cleared layer comes out premultiplied
+			glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+	}
+
+	if (!depthWrite)
+		glDepthMask(GL_FALSE);
+
+	if (!batch.DepthTest)
+		glDisable(GL_DEPTH_TEST);
+
+	glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, nullptr);
+
+	if (blend)
+		glDisable(GL_BLEND);
+
+	if (!depthWrite)
+		glDepthMask(GL_TRUE);
+
+	if (!batch.DepthTest)
+		glEnable(GL_DEPTH_TEST);
+}
+
+// draws the first m_QuadCount quads already sitting in m_BatchVertices
+void Renderer2D::SubmitBatch()
+{
+	if (m_Config.Backend == RendererBackend::Software)
+	{
+		m_Rasterizer->SetTextures(m_TextureSlots.data(), m_TextureCount);
+		m_Rasterizer->SetAlphaTest(m_BatchFeatures & ShaderFeature_AlphaTest);
+		m_Rasterizer->SetShapes(m_BatchFeatures & ShaderFeature_Shape);
+		m_Rasterizer->SetSdf(m_BatchFeatures & ShaderFeature_SDF); // no outline/shadow on the cpu
+		// same choice as ExecuteBatch, there's no overdraw mode in software
+		if (m_CompositeBatch)
+			m_Rasterizer->SetBlend(RasterBlend::Premultiplied);
+		else
+			m_Rasterizer->SetBlend(m_BatchFeatures & (ShaderFeature_Shape | ShaderFeature_SDF) ? RasterBlend::Coverage : RasterBlend::None);
+		m_Rasterizer->SetDepthTest(!m_SpriteBatch);
+		m_Rasterizer->DrawQuads(m_BatchVertices, m_QuadCount, m_Proj * m_View);
+	}
+	else
+	{
+		QuadBatchCommand* batch = m_Frame->Arena.Allocate<QuadBatchCommand>(1);
+		batch->Features = m_BatchFeatures;
+		batch->QuadCount = m_QuadCount;
+		batch->TextureCount = m_TextureCount;
+		for (uint32_t i = 0; i < m_TextureCount; i++)
+			batch->TextureIDs[i] = m_TextureSlots[i]->GetRendererID();
+		batch->View = m_View;
+		batch->Proj = m_Proj;
+		batch->SdfStyle = m_SdfStyle;
+		batch->SdfAtlasSize = m_SdfAtlasSize;
+		batch->DepthTest = !m_SpriteBatch;
+		batch->Overdraw = m_Overdraw;
+		batch->Premultiplied = m_CompositeBatch;
+
+		m_Stats.PermutationDraws[m_BatchFeatures]++;
+
+		// the vertices stay in the arena until the render thread is done with this frame
+		std::shared_ptr<Renderer2DResources> resources = m_Resources;
+		const Vertex* vertices = m_BatchVertices;
+		RenderThread::Run([resources, batch, vertices]()
+		{
+			ExecuteBatch(*resources, *batch, vertices);
+		});
+	}
+
+	m_QuadCount = 0;
+	m_BatchFeatures = 0;
+	ClearTextures();
+
+	m_Stats.DrawCalls++;
+}
+
+void Renderer2D::Flush()
+{
+	m_BatchVertices = m_Frame->Arena.Allocate<Vertex>(m_QuadCount * 4);
+	BuildVertexBuffer();
+	SubmitBatch();
+}
+
+// the SDF and shape permutations read the quad differently from everything else, so those never share a batch
+void Renderer2D::FlushOnExclusiveFeatures(uint32_t features)
+{
+	if (m_QuadCount > 0 && ((features ^ m_BatchFeatures) & (ShaderFeature_SDF | ShaderFeature_Shape)))
+	{
+		Flush();
+	}
+}
+
+// the texture slot has to be resolved already, flushes when the batch or the slots are full
+void Renderer2D::PushQuad(const TexturedQuad& quad, uint32_t features)
+{
+	m_QuadBatch[m_QuadCount] = quad;
+	m_BatchFeatures |= features;
+
+	m_QuadCount++;
+	m_Stats.QuadCount++;
+
+	if (m_QuadCount == m_Config.MaxQuads || m_TextureCount == m_Config.TextureSlots)
+	{
+		Flush();
+	}
+}
+
+// into the batch right away, or held back for FlushDepthSorted
+void Renderer2D::SubmitQuad(TexturedQuad quad, Texture* texture, uint32_t features)
+{
+	if (m_DepthSort)
+	{
+		m_DepthQuads.push_back({ quad, texture, features });
+		return;
+	}
+
+	FlushOnExclusiveFeatures(features);
+
+	quad.TextureIndex = (float)GetTextureSlot(texture);
+	PushQuad(quad, features);
+}
+
+void Renderer2D::DrawQuad(const Transform& transform, Vec3 color)
+{
+	TexturedQuad desc;
+	desc.Transform = transform;
+	desc.TextureIndex = 0.0f; // white texture
+	desc.TextureRect = GetTilingRect(1.0f);
+	desc.ColorTint = color;
+	desc.Shape = {};
+
+	SubmitQuad(desc, m_TextureSlots[0], IsWhite(color) ? ShaderFeature_None : ShaderFeature_Tinted);
+}
+
+void Renderer2D::DrawQuadTexturedRect(const Transform& transform, Texture* texture, Vec4 textureRect, Vec3 colorTint, uint32_t features)
+{
+	TexturedQuad desc;
+	desc.Transform = transform;
+	desc.TextureIndex = 0.0f; // resolved by SubmitQuad
+	desc.TextureRect = textureRect;
+	desc.ColorTint = colorTint;
+	desc.Shape = {};
+
+	if (!IsWhite(colorTint))
+		features |= ShaderFeature_Tinted;
+
+	SubmitQuad(desc, texture, features);
+}
+
+void Renderer2D::DrawQuadTextured(const Transform& transform, Texture* texture, float tilingFactor, Vec3 colorTint)
+{
+	uint32_t features = ShaderFeature_None;
+	if (texture != m_TextureSlots[0])
+		features = m_AlphaTest ? (ShaderFeature_Textured | ShaderFeature_AlphaTest) : ShaderFeature_Textured;
+
+	DrawQuadTexturedRect(transform, texture, GetTilingRect(tilingFactor), colorTint, features);
+}
+
+void Renderer2D::DrawShape(const Transform& transform, Vec4 shape, Vec3 color)
+{
+	float halfWidth = transform.Scale.X * 0.5f;
+	float halfHeight = transform.Scale.Y * 0.5f;
+
+	TexturedQuad desc;
+	desc.Transform = transform;
+	desc.TextureIndex = 0.0f; // white texture
+	desc.TextureRect = { -halfWidth, halfHeight, halfWidth, -halfHeight }; // position inside the quad instead of uvs
+	desc.ColorTint = color;
+	desc.Shape = shape;
+
+	SubmitQuad(desc, m_TextureSlots[0], ShaderFeature_Shape | ShaderFeature_Tinted);
+}
+
+void Renderer2D::DrawCircle(Vec3 center, float radius, Vec3 color, float thickness)
+{
+	Transform transform = { center, { 0.0f, 0.0f, 0.0f }, { radius * 2.0f, radius * 2.0f, 1.0f } };
+	DrawShape(transform, { (float)ShapeKind_Circle, radius, thickness, 0.0f }, color);
+}
+
+void Renderer2D::DrawRoundedRect(const Transform& transform, float cornerRadius, Vec3 color)
+{
+	float halfWidth = transform.Scale.X * 0.5f;
+	float halfHeight = transform.Scale.Y * 0.5f;
+	float maxRadius = halfWidth < halfHeight ? halfWidth : halfHeight;
+
+	DrawShape(transform, { (float)ShapeKind_RoundedRect, halfWidth, halfHeight, cornerRadius < maxRadius ? cornerRadius : maxRadius }, color);
+}
+
+// on the XY plane with round caps, a capsule is just a rounded rect with the corner radius at half the thickness
+void Renderer2D::DrawLine(Vec3 from, Vec3 to, float thickness, Vec3 color)
+{
+	float dx = to.X - from.X;
+	float dy = to.Y - from.Y;
+	float length = sqrtf(dx * dx + dy * dy);
+
+	Transform transform;
+	transform.Location = { (from.X + to.X) * 0.5f, (from.Y + to.Y) * 0.5f, (from.Z + to.Z) * 0.5f };
+	transform.Rotation = { 0.0f, 0.0f, glm::degrees(atan2f(dy, dx)) };
+	transform.Scale = { length + thickness, thickness, 1.0f };
+
+	float halfThickness = thickness * 0.5f;
+	DrawShape(transform, { (float)ShapeKind_RoundedRect, (length + thickness) * 0.5f, halfThickness, halfThickness }, color);
+}
+
+void Renderer2D::DrawSprite2D(const Affine2D& transform, Texture* texture, int32_t layer, Vec3 color, Vec4 textureRect)
+{
+	SubmittedSprite sprite;
+	sprite.Transform = transform;
+	sprite.TextureRect = textureRect;
+	sprite.Color = color;
+	sprite.TextureIndex = 0.0f; // resolved in FlushSprites
+	sprite.BoundTexture = texture;
+	sprite.Features = ShaderFeature_None;
+
+	if (texture != m_TextureSlots[0])
+		sprite.Features = m_AlphaTest ? (ShaderFeature_Textured | ShaderFeature_AlphaTest) : ShaderFeature_Textured;
+	if (!IsWhite(color))
+		sprite.Features |= ShaderFeature_Tinted;
+
+	// flipping the sign bit keeps negative layers in front of the positive ones when the keys are compared unsigned
+	uint64_t key = (uint64_t)((uint32_t)layer ^ 0x80000000u) << 32;
+	m_SpriteOrder.push_back(key | (uint32_t)m_Sprites.size());
+	m_Sprites.push_back(sprite);
+}
+
+void Renderer2D::BuildSpriteVertices(uint32_t first, uint32_t count)
+{
+	uint32_t threadCount = m_Config.ThreadCount;
+	uint32_t spritesPerThread = count / threadCount;
+	const SubmittedSprite* sprites = m_Sprites.data();
+	const uint64_t* order = m_SpriteOrder.data() + first;
+	Vertex* vertexData = m_BatchVertices;
+
+	WorkerPool::Get().Run(threadCount, [=](uint32_t thread)
+	{
+		uint32_t begin = spritesPerThread * thread;
+		uint32_t threadSprites = thread == threadCount - 1 ? count - begin : spritesPerThread;
+		CalcSpriteVertices(sprites, order + begin, vertexData + begin * 4, threadSprites);
+	});
+}
+
+// called by EndScene after everything else went out, so sprites end up on top of the rest of the scene
+void Renderer2D::FlushSprites()
+{
+	if (m_Sprites.empty())
+		return;
+
+	// keys are unique, the index in the low half keeps submission order inside a layer
+	std::sort(m_SpriteOrder.begin(), m_SpriteOrder.end());
+
+	m_SpriteBatch = true;
+
+	uint32_t count = (uint32_t)m_SpriteOrder.size();
+	uint32_t first = 0;
+	while (first < count)
+	{
+		// texture slots are resolved serially up to a full batch or full slots, the vertices are built in parallel after
+		uint32_t end = first;
+		uint32_t features = 0;
+		while (end < count && end - first < m_Config.MaxQuads)
+		{
+			SubmittedSprite& sprite = m_Sprites[(uint32_t)m_SpriteOrder[end]];
+			if (FindTexture(sprite.BoundTexture) == -1 && m_TextureCount == m_Config.TextureSlots)
+				break;
+
+			sprite.TextureIndex = (float)GetTextureSlot(sprite.BoundTexture);
+			features |= sprite.Features;
+			end++;
+		}
+
+		m_QuadCount = end - first;
+		m_BatchFeatures = features;
+		m_Stats.QuadCount += m_QuadCount;
+
+		m_BatchVertices = m_Frame->Arena.Allocate<Vertex>(m_QuadCount * 4);
+		BuildSpriteVertices(first, m_QuadCount);
+		SubmitBatch();
+
+		first = end;
+	}
+
+	m_SpriteBatch = false;
+
+	m_Sprites.clear();
+	m_SpriteOrder.clear();
+}
+
+// the layer's texture over the whole window, without the depth test like sprites so it neither tests nor writes depth
+void Renderer2D::CompositeLayer()
+{
+	SetRenderTarget(nullptr);
+
+	TexturedQuad quad;
+	quad.Transform = { { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f }, { 2.0f, 2.0f, 1.0f } };
+	quad.ColorTint = { 1.0f, 1.0f, 1.0f };
+	quad.TextureIndex = (float)GetTextureSlot(m_Layer->m_Target->GetTexture());
+	quad.TextureRect = { 0.0f, 1.0f, 1.0f, 0.0f }; // row 0 of the target is the bottom
+	quad.Shape = {};
+
+	// the unit quad scaled by 2 is exactly clip space
+	m_View = glm::mat4(1.0f);
+	m_Proj = glm::mat4(1.0f);
+
+	// premultiplied over the window, the antialiased edges inside the layer stay soft and the cleared parts let it through
+	m_SpriteBatch = true;
+	m_CompositeBatch = true;
+	PushQuad(quad, ShaderFeature_Textured);
+	if (m_QuadCount > 0)
+		Flush();
+	m_CompositeBatch = false;
+	m_SpriteBatch = false;
+
+	m_Layer->m_Composites++;
+	m_Layer = nullptr;
+}
+
+void Renderer2D::WriteParticleVertices(ParticleSystem* particles, uint32_t first, uint32_t count)
+{
+	uint32_t threadCount = m_Config.ThreadCount;
+	uint32_t particlesPerThread = count / threadCount;
+	Vertex* vertexData = m_BatchVertices;
+
+	WorkerPool::Get().Run(threadCount, [=](uint32_t thread)
+	{
+		uint32_t begin = particlesPerThread * thread;
+		uint32_t threadParticles = thread == threadCount - 1 ? count - begin : particlesPerThread;
+		particles->WriteVertices(vertexData + begin * 4, first + begin, threadParticles, 0.0f);
+	});
+}
+
+// particles go straight from the SoA pools to the batch vertices, no TexturedQuad / CalcVertices in between
+void Renderer2D::DrawParticles(ParticleSystem* particles)
+{
+	if (m_QuadCount > 0)
+		Flush();
+
+	uint32_t maxQuads = m_Config.MaxQuads;
+	uint32_t count = particles->GetCount();
+	for (uint32_t first = 0; first < count; first += maxQuads)
+	{
+		m_QuadCount = count - first < maxQuads ? count - first : maxQuads;
+		m_Stats.QuadCount += m_QuadCount;
+		m_BatchFeatures = ShaderFeature_Tinted; // white texture, the color comes from the particle
+
+		m_BatchVertices = m_Frame->Arena.Allocate<Vertex>(m_QuadCount * 4);
+		WriteParticleVertices(particles, first, m_QuadCount);
+		SubmitBatch();
+	}
+}
+
+// chunks keep their own buffers, so only the pending batch is flushed and the map draws straight from them
+void Renderer2D::DrawTilemap(Tilemap* tilemap)
+{
+	if (m_QuadCount > 0)
+		Flush();
+
+	uint32_t features = tilemap->GetFeatures();
+	if (m_AlphaTest)
+		features |= ShaderFeature_AlphaTest;
+
+	// culling and vertex building stay on this side, the frame carries the result over to GL
+	TilemapFrame* frame = AcquireTilemapFrame();
+
+	if (m_Config.Backend == RendererBackend::Software)
+	{
+		tilemap->Cull(m_Proj * m_View, *frame, false);
+
+		// a full chunk may not fit a small batch
+		Vertex* vertices = m_Frame->Arena.Allocate<Vertex>(Tilemap::ChunkSize * Tilemap::ChunkSize * 4);
+
+		m_Rasterizer->SetTextures(tilemap->GetTextures(), tilemap->GetTextureCount());
+		m_Rasterizer->SetAlphaTest(m_AlphaTest);
+		m_Rasterizer->SetShapes(false);
+		m_Rasterizer->SetSdf(false);
+		m_Rasterizer->SetBlend(RasterBlend::None);
+
+		for (uint32_t chunk : frame->Visible)
+		{
+			uint32_t quads = tilemap->BuildChunkVertices(chunk, vertices);
+			m_Rasterizer->DrawQuads(vertices, quads, m_Proj * m_View);
+			m_Stats.QuadCount += quads;
+			m_Stats.DrawCalls++;
+		}
+		return;
+	}
+
+	tilemap->Cull(m_Proj * m_View, *frame);
+
+	TilemapCommand* command = m_Frame->Arena.Allocate<TilemapCommand>(1);
+	command->Map = tilemap;
+	command->Frame = frame;
+	command->Features = features;
+	command->View = m_View;
+	command->Proj = m_Proj;
+	command->Overdraw = m_Overdraw;
+
+	std::shared_ptr<Renderer2DResources> resources = m_Resources;
+	RenderThread::Run([resources, command]()
+	{
+		BindShader(*resources, GetProgram(*resources, command->Features, command->Overdraw));
+		resources->BoundShader->SetUniformMat4("u_View", 1, (float*)glm::value_ptr(command->View), false);
+		resources->BoundShader->SetUniformMat4("u_Proj", 1, (float*)glm::value_ptr(command->Proj), false);
+
+		if (command->Overdraw)
+		{
+			glEnable(GL_BLEND);
+			glBlendFunc(GL_ONE, GL_ONE);
+		}
+
+		command->Map->Draw(*command->Frame);
+
+		if (command->Overdraw)
+			glDisable(GL_BLEND);
+	});
+
+	uint32_t chunkDraws = 0;
+	for (uint32_t quads : frame->VisibleQuadCounts)
+	{
+		if (quads > 0)
+			chunkDraws++;
+	}
+
+	m_Stats.DrawCalls += chunkDraws;
+	m_Stats.PermutationDraws[features] += chunkDraws;
+	m_Stats.QuadCount += frame->VisibleQuads;
+	m_Stats.TilemapUploads = (uint32_t)frame->Uploads.size();
+	m_Stats.TilemapVisibleChunks = (uint32_t)frame->Visible.size();
+	m_Stats.TilemapOverBudget = frame->OverBudget;
+}
+
+void Renderer2D::DrawGpuQuads(GpuQuadCuller* culler)
+{
+	if (m_Config.Backend == RendererBackend::Software || culler->GetQuadCount() == 0)
+		return;
+
+	if (m_QuadCount > 0 || m_TextureCount > 1)
+		Flush();
+
+	GpuQuadsCommand* command = m_Frame->Arena.Allocate<GpuQuadsCommand>(1);
+	command->Culler = culler;
+	command->QuadCount = culler->GetQuadCount();
+	command->View = m_View;
+	command->Proj = m_Proj;
+
+	std::shared_ptr<Renderer2DResources> resources = m_Resources;
+	RenderThread::Run([resources, command]()
+	{
+		command->Culler->Draw(command->View, command->Proj, command->QuadCount);
+
+		// the culler binds its own programs
+		resources->BoundShader = nullptr;
+	});
+
+	m_Stats.DrawCalls++;
+}
+
+void Renderer2D::SubmitSceneGraphBatch(const SceneGraph* scene, const uint32_t* nodes, const float* textureSlots)
+{
+	m_BatchVertices = m_Frame->Arena.Allocate<Vertex>(m_QuadCount * 4);
+
+	uint32_t threadCount = m_Config.ThreadCount;
+	uint32_t quadCount = m_QuadCount;
+	uint32_t nodesPerThread = quadCount / threadCount;
+	Vertex* vertexData = m_BatchVertices;
+
+	WorkerPool::Get().Run(threadCount, [=](uint32_t thread)
+	{
+		uint32_t first = nodesPerThread * thread;
+		uint32_t count = thread == threadCount - 1 ? quadCount - first : nodesPerThread;
+		CalcSceneGraphVertices(scene, nodes + first, textureSlots + first, vertexData + first * 4, count);
+	});
+
+	SubmitBatch();
+}
+
+// nodes go in index order, textures are resolved here and the vertices come from the world matrices the graph already has
+void Renderer2D::DrawSceneGraph(const SceneGraph* scene)
+{
+	if (m_QuadCount > 0)
+		Flush();
+
+	// one batch worth, reused by every batch since the vertices are built before the next one starts filling them
+	uint32_t* nodes = m_Frame->Arena.Allocate<uint32_t>(m_Config.MaxQuads);
+	float* textureSlots = m_Frame->Arena.Allocate<float>(m_Config.MaxQuads);
+
+	uint32_t count = scene->GetNodeCount();
+	for (uint32_t node = 0; node < count; node++)
+	{
+		Texture* texture = scene->GetTexture(node);
+		if (!texture)
+			continue;
+
+		if (FindTexture(texture) == -1 && m_TextureCount == m_Config.TextureSlots)
+			SubmitSceneGraphBatch(scene, nodes, textureSlots);
+
+		uint32_t features = ShaderFeature_None;
+		if (texture != m_TextureSlots[0])
+			features = m_AlphaTest ? (ShaderFeature_Textured | ShaderFeature_AlphaTest) : ShaderFeature_Textured;
+		if (!IsWhite(scene->GetColor(node)))
+			features |= ShaderFeature_Tinted;
+
+		nodes[m_QuadCount] = node;
+		textureSlots[m_QuadCount] = (float)GetTextureSlot(texture);
+		m_BatchFeatures |= features;
+
+		m_QuadCount++;
+		m_Stats.QuadCount++;
+
+		if (m_QuadCount == m_Config.MaxQuads)
+			SubmitSceneGraphBatch(scene, nodes, textureSlots);
+	}
+
+	if (m_QuadCount > 0)
+		SubmitSceneGraphBatch(scene, nodes, textureSlots);
+}
+
+void Renderer2D::LayoutString(Font* font, const char* text, Vec3 position, float size, Vec3 color, uint32_t pixelSize, bool sdf)
+{
+	float scale = size / pixelSize;
+	float penX = 0.0f;
+	float penY = 0.0f;
+	uint32_t previous = 0;
+
+	Transform transform;
+	transform.Rotation = { 0.0f, 0.0f, 0.0f };
+
+	while (*text)
+	{
+		uint32_t codepoint = Font::DecodeUTF8(text);
+
+		if (codepoint == '\n')
+		{
+			penX = 0.0f;
+			penY -= font->GetLineHeight(pixelSize);
+			previous = 0;
+			continue;
+		}
+
+		if (previous)
+			penX += font->GetKerning(previous, codepoint, pixelSize);
+
+		const Glyph& glyph = sdf ? font->GetSdfGlyph(codepoint) : font->GetGlyph(codepoint, pixelSize);
+		if (glyph.Visible)
+		{
+			// glyph offsets go down from the baseline, world Y goes up
+			transform.Location =
+			{
+				position.X + (penX + glyph.OffsetX + glyph.Width * 0.5f) * scale,
+				position.Y + (penY - glyph.OffsetY - glyph.Height * 0.5f) * scale,
+				position.Z
+			};
+			transform.Scale = { glyph.Width * scale, glyph.Height * scale, 1.0f };
+
+			if (sdf)
+				DrawQuadTexturedRect(transform, font->GetSdfAtlas(), { glyph.U0, glyph.V0, glyph.U1, glyph.V1 }, color, ShaderFeature_Textured | ShaderFeature_SDF);
+			else
+				DrawQuadTexturedRect(transform, font->GetAtlas(), { glyph.U0, glyph.V0, glyph.U1, glyph.V1 }, color, ShaderFeature_Textured | ShaderFeature_AlphaTest);
+			m_Stats.GlyphCount++;
+		}
+
+		penX += glyph.Advance;
+		previous = codepoint;
+	}
+}
+
+void Renderer2D::DrawString(Font* font, const char* text, Vec3 position, float size, Vec3 color, uint32_t pixelSize)
+{
+	LayoutString(font, text, position, size, color, pixelSize, false);
+}
+
+void Renderer2D::DrawStringSdf(Font* font, const char* text, Vec3 position, float size, Vec3 color)
+{
+	// the shadow offset is in atlas texels
+	m_SdfAtlasSize = font->GetSdfAtlas()->GetWidth();
+
+	LayoutString(font, text, position, size, color, Font::SdfPixelSize, true);
+}
+
+////////////////////////////////////////////////
+/////////////// DEPTH SORT /////////////////////
+////////////////////////////////////////////////
+
+// Counting sort on quantized view depth, so it's linear and splits over the threads like the vertex building.
+// Keys are a group and a bucket in it: opaque quads near to far first, then everything that blends far to near.
+// Shapes and SDF text blend without writing depth, so they share one group, otherwise a far shape would be drawn over
+// a near label. They still flush separately where they interleave, that's the price of getting the order right.
+// Quads in the same bucket keep submission order, so coplanar quads still resolve the way they always did.
+static const uint32_t DepthBuckets = 1024; // per group
+static const uint32_t DepthGroups = 2;
+
+static inline uint32_t GetDepthGroup(uint32_t features)
+{
+	return features & (ShaderFeature_Shape | ShaderFeature_SDF) ? 1 : 0;
+}
+
+// depthRow is the view matrix row that gives view space Z, range gets the min and max of this chunk
+static void CalcQuadDepths(const SubmittedQuad* quads, glm::vec4 depthRow, float* depths, uint32_t count, float* range)
+{
+	float minDepth = FLT_MAX;
+	float maxDepth = -FLT_MAX;
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		const Vec3& location = quads[i].Quad.Transform.Location;
+		float depth = depthRow.x * location.X + depthRow.y * location.Y + depthRow.z * location.Z + depthRow.w;
+
+		depths[i] = depth;
+		minDepth = depth < minDepth ? depth : minDepth;
+		maxDepth = depth > maxDepth ? depth : maxDepth;
+	}
+
+	range[0] = minDepth;
+	range[1] = maxDepth;
+}
+
+static void CalcDepthKeys(const SubmittedQuad* quads, const float* depths, uint32_t count, float minDepth, float bucketScale, uint32_t* keys, uint32_t* histogram)
+{
+	memset(histogram, 0, sizeof(uint32_t) * DepthBuckets * DepthGroups);
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		uint32_t bucket = (uint32_t)((depths[i] - minDepth) * bucketScale);
+		bucket = bucket < DepthBuckets ? bucket : DepthBuckets - 1;
+
+		uint32_t group = GetDepthGroup(quads[i].Features);
+		if (group == 1)
+			bucket = DepthBuckets - 1 - bucket;
+
+		uint32_t key = group * DepthBuckets + bucket;
+		keys[i] = key;
+		histogram[key]++;
+	}
+}
+
+// offsets starts as where this chunk's first quad of every key goes
+static void ScatterDepthOrder(const uint32_t* keys, uint32_t first, uint32_t count, uint32_t* offsets, uint32_t* order)
+{
+	for (uint32_t i = 0; i < count; i++)
+	{
+		order[offsets[keys[i]]++] = first + i;
+	}
+}
+
+void Renderer2D::FlushDepthSorted()
+{
+	uint32_t count = (uint32_t)m_DepthQuads.size();
+	if (count == 0)
+		return;
+
+	std::chrono::steady_clock::time_point sortStart = std::chrono::steady_clock::now();
+
+	uint32_t threadCount = m_Config.ThreadCount;
+	uint32_t quadsPerThread = count / threadCount;
+	uint32_t keyCount = DepthBuckets * DepthGroups;
+
+	FrameArena& arena = m_Frame->Arena;
+	float* depths = arena.Allocate<float>(count);
+	uint32_t* keys = arena.Allocate<uint32_t>(count);
+	uint32_t* order = arena.Allocate<uint32_t>(count);
+	float* ranges = arena.Allocate<float>(threadCount * 2);
+	uint32_t* histograms = arena.Allocate<uint32_t>(threadCount * keyCount);
+
+	const SubmittedQuad* quads = m_DepthQuads.data();
+	glm::vec4 depthRow = { m_View[0][2], m_View[1][2], m_View[2][2], m_View[3][2] };
+
+	// the last thread takes the remainder, same split for all three passes
+	auto chunkCount = [&](uint32_t thread) { return thread == threadCount - 1 ? count - quadsPerThread * thread : quadsPerThread; };
+	WorkerPool& workers = WorkerPool::Get();
+
+	workers.Run(threadCount, [&](uint32_t thread)
+	{
+		uint32_t first = quadsPerThread * thread;
+		CalcQuadDepths(quads + first, depthRow, depths + first, chunkCount(thread), ranges + thread * 2);
+	});
+
+	float minDepth = FLT_MAX;
+	float maxDepth = -FLT_MAX;
+	for (uint32_t i = 0; i < threadCount; i++)
+	{
+		if (chunkCount(i) == 0)
+			continue;
+		minDepth = ranges[i * 2] < minDepth ? ranges[i * 2] : minDepth;
+		maxDepth = ranges[i * 2 + 1] > maxDepth ? ranges[i * 2 + 1] : maxDepth;
+	}
+
+	// everything at one depth lands in bucket 0 and stays in submission order
+	float bucketScale = maxDepth > minDepth ? DepthBuckets / (maxDepth - minDepth) : 0.0f;
+
+	workers.Run(threadCount, [&](uint32_t thread)
+	{
+		uint32_t first = quadsPerThread * thread;
+		CalcDepthKeys(quads + first, depths + first, chunkCount(thread), minDepth, bucketScale, keys + first, histograms + thread * keyCount);
+	});
+
+	// every key's range in the output, split between the threads in thread order so it stays stable
+	uint32_t offset = 0;
+	for (uint32_t key = 0; key < keyCount; key++)
+	{
+		for (uint32_t i = 0; i < threadCount; i++)
+		{
+			uint32_t keyQuads = histograms[i * keyCount + key];
+			histograms[i * keyCount + key] = offset;
+			offset += keyQuads;
+		}
+	}
+
+	workers.Run(threadCount, [&](uint32_t thread)
+	{
+		uint32_t first = quadsPerThread * thread;
+		ScatterDepthOrder(keys + first, first, chunkCount(thread), histograms + thread * keyCount, order);
+	});
+
+	std::chrono::duration<float, std::milli> sortTime = std::chrono::steady_clock::now() - sortStart;
+	m_Stats.DepthSortedQuads = count;
+	m_Stats.DepthSortMs = sortTime.count();
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		MergeSubmittedQuad(quads[order[i]]);
+	}
+
+	if (m_QuadCount > 0)
+		Flush();
+
+	m_DepthQuads.clear();
+}
+
+////////////////////////////////////////////////
+/////////////// SUBMISSION MERGE ///////////////
+////////////////////////////////////////////////
+
+SubmissionContext* Renderer2D::GetSubmissionContext(uint32_t index)
+{
+	return &m_SubmissionContexts[index];
+}
+
+void Renderer2D::BuildSubmissionOrder()
+{
+	m_SubmissionOrder.clear();
+
+	for (uint32_t context = 0; context < (uint32_t)m_SubmissionContexts.size(); context++)
+	{
+		const std::vector<SubmittedQuad>& quads = m_SubmissionContexts[context].m_Quads;
+		for (uint32_t i = 0; i < (uint32_t)quads.size(); i++)
+		{
+			// user space pointers fit in the low 56 bits on x64
+			uint64_t exclusive = quads[i].Features & (ShaderFeature_SDF | ShaderFeature_Shape);
+			uint64_t texture = (uint64_t)(uintptr_t)quads[i].BoundTexture & 0x00ffffffffffffffull;
+			m_SubmissionOrder.push_back({ (exclusive << 56) | texture, context, i });
+		}
+	}
+
+	// quads with the same key keep the order they were submitted in, the context and index break the tie
+	// so it doesn't need stable_sort and the temporary buffer it allocates every time
+	std::sort(m_SubmissionOrder.begin(), m_SubmissionOrder.end(), [](const SubmissionKey& a, const SubmissionKey& b)
+	{
+		if (a.Key != b.Key)
+			return a.Key < b.Key;
+		if (a.Context != b.Context)
+			return a.Context < b.Context;
+		return a.Index < b.Index;
+	});
+}
+
+void Renderer2D::ClearSubmissionContexts()
+{
+	for (SubmissionContext& context : m_SubmissionContexts)
+	{
+		context.m_Quads.clear();
+	}
+}
+
+void Renderer2D::MergeSubmittedQuad(const SubmittedQuad& submitted)
+{
+	FlushOnExclusiveFeatures(submitted.Features);
+
+	TexturedQuad quad = submitted.Quad;
+	quad.TextureIndex = (float)GetTextureSlot(submitted.BoundTexture);
+
+	PushQuad(quad, submitted.Features);
+}
+
+// called by EndScene once every submitting thread is done, contexts go in index order unless sorting is on
+void Renderer2D::MergeSubmissionContexts()
+{
+	std::chrono::steady_clock::time_point mergeStart = std::chrono::steady_clock::now();
+
+	uint32_t submitted = 0;
+
+	if (m_DepthSort)
+	{
+		// goes through the depth sort with everything else, that order replaces the texture sort
+		for (const SubmissionContext& context : m_SubmissionContexts)
+		{
+			m_DepthQuads.insert(m_DepthQuads.end(), context.m_Quads.begin(), context.m_Quads.end());
+			submitted += (uint32_t)context.m_Quads.size();
+		}
+	}
+	else if (m_SortSubmissions)
+	{
+		BuildSubmissionOrder();
+
+		for (const SubmissionKey& key : m_SubmissionOrder)
+		{
+			MergeSubmittedQuad(m_SubmissionContexts[key.Context].m_Quads[key.Index]);
+		}
+		submitted = (uint32_t)m_SubmissionOrder.size();
+	}
+	else
+	{
+		for (const SubmissionContext& context : m_SubmissionContexts)
+		{
+			for (const SubmittedQuad& quad : context.m_Quads)
+			{
+				MergeSubmittedQuad(quad);
+			}
+			submitted += (uint32_t)context.m_Quads.size();
+		}
+	}
+
+	ClearSubmissionContexts();
+
+	std::chrono::duration<float, std::milli> mergeTime = std::chrono::steady_clock::now() - mergeStart;
+	m_Stats.SubmittedQuads = submitted;
+	m_Stats.SubmissionMergeMs = mergeTime.count();
+}
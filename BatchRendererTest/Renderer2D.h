@@ -0,0 +1,396 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+
+#include "glm/glm.hpp"
+
+#include "Math.h"
+#include "Vertex.h"
+#include "ShaderPermutation.h"
+#include "FrameArena.h"
+
+class Texture;
+class Shader;
+class ShaderLibrary;
+class GpuQuery;
+class VertexBuffer;
+class IndexBuffer;
+class VertexArray;
+class VertexLayout;
+class SoftwareRasterizer;
+class ParticleSystem;
+class Tilemap;
+class SceneGraph;
+class RenderTarget;
+class RenderLayer;
+class GpuQuadCuller;
+struct TilemapFrame;
+class Font;
+class Renderer2D;
+
+enum class RendererBackend
+{
+	OpenGL,
+	Software
+};
+
+struct Transform
+{
+	Vec3 Location;
+	Vec3 Rotation;
+	Vec3 Scale;
+};
+
+struct Camera
+{
+	Transform Transform;
+	float FOV;
+	float AspectRatio;
+	bool Orthographic = false;
+	float OrthographicHeight = 10.0f; // world units from the bottom to the top of the screen, FOV is ignored
+};
+
+struct TexturedQuad
+{
+	Transform Transform;
+	Vec3 ColorTint;
+	float TextureIndex;
+	Vec4 TextureRect; // U0, V0, U1, V1 with V0 at the top of the quad
+	Vec4 Shape; // see ShapeKind, all 0 for regular quads
+};
+
+struct SdfTextStyle
+{
+	Vec3 OutlineColor;
+	float OutlineWidth; // in SDF texels, 0 = off
+	Vec3 ShadowColor;
+	float ShadowOffset; // in SDF texels, 0 = off
+};
+
+inline Vec4 GetTilingRect(float tilingFactor)
+{
+	return { 0.0f, 0.0f, tilingFactor, tilingFactor };
+}
+
+glm::mat4 GetViewMatrix(const Camera& camera);
+glm::mat4 GetProjectionMatrix(const Camera& camera);
+
+// one quad to 4 vertices, TextureIndex has to be a slot already
+void CalcVertices(const TexturedQuad* batchData, Vertex* vertexData, uint32_t count);
+
+struct Renderer2DConfig
+{
+	uint32_t MaxQuads = 10000; // per batch
+	uint32_t TextureSlots = MAX_TEXTURE_SLOTS; // per batch, the shaders are compiled for MAX_TEXTURE_SLOTS so it can only go lower
+	uint32_t ThreadCount = 0; // for building vertices, 0 = one per hardware thread
+	uint32_t SubmissionContexts = 32;
+	uint64_t FrameArenaSize = 16 * 1024 * 1024; // per frame in flight to start with, grows to whatever the scene needs
+	RendererBackend Backend = RendererBackend::OpenGL; // the software one only samples CPU only textures (UsesCpuTextures)
+
+	// software backend only, size of the color buffer (see Resize)
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+};
+
+// reset by BeginScene
+struct Renderer2DStats
+{
+	uint32_t DrawCalls;
+	uint32_t QuadCount;
+	uint32_t TextureCount; // texture binds, the white texture counts once
+	uint32_t GlyphCount;
+	uint32_t SubmittedQuads; // merged from the submission contexts
+	float SubmissionMergeMs;
+	uint32_t TilemapVisibleChunks;
+	uint32_t TilemapUploads;
+	uint32_t TilemapOverBudget; // visible chunks left out, MaxResidentChunks is full
+	uint32_t PermutationDraws[SHADER_PERMUTATION_COUNT];
+	uint32_t DepthSortedQuads;
+	float DepthSortMs; // bucketing only, merging them into batches isn't part of it
+
+	// transient memory of this scene, the high water mark and capacity are the biggest of all frames in flight
+	uint64_t FrameArenaUsed;
+	uint64_t FrameArenaHighWater;
+	uint64_t FrameArenaCapacity;
+	uint32_t FrameArenaCount;
+	uint32_t FrameArenaOverflows; // blocks added this scene because it didn't fit, 0 once the arenas have grown
+	bool FrameArenaLargePages;
+};
+
+// affine transforms skip the Transform / mat4 path, the texture slot is resolved when the sprites are flushed
+struct SubmittedSprite
+{
+	Affine2D Transform;
+	Vec4 TextureRect;
+	Vec3 Color;
+	float TextureIndex;
+	Texture* BoundTexture;
+	uint32_t Features;
+};
+
+// one sprite (unit quad through the affine transform) to 4 vertices on the Z = 0 plane, order indexes into sprites
+void CalcSpriteVertices(const SubmittedSprite* sprites, const uint64_t* order, Vertex* vertexData, uint32_t count);
+
+// the textured nodes of a scene graph to 4 vertices each, straight from the cached world matrices
+void CalcSceneGraphVertices(const SceneGraph* scene, const uint32_t* nodes, const float* textureSlots, Vertex* vertexData, uint32_t count);
+
+struct SubmittedQuad
+{
+	TexturedQuad Quad;
+	Texture* BoundTexture;
+	uint32_t Features;
+};
+
+// Per thread submission, meant for systems that run on their own threads and want to emit sprites directly.
+// A context is only ever used by one thread between BeginScene and EndScene, so appending doesn't lock anything.
+// Texture slots and batch features are resolved when EndScene merges every context into the regular batch.
+// Cache line aligned, so two threads never write the same line when their vectors grow.
+class alignas(64) SubmissionContext
+{
+public:
+	void DrawQuad(const Transform& transform, Vec3 color);
+	void DrawQuadTextured(const Transform& transform, Texture* texture, float tilingFactor = 1.0f, Vec3 colorTint = { 1.0f, 1.0f, 1.0f });
+	void DrawQuadTexturedRect(const Transform& transform, Texture* texture, Vec4 textureRect, Vec3 colorTint, uint32_t features);
+
+	inline uint32_t GetQuadCount() const { return (uint32_t)m_Quads.size(); }
+
+private:
+	friend class Renderer2D;
+
+	const Renderer2D* m_Renderer;
+	std::vector<SubmittedQuad> m_Quads; // keeps its capacity between frames
+};
+
+// Transient memory for one scene: batch vertices and the commands that read them, tilemap culling output.
+// The render thread reads from it a frame or two later, so there's one per frame in flight and a frame
+// is only reused once the render thread has executed its EndScene.
+struct Renderer2DFrame
+{
+	Renderer2DFrame(uint64_t arenaSize);
+	~Renderer2DFrame();
+
+	FrameArena Arena;
+	std::vector<std::unique_ptr<TilemapFrame>> Tilemaps; // has vectors inside, recycled instead of coming from the arena
+	uint32_t TilemapCount;
+	std::atomic<bool> InFlight;
+};
+
+// Everything the GL side touches. Recorded commands keep a reference, so a renderer can be deleted
+// while its last frame is still queued on the render thread and the GL objects go away over there.
+struct Renderer2DResources
+{
+	~Renderer2DResources();
+
+	std::unique_ptr<Texture> WhiteTexture;
+	std::unique_ptr<VertexBuffer> Vertices;
+	std::unique_ptr<IndexBuffer> Indices;
+	std::unique_ptr<VertexArray> QuadArray;
+	std::unique_ptr<ShaderLibrary> Shaders;
+	std::unique_ptr<GpuQuery> SceneTimer;
+	std::unique_ptr<GpuQuery> FragmentInvocations; // only with ARB_pipeline_statistics_query (core in 4.6)
+	std::string Permutations[SHADER_PERMUTATION_COUNT];
+	std::string OverdrawPermutations[SHADER_PERMUTATION_COUNT]; // empty until the first overdraw scene
+	Shader* BoundShader = nullptr;
+
+	std::vector<std::unique_ptr<Renderer2DFrame>> Frames;
+
+	// software backend, where the color buffer is copied before the blit to the window
+	uint32_t PresentTexture = 0;
+	uint32_t PresentFramebuffer = 0;
+	uint32_t PresentWidth = 0;
+	uint32_t PresentHeight = 0;
+
+	int32_t WindowViewport[4] = {}; // saved when a render target gets set, restored when it's unset
+};
+
+struct QuadBatchCommand;
+
+// The quad batcher. Every instance has its own batch, buffers, shaders and stats, so the world and a UI layer
+// (or a few offscreen software renderers in the golden tests) can batch separately and run side by side.
+// Has to be created and deleted on the thread that records GL commands (the game thread when there's a render thread).
+// A software renderer doesn't touch GL at all (its textures are CPU only) except in Present, so it runs without a context
+// and can draw from any thread.
+class Renderer2D
+{
+public:
+	Renderer2D(const Renderer2DConfig& config);
+	~Renderer2D();
+
+	Renderer2D(const Renderer2D&) = delete;
+	Renderer2D& operator=(const Renderer2D&) = delete;
+
+	void BeginScene(const Camera& camera);
+	void EndScene();
+
+	// The scene goes into the layer's target, and only while the layer is dirty: when this returns false the caller
+	// skips its draw calls. EndScene composites the layer over the window either way, on top of what's there already.
+	// With the software backend there are no targets, the scene is drawn straight to the color buffer every time.
+	bool BeginScene(const Camera& camera, RenderLayer* layer);
+
+	// color and depth, ClearDepth is for drawing a layer on top of another renderer's scene
+	// alpha only shows up in a render target, the window is presented opaque
+	void Clear(Vec3 color, float alpha = 1.0f);
+	void ClearDepth();
+
+	// OpenGL only: everything recorded after it (Clear included) goes into the target, nullptr goes back to the window
+	void SetRenderTarget(RenderTarget* target);
+
+	// software backend: copies the color buffer to the window, nothing to do on OpenGL
+	void Present();
+	void Resize(uint32_t width, uint32_t height);
+
+	void DrawQuad(const Transform& transform, Vec3 color);
+	void DrawQuadTextured(const Transform& transform, Texture* texture, float tilingFactor = 1.0f, Vec3 colorTint = { 1.0f, 1.0f, 1.0f });
+	// features are the shader features the quad needs on top of what the tint already implies
+	void DrawQuadTexturedRect(const Transform& transform, Texture* texture, Vec4 textureRect, Vec3 colorTint, uint32_t features);
+
+	// scale is the size of the shape bounds, the fragment shader cuts the shape out of it
+	void DrawShape(const Transform& transform, Vec4 shape, Vec3 color);
+	// thickness > 0 draws a ring of that width instead of a disc
+	void DrawCircle(Vec3 center, float radius, Vec3 color, float thickness = 0.0f);
+	void DrawRoundedRect(const Transform& transform, float cornerRadius, Vec3 color);
+	void DrawLine(Vec3 from, Vec3 to, float thickness, Vec3 color);
+
+	// 2D sprites on the Z = 0 plane. They're drawn at EndScene on top of everything else with the depth test off,
+	// lower layers first and the same layer in submission order, meant for an orthographic camera.
+	void DrawSprite2D(const Affine2D& transform, Texture* texture, int32_t layer = 0, Vec3 color = { 1.0f, 1.0f, 1.0f }, Vec4 textureRect = { 0.0f, 0.0f, 1.0f, 1.0f });
+
+	void DrawParticles(ParticleSystem* particles);
+	void DrawTilemap(Tilemap* tilemap);
+	// every node with a texture, call SceneGraph::Update first
+	void DrawSceneGraph(const SceneGraph* scene);
+	// culled and drawn on the gpu with the scene's camera in one indirect draw, nothing with the software backend
+	void DrawGpuQuads(GpuQuadCuller* culler);
+
+	// Text on the XY plane, position is where the baseline of the first line starts.
+	// size is the world height of a pixelSize em, glyphs go in the same batch as every other quad.
+	void DrawString(Font* font, const char* text, Vec3 position, float size, Vec3 color = { 1.0f, 1.0f, 1.0f }, uint32_t pixelSize = 32);
+	// Same as DrawString but from the distance field atlas, one set of glyphs for every size.
+	// Outline and shadow come from the SDF style and are done in the shader.
+	void DrawStringSdf(Font* font, const char* text, Vec3 position, float size, Vec3 color = { 1.0f, 1.0f, 1.0f });
+
+	// index is whatever the caller uses to tell its threads apart, two threads must never share one in the same frame
+	SubmissionContext* GetSubmissionContext(uint32_t index);
+
+	inline void SetAlphaTest(bool enabled) { m_AlphaTest = enabled; }
+	inline bool GetAlphaTest() const { return m_AlphaTest; }
+	inline void SetSdfStyle(const SdfTextStyle& style) { m_SdfStyle = style; }
+	inline const SdfTextStyle& GetSdfStyle() const { return m_SdfStyle; }
+	// sorts the merged submission contexts by exclusive features and texture instead of keeping them in context order
+	inline void SetSortSubmissions(bool sort) { m_SortSubmissions = sort; }
+	inline bool GetSortSubmissions() const { return m_SortSubmissions; }
+	// Holds DrawQuad/DrawShape/text and the submission contexts back until EndScene and draws the opaque ones
+	// coarsely front to back, so the depth test rejects hidden fragments before they're shaded, then the ones that
+	// blend (shapes and SDF text) back to front. Particles, tilemaps and scene graphs still draw as they're submitted.
+	inline void SetDepthSort(bool sort) { m_DepthSort = sort; }
+	inline bool GetDepthSort() const { return m_DepthSort; }
+	// Every fragment that reaches the framebuffer adds 1/255 to red instead of its color (additive blending), so after
+	// a scene cleared to 0 the red channel counts how often each pixel was drawn. Set it between scenes, the
+	// overdraw permutations are only compiled the first time. OpenGL only, see OverdrawView for the heatmap.
+	void SetOverdrawMode(bool enabled);
+	inline bool GetOverdrawMode() const { return m_Overdraw; }
+
+	inline const Renderer2DConfig& GetConfig() const { return m_Config; }
+	inline RendererBackend GetBackend() const { return m_Config.Backend; }
+	// textures and fonts for this renderer have to be created with cpuOnly set to this, GL ones draw white in software
+	inline bool UsesCpuTextures() const { return m_Config.Backend == RendererBackend::Software; }
+	inline const Renderer2DStats& GetStats() const { return m_Stats; }
+	inline Texture* GetWhiteTexture() const { return m_Resources->WhiteTexture.get(); }
+	inline ShaderLibrary* GetShaderLibrary() const { return m_Resources->Shaders.get(); }
+	inline const std::string& GetPermutationName(uint32_t features) const { return m_Resources->Permutations[features]; }
+	inline SoftwareRasterizer* GetRasterizer() const { return m_Rasterizer.get(); }
+	uint64_t GetSceneTimeNs() const;
+	// fragment shader invocations of a recent scene, false when the driver can't count them
+	bool GetFragmentInvocations(uint64_t& invocations) const;
+
+	// the layout of Vertex, for things that keep their own vertex buffers (Tilemap)
+	static VertexLayout GetVertexLayout();
+
+	// only the cpu side of the sorted merge, public so the scaling benchmark can time it without drawing
+	void BuildSubmissionOrder();
+	void ClearSubmissionContexts();
+
+private:
+	void AcquireFrame();
+	TilemapFrame* AcquireTilemapFrame();
+
+	void BuildVertexBuffer();
+	void SubmitBatch();
+	void Flush();
+	void FlushOnExclusiveFeatures(uint32_t features);
+	void PushQuad(const TexturedQuad& quad, uint32_t features);
+
+	int32_t FindTexture(Texture* texture) const;
+	uint32_t GetTextureSlot(Texture* texture);
+	void ClearTextures();
+
+	void SubmitSceneGraphBatch(const SceneGraph* scene, const uint32_t* nodes, const float* textureSlots);
+
+	void FlushSprites();
+	void CompositeLayer();
+	void BuildSpriteVertices(uint32_t first, uint32_t count);
+
+	void SubmitQuad(TexturedQuad quad, Texture* texture, uint32_t features);
+	void MergeSubmittedQuad(const SubmittedQuad& submitted);
+	void FlushDepthSorted();
+	void MergeSubmissionContexts();
+
+	void WriteParticleVertices(ParticleSystem* particles, uint32_t first, uint32_t count);
+	void LayoutString(Font* font, const char* text, Vec3 position, float size, Vec3 color, uint32_t pixelSize, bool sdf);
+
+	static void BindShader(Renderer2DResources& resources, Shader* program);
+	static Shader* GetProgram(Renderer2DResources& resources, uint32_t features, bool overdraw);
+	static void ExecuteBatch(Renderer2DResources& resources, const QuadBatchCommand& batch, const Vertex* vertices);
+
+private:
+	Renderer2DConfig m_Config;
+	std::shared_ptr<Renderer2DResources> m_Resources;
+	std::unique_ptr<SoftwareRasterizer> m_Rasterizer;
+
+	Renderer2DFrame* m_Frame; // between BeginScene and EndScene
+	RenderTarget* m_RenderTarget;
+	RenderLayer* m_Layer; // between BeginScene and EndScene when the scene has one
+
+	std::vector<TexturedQuad> m_QuadBatch;
+	Vertex* m_BatchVertices; // in the frame arena, sized for the batch being built
+	uint32_t m_QuadCount;
+	uint32_t m_BatchFeatures;
+
+	std::vector<Texture*> m_TextureSlots;
+	uint32_t m_TextureCount; // slot 0 is always the white texture
+
+	// sorted merge order, the key groups quads by the exclusive features first and then by texture
+	struct SubmissionKey
+	{
+		uint64_t Key;
+		uint32_t Context;
+		uint32_t Index;
+	};
+
+	std::vector<SubmittedSprite> m_Sprites;
+	std::vector<uint64_t> m_SpriteOrder; // layer in the high half, index into m_Sprites in the low half
+	bool m_SpriteBatch; // while FlushSprites or CompositeLayer submit, batches go out without the depth test
+	bool m_CompositeBatch; // while CompositeLayer submits, the layer texture is premultiplied and blended as such
+
+	std::vector<SubmissionContext> m_SubmissionContexts;
+	std::vector<SubmissionKey> m_SubmissionOrder; // keeps its capacity, sorted in place
+	bool m_SortSubmissions;
+
+	std::vector<SubmittedQuad> m_DepthQuads; // held back for the depth sort, keeps its capacity
+	bool m_DepthSort;
+
+	glm::mat4 m_View;
+	glm::mat4 m_Proj;
+
+	bool m_AlphaTest;
+	bool m_Overdraw;
+	SdfTextStyle m_SdfStyle;
+	uint32_t m_SdfAtlasSize;
+
+	Renderer2DStats m_Stats;
+};
@@ -0,0 +1,87 @@
+#include "SceneGraph.h"
+
+#include <string.h>
+
+SceneGraph::SceneGraph()
+	: m_FirstDirty(0), m_Updated(0)
+{
+}
+
+uint32_t SceneGraph::AddNode(uint32_t parent, const Transform& local, Texture* texture, Vec3 color)
+{
+	uint32_t node = (uint32_t)m_Parent.size();
+
+	// a parent that doesn't exist yet would break the ordering Update relies on
+	if (parent != NoParent && parent >= node)
+		parent = NoParent;
+
+	m_Parent.push_back(parent);
+	m_Local.push_back(local);
+	m_World.push_back(glm::mat4(1.0f));
+	m_Dirty.push_back(1);
+	m_Texture.push_back(texture);
+	m_Color.push_back(color);
+
+	// m_FirstDirty is never past the end, so the new node is already in the next Update's range
+	return node;
+}
+
+void SceneGraph::Clear()
+{
+	m_Parent.clear();
+	m_Local.clear();
+	m_World.clear();
+	m_Dirty.clear();
+	m_Texture.clear();
+	m_Color.clear();
+
+	m_FirstDirty = 0;
+	m_Updated = 0;
+}
+
+void SceneGraph::SetLocal(uint32_t node, const Transform& local)
+{
+	m_Local[node] = local;
+	m_Dirty[node] = 1;
+
+	if (node < m_FirstDirty)
+		m_FirstDirty = node;
+}
+
+void SceneGraph::MarkAllDirty()
+{
+	memset(m_Dirty.data(), 1, m_Dirty.size());
+	m_FirstDirty = 0;
+}
+
+uint32_t SceneGraph::Update()
+{
+	uint32_t count = GetNodeCount();
+	m_Updated = 0;
+
+	for (uint32_t i = m_FirstDirty; i < count; i++)
+	{
+		// a recomputed parent keeps its flag until the end of the pass, that's how the change reaches the subtree
+		uint32_t parent = m_Parent[i];
+		if (!m_Dirty[i] && (parent == NoParent || !m_Dirty[parent]))
+			continue;
+
+		m_Dirty[i] = 1;
+
+		const Transform& local = m_Local[i];
+		glm::mat4 matrix = GetRotation(local.Rotation);
+		matrix[0] *= local.Scale.X;
+		matrix[1] *= local.Scale.Y;
+		matrix[2] *= local.Scale.Z;
+		matrix[3] = glm::vec4(local.Location.X, local.Location.Y, local.Location.Z, 1.0f);
+
+		m_World[i] = parent == NoParent ? matrix : m_World[parent] * matrix;
+		m_Updated++;
+	}
+
+	if (m_FirstDirty < count)
+		memset(m_Dirty.data() + m_FirstDirty, 0, count - m_FirstDirty);
+	m_FirstDirty = count;
+
+	return m_Updated;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "Renderer2D.h"
+
+class Texture;
+
+// Parent/child transforms in flat arrays. AddNode only takes a parent that already exists, so a parent always sits
+// before its children and one pass in index order sees every parent's world matrix before a child needs it.
+// SetLocal only marks the node, Update recomputes the marked nodes and everything under them and keeps the rest cached.
+// Nodes with a texture are quads (the unit quad through the world matrix), the others only group their children.
+class SceneGraph
+{
+public:
+	static const uint32_t NoParent = 0xffffffff;
+
+	SceneGraph();
+
+	uint32_t AddNode(uint32_t parent, const Transform& local, Texture* texture = nullptr, Vec3 color = { 1.0f, 1.0f, 1.0f });
+	void Clear();
+
+	void SetLocal(uint32_t node, const Transform& local);
+	// for comparing against rebuilding every world matrix
+	void MarkAllDirty();
+
+	// returns how many world matrices were recomputed
+	uint32_t Update();
+
+	inline const Transform& GetLocal(uint32_t node) const { return m_Local[node]; }
+	inline const glm::mat4& GetWorld(uint32_t node) const { return m_World[node]; }
+	inline uint32_t GetParent(uint32_t node) const { return m_Parent[node]; }
+	inline Texture* GetTexture(uint32_t node) const { return m_Texture[node]; }
+	inline Vec3 GetColor(uint32_t node) const { return m_Color[node]; }
+
+	inline uint32_t GetNodeCount() const { return (uint32_t)m_Parent.size(); }
+	inline uint32_t GetUpdatedCount() const { return m_Updated; } // by the last Update
+
+private:
+	std::vector<uint32_t> m_Parent;
+	std::vector<Transform> m_Local;
+	std::vector<glm::mat4> m_World;
+	std::vector<uint8_t> m_Dirty;
+	std::vector<Texture*> m_Texture;
+	std::vector<Vec3> m_Color;
+
+	uint32_t m_FirstDirty; // nothing before it changed, the node count when everything is clean
+	uint32_t m_Updated;
+};
@@ -3,34 +3,80 @@
 #include "GL/glew.h"
 
 #include <fstream>
-#include <string>
+#include <iostream>
 
-Shader::Shader(const char* vertexShaderSrc, const char* fragmentShaderSrc)
+static std::string GetShaderLog(uint32_t shader)
 {
-    uint32_t vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    uint32_t fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    int32_t length = 0;
+    glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+
+    std::string log(length, '\0');
+    if (length > 0)
+        glGetShaderInfoLog(shader, length, nullptr, &log[0]);
+
+    return log;
+}
+
+static std::string GetProgramLog(uint32_t program)
+{
+    int32_t length = 0;
+    glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+
+    std::string log(length, '\0');
+    if (length > 0)
+        glGetProgramInfoLog(program, length, nullptr, &log[0]);
+
+    return log;
+}
+
+Shader::Shader(const char* vertexShaderSrc, const char* fragmentShaderSrc, bool async)
+    : m_ComputeShader(0), m_Finalized(false), m_Valid(false)
+{
+    m_VertexShader = glCreateShader(GL_VERTEX_SHADER);
+    m_FragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
     m_RendererID = glCreateProgram();
 
-    glShaderSource(vertexShader, 1, &vertexShaderSrc, nullptr);
-    glCompileShader(vertexShader);
+    glShaderSource(m_VertexShader, 1, &vertexShaderSrc, nullptr);
+    glCompileShader(m_VertexShader);
+
+    glShaderSource(m_FragmentShader, 1, &fragmentShaderSrc, nullptr);
+    glCompileShader(m_FragmentShader);
 
-    glShaderSource(fragmentShader, 1, &fragmentShaderSrc, nullptr);
-    glCompileShader(fragmentShader);
+    // linking right away lets the driver work on the whole program in the background,
+    // we only query the status (which blocks) once IsReady says it's done
 
-    glAttachShader(m_RendererID, vertexShader);
-    glAttachShader(m_RendererID, fragmentShader);
+    glAttachShader(m_RendererID, m_VertexShader);
+    glAttachShader(m_RendererID, m_FragmentShader);
     glLinkProgram(m_RendererID);
-    glValidateProgram(m_RendererID);
 
-    glDetachShader(m_RendererID, vertexShader);
-    glDeleteShader(vertexShader);
+    if (!async)
+        Finalize();
+}
+
+Shader::Shader(const char* computeShaderSrc)
+    : m_VertexShader(0), m_FragmentShader(0), m_Finalized(false), m_Valid(false)
+{
+    m_ComputeShader = glCreateShader(GL_COMPUTE_SHADER);
+    m_RendererID = glCreateProgram();
+
+    glShaderSource(m_ComputeShader, 1, &computeShaderSrc, nullptr);
+    glCompileShader(m_ComputeShader);
 
-    glDetachShader(m_RendererID, fragmentShader);
-    glDeleteShader(fragmentShader);
+    glAttachShader(m_RendererID, m_ComputeShader);
+    glLinkProgram(m_RendererID);
+
+    Finalize();
 }
 
 Shader::~Shader()
 {
+    if (!m_Finalized)
+    {
+        glDeleteShader(m_VertexShader);
+        glDeleteShader(m_FragmentShader);
+        glDeleteShader(m_ComputeShader);
+    }
+
     glDeleteProgram(m_RendererID);
 }
 
@@ -44,30 +90,106 @@ void Shader::UnBind()
     glUseProgram(0);
 }
 
-Shader* Shader::FromFile(const char* vertexPath, const char* fragmentPath)
+bool Shader::IsReady()
 {
-    std::ifstream vertexFile(vertexPath);
-    std::ifstream fragmentFile(fragmentPath);
+    if (m_Finalized)
+        return true;
 
-    std::string vertexSrc;
-    if (vertexFile.is_open())
+    // without KHR_parallel_shader_compile there is no way to ask without blocking, so we just finalize
+    if (GLEW_KHR_parallel_shader_compile)
     {
-        std::string line;
-        while (getline(vertexFile, line))
-            vertexSrc += line + '\n';
-        vertexFile.close();
+        int32_t done = GL_FALSE;
+        glGetProgramiv(m_RendererID, GL_COMPLETION_STATUS_KHR, &done);
+        if (done == GL_FALSE)
+            return false;
     }
 
-    std::string fragmentSrc;
-    if (fragmentFile.is_open())
+    Finalize();
+    return true;
+}
+
+void Shader::Finalize()
+{
+    int32_t status = GL_FALSE;
+
+    if (m_ComputeShader)
+    {
+        glGetShaderiv(m_ComputeShader, GL_COMPILE_STATUS, &status);
+        if (status == GL_FALSE)
+            m_ErrorLog += "compute shader: " + GetShaderLog(m_ComputeShader);
+    }
+    else
+    {
+        glGetShaderiv(m_VertexShader, GL_COMPILE_STATUS, &status);
+        if (status == GL_FALSE)
+            m_ErrorLog += "vertex shader: " + GetShaderLog(m_VertexShader);
+
+        glGetShaderiv(m_FragmentShader, GL_COMPILE_STATUS, &status);
+        if (status == GL_FALSE)
+            m_ErrorLog += "fragment shader: " + GetShaderLog(m_FragmentShader);
+    }
+
+    glGetProgramiv(m_RendererID, GL_LINK_STATUS, &status);
+    if (status == GL_FALSE)
+    {
+        m_ErrorLog += "link: " + GetProgramLog(m_RendererID);
+    }
+    else
+    {
+        glValidateProgram(m_RendererID);
+    }
+
+    m_Valid = m_ErrorLog.empty();
+
+    if (!m_Valid)
+        std::cout << "Shader error (" << m_RendererID << ")\n" << m_ErrorLog << std::endl;
+
+    if (m_ComputeShader)
+    {
+        glDetachShader(m_RendererID, m_ComputeShader);
+        glDeleteShader(m_ComputeShader);
+    }
+    else
+    {
+        glDetachShader(m_RendererID, m_VertexShader);
+        glDeleteShader(m_VertexShader);
+
+        glDetachShader(m_RendererID, m_FragmentShader);
+        glDeleteShader(m_FragmentShader);
+    }
+
+    m_Finalized = true;
+}
+
+Shader* Shader::FromFile(const char* vertexPath, const char* fragmentPath, bool async)
+{
+    std::string vertexSrc = ReadSource(vertexPath);
+    std::string fragmentSrc = ReadSource(fragmentPath);
+
+    return new Shader(vertexSrc.c_str(), fragmentSrc.c_str(), async);
+}
+
+Shader* Shader::FromComputeFile(const char* computePath)
+{
+    std::string computeSrc = ReadSource(computePath);
+
+    return new Shader(computeSrc.c_str());
+}
+
+std::string Shader::ReadSource(const char* path)
+{
+    std::ifstream file(path);
+
+    std::string src;
+    if (file.is_open())
     {
         std::string line;
-        while (getline(fragmentFile, line))
-            fragmentSrc += line + '\n';
-        fragmentFile.close();
+        while (getline(file, line))
+            src += line + '\n';
+        file.close();
     }
 
-    return new Shader(vertexSrc.c_str(), fragmentSrc.c_str());
+    return src;
 }
 
 void Shader::SetUniform1iv(const char* name, size_t count, int32_t* value)
@@ -79,6 +201,42 @@ void Shader::SetUniform1iv(const char* name, size_t count, int32_t* value)
     }
 }
 
+void Shader::SetUniform1ui(const char* name, uint32_t value)
+{
+    int32_t location = glGetUniformLocation(m_RendererID, name);
+    if (location > -1)
+    {
+        glUniform1ui(location, value);
+    }
+}
+
+void Shader::SetUniform2f(const char* name, float x, float y)
+{
+    int32_t location = glGetUniformLocation(m_RendererID, name);
+    if (location > -1)
+    {
+        glUniform2f(location, x, y);
+    }
+}
+
+void Shader::SetUniform4f(const char* name, float x, float y, float z, float w)
+{
+    int32_t location = glGetUniformLocation(m_RendererID, name);
+    if (location > -1)
+    {
+        glUniform4f(location, x, y, z, w);
+    }
+}
+
+void Shader::SetUniform4fv(const char* name, size_t count, const float* value)
+{
+    int32_t location = glGetUniformLocation(m_RendererID, name);
+    if (location > -1)
+    {
+        glUniform4fv(location, count, value);
+    }
+}
+
 void Shader::SetUniformMat4(const char* name, size_t count, float* value, bool transpose)
 {
     int32_t location = glGetUniformLocation(m_RendererID, name);
@@ -2,23 +2,48 @@
 
 #include <stdint.h>
 
+#include <string>
+
 class Shader
 {
 public:
-	Shader(const char* vertexShaderSrc, const char* fragmentShaderSrc);
+	// when async is true compile/link are only issued, call IsReady() until it returns true before binding
+	Shader(const char* vertexShaderSrc, const char* fragmentShaderSrc, bool async = false);
+	// compute only program, dispatched with glDispatchCompute while it's bound
+	explicit Shader(const char* computeShaderSrc);
 	~Shader();
 
 	void Bind();
 	void UnBind();
 
+	bool IsReady();
+
+	inline bool IsValid() const { return m_Valid; }
+	inline const std::string& GetErrorLog() const { return m_ErrorLog; }
+
 	inline uint32_t GetID() const { return m_RendererID; }
 
-	static Shader* FromFile(const char* vertexPath, const char* fragmentPath);
+	static Shader* FromFile(const char* vertexPath, const char* fragmentPath, bool async = false);
+	static Shader* FromComputeFile(const char* computePath);
+	static std::string ReadSource(const char* path);
 
 	void SetUniform1iv(const char* name, size_t count, int32_t* value);
+	void SetUniform1ui(const char* name, uint32_t value);
+	void SetUniform2f(const char* name, float x, float y);
+	void SetUniform4f(const char* name, float x, float y, float z, float w);
+	void SetUniform4fv(const char* name, size_t count, const float* value);
 	void SetUniformMat4(const char* name, size_t count, float* value, bool transpose);
 
+private:
+	void Finalize();
+
 private:
 	uint32_t m_RendererID;
+	uint32_t m_VertexShader;
+	uint32_t m_FragmentShader;
+	uint32_t m_ComputeShader; // 0 unless it's a compute program, then the other two are
+	bool m_Finalized;
+	bool m_Valid;
+	std::string m_ErrorLog;
 };
 
@@ -0,0 +1,151 @@
+#include "ShaderLibrary.h"
+#include "ShaderPermutation.h"
+
+#include "GL/glew.h"
+
+#include <iostream>
+
+// flat color program, same attribute layout as the quad shader so it can draw the batch as is
+
+static const char* FallbackVertexSrc =
+	"#version 330 core\n"
+	"layout(location = 0) in vec3 position;\n"
+	"layout(location = 1) in vec3 color;\n"
+	"out vec3 v_Color;\n"
+	"uniform mat4 u_View;\n"
+	"uniform mat4 u_Proj;\n"
+	"void main()\n"
+	"{\n"
+	"    gl_Position = u_Proj * u_View * vec4(position, 1.0f);\n"
+	"    v_Color = color;\n"
+	"}\n";
+
+static const char* FallbackFragmentSrc =
+	"#version 330 core\n"
+	"layout(location = 0) out vec4 color;\n"
+	"in vec3 v_Color;\n"
+	"void main()\n"
+	"{\n"
+	"    color = vec4(v_Color, 1.0f);\n"
+	"}\n";
+
+ShaderLibrary::ShaderLibrary()
+	: m_Parallel(GLEW_KHR_parallel_shader_compile)
+{
+	if (m_Parallel)
+	{
+		// 0xffffffff = let the driver pick how many threads to use
+		glMaxShaderCompilerThreadsKHR(0xffffffff);
+	}
+
+	m_Fallback = new Shader(FallbackVertexSrc, FallbackFragmentSrc);
+}
+
+ShaderLibrary::~ShaderLibrary()
+{
+	for (ShaderProgramEntry& entry : m_Entries)
+	{
+		delete entry.Program;
+	}
+
+	delete m_Fallback;
+}
+
+void ShaderLibrary::Add(const std::string& name, const char* vertexPath, const char* fragmentPath, const std::string& defines)
+{
+	AddFromSource(name, Shader::ReadSource(vertexPath), Shader::ReadSource(fragmentPath), defines);
+}
+
+void ShaderLibrary::AddFromSource(const std::string& name, const std::string& vertexSrc, const std::string& fragmentSrc, const std::string& defines)
+{
+	std::string finalVertexSrc = InjectDefines(vertexSrc, defines);
+	std::string finalFragmentSrc = InjectDefines(fragmentSrc, defines);
+
+	ShaderProgramEntry entry;
+	entry.Name = name;
+	entry.StartTime = std::chrono::steady_clock::now();
+	entry.Program = new Shader(finalVertexSrc.c_str(), finalFragmentSrc.c_str(), true);
+	entry.CompileTimeMs = 0.0f;
+	entry.Ready = false;
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	int32_t index = Find(name);
+	if (index != -1)
+	{
+		delete m_Entries[index].Program;
+		m_Entries[index] = entry;
+	}
+	else
+	{
+		m_Entries.push_back(entry);
+	}
+}
+
+void ShaderLibrary::Poll()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	for (ShaderProgramEntry& entry : m_Entries)
+	{
+		if (entry.Ready || !entry.Program->IsReady())
+			continue;
+
+		// measured up to the frame we noticed it, so it's an upper bound when polled once per frame
+		std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - entry.StartTime;
+		entry.CompileTimeMs = elapsed.count();
+		entry.Ready = true;
+
+		if (!entry.Program->IsValid())
+		{
+			std::cout << "Shader program '" << entry.Name << "' failed, using fallback" << std::endl;
+		}
+	}
+}
+
+Shader* ShaderLibrary::Get(const std::string& name)
+{
+	int32_t index = Find(name);
+	if (index == -1)
+		return m_Fallback;
+
+	const ShaderProgramEntry& entry = m_Entries[index];
+	if (!entry.Ready || !entry.Program->IsValid())
+		return m_Fallback;
+
+	return entry.Program;
+}
+
+std::vector<ShaderProgramEntry> ShaderLibrary::GetEntries() const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_Entries;
+}
+
+bool ShaderLibrary::IsReady(const std::string& name) const
+{
+	int32_t index = Find(name);
+	return index != -1 && m_Entries[index].Ready;
+}
+
+bool ShaderLibrary::AllReady() const
+{
+	for (const ShaderProgramEntry& entry : m_Entries)
+	{
+		if (!entry.Ready)
+			return false;
+	}
+	return true;
+}
+
+int32_t ShaderLibrary::Find(const std::string& name) const
+{
+	for (uint32_t i = 0; i < m_Entries.size(); i++)
+	{
+		if (m_Entries[i].Name == name)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
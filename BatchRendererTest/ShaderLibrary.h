@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <mutex>
+
+#include "Shader.h"
+
+struct ShaderProgramEntry
+{
+	std::string Name;
+	Shader* Program;
+	std::chrono::steady_clock::time_point StartTime;
+	float CompileTimeMs;
+	bool Ready;
+};
+
+// Kicks off every program at once and hands out a fallback until the real one is done.
+// Uses KHR_parallel_shader_compile when the driver has it so none of this blocks startup.
+class ShaderLibrary
+{
+public:
+	ShaderLibrary();
+	~ShaderLibrary();
+
+	// defines are injected after the #version line of both stages, see ShaderPermutation.h
+	void Add(const std::string& name, const char* vertexPath, const char* fragmentPath, const std::string& defines = "");
+	void AddFromSource(const std::string& name, const std::string& vertexSrc, const std::string& fragmentSrc, const std::string& defines = "");
+
+	// checks pending programs without stalling, call it once per frame
+	void Poll();
+
+	// returns the fallback while the program is still compiling or if it failed
+	Shader* Get(const std::string& name);
+
+	bool IsReady(const std::string& name) const;
+	bool AllReady() const;
+
+	inline Shader* GetFallback() const { return m_Fallback; }
+	// a copy, Poll may be running on the render thread at the same time
+	std::vector<ShaderProgramEntry> GetEntries() const;
+	inline bool IsParallel() const { return m_Parallel; }
+
+private:
+	int32_t Find(const std::string& name) const;
+
+private:
+	std::vector<ShaderProgramEntry> m_Entries;
+	mutable std::mutex m_Mutex; // only guards what GetEntries reads, everything else stays on the GL thread
+	Shader* m_Fallback;
+	bool m_Parallel;
+};
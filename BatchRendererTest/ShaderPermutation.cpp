@@ -0,0 +1,50 @@
+#include "ShaderPermutation.h"
+
+std::string GetPermutationName(const char* baseName, uint32_t features)
+{
+	std::string name = baseName;
+
+	if (features == ShaderFeature_None)
+		name += "_flat";
+	if (features & ShaderFeature_Textured)
+		name += "_tex";
+	if (features & ShaderFeature_Tinted)
+		name += "_tint";
+	if (features & ShaderFeature_AlphaTest)
+		name += "_atest";
+	if (features & ShaderFeature_SDF)
+		name += "_sdf";
+	if (features & ShaderFeature_Shape)
+		name += "_shape";
+
+	return name;
+}
+
+std::string GetPermutationDefines(uint32_t features)
+{
+	std::string defines;
+
+	defines += "#define MAX_TEXTURE_SLOTS " + std::to_string(MAX_TEXTURE_SLOTS) + "\n";
+	defines += std::string("#define TEXTURED ") + ((features & ShaderFeature_Textured) ? "1" : "0") + "\n";
+	defines += std::string("#define TINTED ") + ((features & ShaderFeature_Tinted) ? "1" : "0") + "\n";
+	defines += std::string("#define ALPHA_TEST ") + ((features & ShaderFeature_AlphaTest) ? "1" : "0") + "\n";
+	defines += std::string("#define SDF ") + ((features & ShaderFeature_SDF) ? "1" : "0") + "\n";
+	defines += std::string("#define SHAPE ") + ((features & ShaderFeature_Shape) ? "1" : "0") + "\n";
+
+	return defines;
+}
+
+std::string InjectDefines(const std::string& src, const std::string& defines)
+{
+	size_t versionPos = src.find("#version");
+	if (versionPos == std::string::npos)
+		return defines + src;
+
+	size_t lineEnd = src.find('\n', versionPos);
+	if (lineEnd == std::string::npos)
+		return src + "\n" + defines;
+
+	std::string result = src;
+	result.insert(lineEnd + 1, defines);
+	return result;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+
+// single source of truth for everything the C++ side and the GLSL side have to agree on,
+// the values are injected into the shader sources as #defines (see GetPermutationDefines)
+
+constexpr uint32_t MAX_TEXTURE_SLOTS = 16;
+
+enum ShaderFeature : uint32_t
+{
+	ShaderFeature_None = 0,
+	ShaderFeature_Textured = 1 << 0,
+	ShaderFeature_Tinted = 1 << 1,
+	ShaderFeature_AlphaTest = 1 << 2,
+	ShaderFeature_SDF = 1 << 3, // texture alpha is a distance field (SDF text), always paired with Textured
+	ShaderFeature_Shape = 1 << 4, // analytic circles / rounded rects / lines packed into Vertex::TextureIndex (PackShape), blended
+
+	ShaderFeature_All = ShaderFeature_Textured | ShaderFeature_Tinted | ShaderFeature_AlphaTest | ShaderFeature_SDF | ShaderFeature_Shape
+};
+
+constexpr uint32_t SHADER_PERMUTATION_COUNT = ShaderFeature_All + 1;
+
+std::string GetPermutationName(const char* baseName, uint32_t features);
+std::string GetPermutationDefines(uint32_t features);
+
+// inserts the defines right after the #version line (which has to stay the first one)
+std::string InjectDefines(const std::string& src, const std::string& defines);
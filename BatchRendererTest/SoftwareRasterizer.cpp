@@ -0,0 +1,561 @@
+#include "SoftwareRasterizer.h"
+
+#include "Texture.h"
+#include "WorkerPool.h"
+
+#include <emmintrin.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <math.h>
+
+struct ClipVertex
+{
+	glm::vec4 Position;
+	float R, G, B;
+	float U, V;
+};
+
+static inline uint32_t PackColor(float r, float g, float b, float a)
+{
+	uint32_t ir = (uint32_t)(glm::clamp(r, 0.0f, 1.0f) * 255.0f + 0.5f);
+	uint32_t ig = (uint32_t)(glm::clamp(g, 0.0f, 1.0f) * 255.0f + 0.5f);
+	uint32_t ib = (uint32_t)(glm::clamp(b, 0.0f, 1.0f) * 255.0f + 0.5f);
+	uint32_t ia = (uint32_t)(glm::clamp(a, 0.0f, 1.0f) * 255.0f + 0.5f);
+	return ir | (ig << 8) | (ib << 16) | (ia << 24);
+}
+
+static inline float SmoothStep(float edge0, float edge1, float x)
+{
+	float t = glm::clamp((x - edge0) / (edge1 - edge0), 0.0f, 1.0f);
+	return t * t * (3.0f - 2.0f * t);
+}
+
+// src is straight color for Coverage and premultiplied for Premultiplied, alpha is one + one minus src alpha for both
+static inline uint32_t BlendColor(RasterBlend blend, float r, float g, float b, float a, uint32_t dst)
+{
+	if (blend == RasterBlend::None)
+		return PackColor(r, g, b, a);
+
+	float srcScale = blend == RasterBlend::Coverage ? a : 1.0f;
+	float dstScale = (1.0f - glm::clamp(a, 0.0f, 1.0f)) * (1.0f / 255.0f);
+
+	return PackColor(r * srcScale + (dst & 0xff) * dstScale,
+		g * srcScale + ((dst >> 8) & 0xff) * dstScale,
+		b * srcScale + ((dst >> 16) & 0xff) * dstScale,
+		a + (dst >> 24) * dstScale);
+}
+
+// edge functions are positive inside, a center right on the edge only counts for left edges (inside to the right)
+// and flat top ones (inside below, rows go up). The neighbour has the same edge negated, so exactly one of them gets it.
+static inline __m128 EdgeInside(__m128 w, float a, float b)
+{
+	bool topLeft = a > 0.0f || (a == 0.0f && b < 0.0f);
+	return topLeft ? _mm_cmpge_ps(w, _mm_setzero_ps()) : _mm_cmpgt_ps(w, _mm_setzero_ps());
+}
+
+static inline int32_t Wrap(int32_t value, int32_t size)
+{
+	value %= size;
+	return value < 0 ? value + size : value;
+}
+
+// GL_LINEAR + GL_REPEAT, same as the sampler state Texture sets up
+static inline void SampleBilinear(const Texture* texture, float u, float v, float* out)
+{
+	const uint32_t* pixels = texture ? texture->GetPixels() : nullptr;
+	if (!pixels)
+	{
+		out[0] = out[1] = out[2] = out[3] = 1.0f;
+		return;
+	}
+
+	int32_t width = texture->GetWidth();
+	int32_t height = texture->GetHeight();
+
+	float x = u * width - 0.5f;
+	float y = v * height - 0.5f;
+	float fx = floorf(x);
+	float fy = floorf(y);
+	float tx = x - fx;
+	float ty = y - fy;
+
+	int32_t x0 = Wrap((int32_t)fx, width);
+	int32_t y0 = Wrap((int32_t)fy, height);
+	int32_t x1 = Wrap(x0 + 1, width);
+	int32_t y1 = Wrap(y0 + 1, height);
+
+	uint32_t t00 = pixels[y0 * width + x0];
+	uint32_t t10 = pixels[y0 * width + x1];
+	uint32_t t01 = pixels[y1 * width + x0];
+	uint32_t t11 = pixels[y1 * width + x1];
+
+	for (uint32_t c = 0; c < 4; c++)
+	{
+		uint32_t shift = c * 8;
+		float top = ((t00 >> shift) & 0xff) * (1.0f - tx) + ((t10 >> shift) & 0xff) * tx;
+		float bottom = ((t01 >> shift) & 0xff) * (1.0f - tx) + ((t11 >> shift) & 0xff) * tx;
+		out[c] = (top * (1.0f - ty) + bottom * ty) * (1.0f / 255.0f);
+	}
+}
+
+// keeps the part of the polygon in front of the GL near plane (z >= -w)
+static uint32_t ClipNear(const ClipVertex* in, uint32_t count, ClipVertex* out)
+{
+	uint32_t outCount = 0;
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		const ClipVertex& a = in[i];
+		const ClipVertex& b = in[(i + 1) % count];
+
+		float da = a.Position.z + a.Position.w;
+		float db = b.Position.z + b.Position.w;
+
+		if (da >= 0.0f)
+			out[outCount++] = a;
+
+		if ((da >= 0.0f) != (db >= 0.0f))
+		{
+			float t = da / (da - db);
+
+			ClipVertex& v = out[outCount++];
+			v.Position = a.Position + (b.Position - a.Position) * t;
+			v.R = a.R + (b.R - a.R) * t;
+			v.G = a.G + (b.G - a.G) * t;
+			v.B = a.B + (b.B - a.B) * t;
+			v.U = a.U + (b.U - a.U) * t;
+			v.V = a.V + (b.V - a.V) * t;
+		}
+	}
+
+	return outCount;
+}
+
+SoftwareRasterizer::SoftwareRasterizer(uint32_t width, uint32_t height, uint32_t threadCount)
+	: m_Width(0), m_Height(0), m_Stride(0), m_TilesX(0), m_TilesY(0), m_ThreadCount(0),
+	m_ViewProj(1.0f), m_TextureCount(0), m_AlphaTest(false), m_Shapes(false), m_Sdf(false), m_Blend(RasterBlend::None), m_DepthTest(true), m_ShadedPixels(0), m_RasterTimeMs(0.0f)
+{
+	for (uint32_t i = 0; i < MAX_TEXTURE_SLOTS; i++)
+		m_Textures[i] = nullptr;
+
+	Resize(width, height);
+	SetThreadCount(threadCount);
+}
+
+SoftwareRasterizer::~SoftwareRasterizer()
+{
+}
+
+void SoftwareRasterizer::Resize(uint32_t width, uint32_t height)
+{
+	if (width == m_Width && height == m_Height)
+		return;
+
+	m_Width = width;
+	m_Height = height;
+	m_Stride = (width + 3) & ~3u;
+	m_TilesX = (width + TileSize - 1) / TileSize;
+	m_TilesY = (height + TileSize - 1) / TileSize;
+
+	m_Color.assign(m_Stride * m_Height, 0);
+	m_Depth.assign(m_Stride * m_Height, 1.0f);
+
+	for (std::vector<std::vector<uint32_t>>& bins : m_Bins)
+	{
+		bins.clear();
+		bins.resize(m_TilesX * m_TilesY);
+	}
+}
+
+void SoftwareRasterizer::SetThreadCount(uint32_t threadCount)
+{
+	if (threadCount < 1)
+		threadCount = 1;
+
+	m_ThreadCount = threadCount;
+	m_Triangles.resize(threadCount);
+	m_Bins.resize(threadCount);
+
+	for (std::vector<std::vector<uint32_t>>& bins : m_Bins)
+		bins.resize(m_TilesX * m_TilesY);
+}
+
+void SoftwareRasterizer::Clear(Vec3 color)
+{
+	std::fill(m_Color.begin(), m_Color.end(), PackColor(color.X, color.Y, color.Z, 1.0f));
+	std::fill(m_Depth.begin(), m_Depth.end(), 1.0f);
+
+	m_ShadedPixels = 0;
+	m_RasterTimeMs = 0.0f;
+}
+
+void SoftwareRasterizer::ClearDepth()
+{
+	std::fill(m_Depth.begin(), m_Depth.end(), 1.0f);
+}
+
+void SoftwareRasterizer::SetTextures(Texture** slots, uint32_t count)
+{
+	m_TextureCount = std::min(count, MAX_TEXTURE_SLOTS);
+
+	for (uint32_t i = 0; i < MAX_TEXTURE_SLOTS; i++)
+		m_Textures[i] = i < m_TextureCount ? slots[i] : nullptr;
+}
+
+void SoftwareRasterizer::DrawQuads(const Vertex* vertices, uint32_t quadCount, const glm::mat4& viewProj)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	m_ViewProj = viewProj;
+
+	uint32_t quadsPerThread = quadCount / m_ThreadCount;
+
+	WorkerPool::Get().Run(m_ThreadCount, [this, vertices, quadCount, quadsPerThread](uint32_t thread)
+	{
+		uint32_t first = quadsPerThread * thread;
+		uint32_t count = thread == m_ThreadCount - 1 ? quadCount - first : quadsPerThread;
+		SetupTriangles(thread, vertices + first * 4, count);
+	});
+
+	RasterizeTiles();
+
+	std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	m_RasterTimeMs += elapsed.count();
+}
+
+void SoftwareRasterizer::SetupTriangles(uint32_t thread, const Vertex* vertices, uint32_t count)
+{
+	static const uint32_t QuadTriangles[2][3] = { { 0, 1, 2 }, { 2, 3, 0 } }; // same as the index buffer
+
+	m_Triangles[thread].clear();
+
+	for (uint32_t q = 0; q < count; q++, vertices += 4)
+	{
+		ClipVertex quad[4];
+		for (uint32_t j = 0; j < 4; j++)
+		{
+			const Vertex& vertex = vertices[j];
+			quad[j].Position = m_ViewProj * glm::vec4(vertex.Position.X, vertex.Position.Y, vertex.Position.Z, 1.0f);
+			quad[j].R = vertex.Color.X;
+			quad[j].G = vertex.Color.Y;
+			quad[j].B = vertex.Color.Z;
+			quad[j].U = vertex.TextureCoordinates.X;
+			quad[j].V = vertex.TextureCoordinates.Y;
+		}
+
+		int32_t textureIndex = (int32_t)(vertices[0].TextureIndex + 0.5f);
+		Vec4 shape = m_Shapes ? UnpackShape(vertices[0].TextureIndex, vertices[0].TextureCoordinates) : Vec4{ 0.0f, 0.0f, 0.0f, 0.0f };
+
+		for (uint32_t t = 0; t < 2; t++)
+		{
+			ClipVertex triangle[3] = { quad[QuadTriangles[t][0]], quad[QuadTriangles[t][1]], quad[QuadTriangles[t][2]] };
+			ClipVertex polygon[4];
+			uint32_t polygonCount = ClipNear(triangle, 3, polygon);
+
+			RasterVertex projected[4];
+			for (uint32_t j = 0; j < polygonCount; j++)
+			{
+				const ClipVertex& v = polygon[j];
+				float invW = 1.0f / v.Position.w;
+
+				projected[j].X = (v.Position.x * invW * 0.5f + 0.5f) * m_Width;
+				projected[j].Y = (v.Position.y * invW * 0.5f + 0.5f) * m_Height;
+				projected[j].Z = v.Position.z * invW * 0.5f + 0.5f;
+				projected[j].InvW = invW;
+				projected[j].R = v.R * invW;
+				projected[j].G = v.G * invW;
+				projected[j].B = v.B * invW;
+				projected[j].U = v.U * invW;
+				projected[j].V = v.V * invW;
+			}
+
+			// clipping leaves a convex polygon of up to 4 vertices, draw it as a fan
+			for (uint32_t j = 1; j + 1 < polygonCount; j++)
+			{
+				RasterTriangle result;
+				result.V[0] = projected[0];
+				result.V[1] = projected[j];
+				result.V[2] = projected[j + 1];
+				result.TextureIndex = textureIndex;
+				result.Shape = shape;
+
+				BinTriangle(thread, result);
+			}
+		}
+	}
+}
+
+void SoftwareRasterizer::BinTriangle(uint32_t thread, const RasterTriangle& triangle)
+{
+	RasterTriangle result = triangle;
+	RasterVertex* v = result.V;
+
+	float area = (v[1].X - v[0].X) * (v[2].Y - v[0].Y) - (v[1].Y - v[0].Y) * (v[2].X - v[0].X);
+	if (fabsf(area) < 1e-8f)
+		return;
+
+	// no culling in the GL path either, we just flip the winding so inside is always positive
+	if (area < 0.0f)
+		std::swap(v[1], v[2]);
+
+	float minX = std::min(v[0].X, std::min(v[1].X, v[2].X));
+	float minY = std::min(v[0].Y, std::min(v[1].Y, v[2].Y));
+	float maxX = std::max(v[0].X, std::max(v[1].X, v[2].X));
+	float maxY = std::max(v[0].Y, std::max(v[1].Y, v[2].Y));
+
+	result.MinX = std::max((int32_t)floorf(minX), 0);
+	result.MinY = std::max((int32_t)floorf(minY), 0);
+	result.MaxX = std::min((int32_t)ceilf(maxX), (int32_t)m_Width);
+	result.MaxY = std::min((int32_t)ceilf(maxY), (int32_t)m_Height);
+
+	if (result.MinX >= result.MaxX || result.MinY >= result.MaxY)
+		return;
+
+	std::vector<RasterTriangle>& triangles = m_Triangles[thread];
+	uint32_t index = triangles.size();
+	triangles.push_back(result);
+
+	std::vector<std::vector<uint32_t>>& bins = m_Bins[thread];
+
+	int32_t tileMinX = result.MinX / TileSize;
+	int32_t tileMinY = result.MinY / TileSize;
+	int32_t tileMaxX = (result.MaxX - 1) / TileSize;
+	int32_t tileMaxY = (result.MaxY - 1) / TileSize;
+
+	for (int32_t ty = tileMinY; ty <= tileMaxY; ty++)
+	{
+		for (int32_t tx = tileMinX; tx <= tileMaxX; tx++)
+		{
+			bins[ty * m_TilesX + tx].push_back(index);
+		}
+	}
+}
+
+void SoftwareRasterizer::RasterizeTiles()
+{
+	uint32_t tileCount = m_TilesX * m_TilesY;
+	std::atomic<uint32_t> nextTile(0);
+	std::atomic<uint64_t> shadedPixels(0);
+
+	// every tile is owned by exactly one thread, so color/depth writes never race
+	auto worker = [this, tileCount, &nextTile, &shadedPixels](uint32_t)
+	{
+		uint64_t shaded = 0;
+
+		for (uint32_t tile = nextTile++; tile < tileCount; tile = nextTile++)
+		{
+			int32_t tileMinX = (tile % m_TilesX) * TileSize;
+			int32_t tileMinY = (tile / m_TilesX) * TileSize;
+			int32_t tileMaxX = std::min(tileMinX + TileSize, (int32_t)m_Width);
+			int32_t tileMaxY = std::min(tileMinY + TileSize, (int32_t)m_Height);
+
+			// walk the bins in thread order so triangles keep their submission order
+			for (uint32_t t = 0; t < m_ThreadCount; t++)
+			{
+				std::vector<uint32_t>& bin = m_Bins[t][tile];
+				for (uint32_t index : bin)
+				{
+					RasterizeTriangle(m_Triangles[t][index], tileMinX, tileMinY, tileMaxX, tileMaxY, shaded);
+				}
+				bin.clear();
+			}
+		}
+
+		shadedPixels += shaded;
+	};
+
+	WorkerPool::Get().Run(m_ThreadCount, worker);
+
+	m_ShadedPixels += shadedPixels;
+}
+
+void SoftwareRasterizer::RasterizeTriangle(const RasterTriangle& triangle, int32_t tileMinX, int32_t tileMinY, int32_t tileMaxX, int32_t tileMaxY, uint64_t& shaded)
+{
+	int32_t minX = std::max(triangle.MinX, tileMinX);
+	int32_t minY = std::max(triangle.MinY, tileMinY);
+	int32_t maxX = std::min(triangle.MaxX, tileMaxX);
+	int32_t maxY = std::min(triangle.MaxY, tileMaxY);
+
+	if (minX >= maxX || minY >= maxY)
+		return;
+
+	const RasterVertex& v0 = triangle.V[0];
+	const RasterVertex& v1 = triangle.V[1];
+	const RasterVertex& v2 = triangle.V[2];
+
+	// edge(a, b, p) = A * p.x + B * p.y + C, positive inside since BinTriangle fixed the winding
+	float a0 = v1.Y - v2.Y, b0 = v2.X - v1.X, c0 = v1.X * v2.Y - v1.Y * v2.X;
+	float a1 = v2.Y - v0.Y, b1 = v0.X - v2.X, c1 = v2.X * v0.Y - v2.Y * v0.X;
+	float a2 = v0.Y - v1.Y, b2 = v1.X - v0.X, c2 = v0.X * v1.Y - v0.Y * v1.X;
+
+	float invArea = 1.0f / (a2 * v2.X + b2 * v2.Y + c2);
+
+	RasterSteps steps = { { a0 * invArea, a1 * invArea, a2 * invArea }, { b0 * invArea, b1 * invArea, b2 * invArea } };
+
+	const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128i laneIndices = _mm_setr_epi32(0, 1, 2, 3);
+	const __m128i rangeMin = _mm_set1_epi32(minX - 1);
+	const __m128i rangeMax = _mm_set1_epi32(maxX);
+	const __m128 ea0 = _mm_set1_ps(a0), ea1 = _mm_set1_ps(a1), ea2 = _mm_set1_ps(a2);
+	const __m128 z0 = _mm_set1_ps(v0.Z * invArea), z1 = _mm_set1_ps(v1.Z * invArea), z2 = _mm_set1_ps(v2.Z * invArea);
+
+	// rows are padded to 4 pixels so the aligned down start never reads outside the row
+	int32_t startX = minX & ~3;
+
+	for (int32_t y = minY; y < maxY; y++)
+	{
+		float py = y + 0.5f;
+		const __m128 row0 = _mm_set1_ps(b0 * py + c0);
+		const __m128 row1 = _mm_set1_ps(b1 * py + c1);
+		const __m128 row2 = _mm_set1_ps(b2 * py + c2);
+
+		float* depthRow = &m_Depth[y * m_Stride];
+		uint32_t* colorRow = &m_Color[y * m_Stride];
+
+		for (int32_t x = startX; x < maxX; x += 4)
+		{
+			__m128 px = _mm_add_ps(_mm_set1_ps((float)x), laneOffsets);
+
+			__m128 w0 = _mm_add_ps(_mm_mul_ps(ea0, px), row0);
+			__m128 w1 = _mm_add_ps(_mm_mul_ps(ea1, px), row1);
+			__m128 w2 = _mm_add_ps(_mm_mul_ps(ea2, px), row2);
+
+			__m128 inside = _mm_and_ps(EdgeInside(w0, a0, b0), _mm_and_ps(EdgeInside(w1, a1, b1), EdgeInside(w2, a2, b2)));
+
+			// lanes outside [minX, maxX) belong to the neighbour tile
+			__m128i lanes = _mm_add_epi32(_mm_set1_epi32(x), laneIndices);
+			__m128i inRange = _mm_and_si128(_mm_cmpgt_epi32(lanes, rangeMin), _mm_cmplt_epi32(lanes, rangeMax));
+			inside = _mm_and_ps(inside, _mm_castsi128_ps(inRange));
+
+			if (_mm_movemask_ps(inside) == 0)
+				continue;
+
+			__m128 z = _mm_add_ps(_mm_mul_ps(w0, z0), _mm_add_ps(_mm_mul_ps(w1, z1), _mm_mul_ps(w2, z2)));
+			__m128 depth = _mm_loadu_ps(depthRow + x);
+			__m128 pass = m_DepthTest ? _mm_and_ps(inside, _mm_cmplt_ps(z, depth)) : inside;
+
+			int32_t mask = _mm_movemask_ps(pass);
+			if (mask == 0)
+				continue;
+
+			float lw0[4], lw1[4], lw2[4];
+			_mm_storeu_ps(lw0, w0);
+			_mm_storeu_ps(lw1, w1);
+			_mm_storeu_ps(lw2, w2);
+
+			for (int32_t lane = 0; lane < 4; lane++)
+			{
+				if (mask & (1 << lane))
+				{
+					shaded++;
+
+					// alpha tested texels don't write color or depth, like discard in the shader
+					if (!Shade(triangle, steps, lw0[lane] * invArea, lw1[lane] * invArea, lw2[lane] * invArea, colorRow[x + lane]))
+						mask &= ~(1 << lane);
+				}
+			}
+
+			// blended edges would cut holes into whatever is drawn behind them later
+			if (!m_DepthTest || m_Blend != RasterBlend::None)
+				continue;
+
+			const __m128i laneBits = _mm_setr_epi32(1, 2, 4, 8);
+			__m128 written = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(mask), laneBits), laneBits));
+			_mm_storeu_ps(depthRow + x, _mm_or_ps(_mm_and_ps(written, z), _mm_andnot_ps(written, depth)));
+		}
+	}
+}
+
+// same as ShapeDistance in res/fragment.txt
+static float ShapeDistance(const Vec4& shape, float x, float y)
+{
+	if (shape.X < 1.5f)
+	{
+		float dist = sqrtf(x * x + y * y) - shape.Y;
+		float thickness = shape.Z;
+		return thickness > 0.0f ? fabsf(dist + thickness * 0.5f) - thickness * 0.5f : dist;
+	}
+
+	float qx = fabsf(x) - shape.Y + shape.W;
+	float qy = fabsf(y) - shape.Z + shape.W;
+	float outside = sqrtf(std::max(qx, 0.0f) * std::max(qx, 0.0f) + std::max(qy, 0.0f) * std::max(qy, 0.0f));
+	return outside + std::min(std::max(qx, qy), 0.0f) - shape.W;
+}
+
+// perspective correct texture coordinates at the given barycentrics
+static inline void InterpolateUV(const RasterTriangle& triangle, float b0, float b1, float b2, float& u, float& v)
+{
+	const RasterVertex& v0 = triangle.V[0];
+	const RasterVertex& v1 = triangle.V[1];
+	const RasterVertex& v2 = triangle.V[2];
+
+	float w = 1.0f / (b0 * v0.InvW + b1 * v1.InvW + b2 * v2.InvW);
+	u = (b0 * v0.U + b1 * v1.U + b2 * v2.U) * w;
+	v = (b0 * v0.V + b1 * v1.V + b2 * v2.V) * w;
+}
+
+bool SoftwareRasterizer::Shade(const RasterTriangle& triangle, const RasterSteps& steps, float b0, float b1, float b2, uint32_t& color) const
+{
+	const RasterVertex& v0 = triangle.V[0];
+	const RasterVertex& v1 = triangle.V[1];
+	const RasterVertex& v2 = triangle.V[2];
+
+	float w = 1.0f / (b0 * v0.InvW + b1 * v1.InvW + b2 * v2.InvW);
+
+	float r = (b0 * v0.R + b1 * v1.R + b2 * v2.R) * w;
+	float g = (b0 * v0.G + b1 * v1.G + b2 * v2.G) * w;
+	float b = (b0 * v0.B + b1 * v1.B + b2 * v2.B) * w;
+	float u = (b0 * v0.U + b1 * v1.U + b2 * v2.U) * w;
+	float v = (b0 * v0.V + b1 * v1.V + b2 * v2.V) * w;
+
+	// shapes and SDF need fwidth, so they also look one pixel to the right and one up
+	float ux = 0.0f, vx = 0.0f, uy = 0.0f, vy = 0.0f;
+	if (triangle.Shape.X > 0.5f || m_Sdf)
+	{
+		InterpolateUV(triangle, b0 + steps.DX[0], b1 + steps.DX[1], b2 + steps.DX[2], ux, vx);
+		InterpolateUV(triangle, b0 + steps.DY[0], b1 + steps.DY[1], b2 + steps.DY[2], uy, vy);
+	}
+
+	// same as the SHAPE permutation, the antialiased band sits just inside the edge
+	if (triangle.Shape.X > 0.5f)
+	{
+		float dist = ShapeDistance(triangle.Shape, u, v);
+		float aa = std::max(fabsf(ShapeDistance(triangle.Shape, ux, vx) - dist) + fabsf(ShapeDistance(triangle.Shape, uy, vy) - dist), 0.0001f);
+		float coverage = 1.0f - SmoothStep(-aa, 0.0f, dist);
+
+		if (coverage <= 0.0f)
+			return false;
+
+		color = BlendColor(m_Blend, r, g, b, coverage, color);
+		return true;
+	}
+
+	float texel[4];
+	const Texture* texture = triangle.TextureIndex >= 0 && triangle.TextureIndex < (int32_t)m_TextureCount ? m_Textures[triangle.TextureIndex] : nullptr;
+	SampleBilinear(texture, u, v, texel);
+
+	if (m_Sdf)
+	{
+		float texelX[4], texelY[4];
+		SampleBilinear(texture, ux, vx, texelX);
+		SampleBilinear(texture, uy, vy, texelY);
+
+		float dist = texel[3];
+		float smoothing = std::max((fabsf(texelX[3] - dist) + fabsf(texelY[3] - dist)) * 0.5f, 0.0001f);
+		float alpha = SmoothStep(0.5f - smoothing, 0.5f + smoothing, dist);
+
+		if (alpha <= 0.0f)
+			return false;
+
+		color = BlendColor(m_Blend, r, g, b, alpha, color);
+		return true;
+	}
+
+	if (m_AlphaTest && texel[3] < 0.5f)
+		return false;
+
+	color = BlendColor(m_Blend, texel[0] * r, texel[1] * g, texel[2] * b, texel[3], color);
+	return true;
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "Vertex.h"
+#include "ShaderPermutation.h"
+
+class Texture;
+
+struct RasterVertex
+{
+	float X, Y, Z, InvW;
+
+	// perspective correct attributes, already divided by w
+	float R, G, B;
+	float U, V;
+};
+
+struct RasterTriangle
+{
+	RasterVertex V[3];
+	int32_t TextureIndex;
+	Vec4 Shape; // UnpackShape of the quad when drawing shapes, U/V are then the position inside the shape
+	int32_t MinX, MinY, MaxX, MaxY;
+};
+
+// how much the barycentrics change one pixel to the right and one up, what fwidth works from in the shader
+struct RasterSteps
+{
+	float DX[3];
+	float DY[3];
+};
+
+// the blend funcs the GL path sets for a batch (Renderer2D ExecuteBatch)
+enum class RasterBlend
+{
+	None,         // opaque, writes depth
+	Coverage,     // shape and SDF edges: color over by its alpha, alpha adds up so a cleared target ends up premultiplied
+	Premultiplied // layer composites
+};
+
+// CPU backend for the quad batch, it takes the same Vertex stream the GL path uploads.
+// Triangles are binned into screen tiles and every tile is rasterized by one thread,
+// edge functions and depth test run 4 pixels at a time with SSE.
+// It doesn't touch GL at all, the color buffer is plain RGBA8 with the first row at the bottom (like GL).
+// Pixel centers on a shared edge go to one triangle only (top-left rule). SDF text has no outline or shadow here.
+class SoftwareRasterizer
+{
+public:
+	SoftwareRasterizer(uint32_t width, uint32_t height, uint32_t threadCount);
+	~SoftwareRasterizer();
+
+	void Resize(uint32_t width, uint32_t height);
+	void SetThreadCount(uint32_t threadCount);
+
+	// also resets the frame stats
+	void Clear(Vec3 color);
+	void ClearDepth();
+
+	void SetTextures(Texture** slots, uint32_t count);
+
+	// same as the ALPHA_TEST shader permutation, texels under 0.5 alpha are dropped
+	inline void SetAlphaTest(bool enabled) { m_AlphaTest = enabled; }
+	// same as the SHAPE permutation, TextureIndex is then the packed shape instead of a slot (PackShape)
+	inline void SetShapes(bool enabled) { m_Shapes = enabled; }
+	// same as the SDF permutation minus outline and shadow, texel alpha is the distance to the glyph edge
+	inline void SetSdf(bool enabled) { m_Sdf = enabled; }
+	// anything but None tests depth without writing it, like the blended batches on GL
+	inline void SetBlend(RasterBlend blend) { m_Blend = blend; }
+	// off draws in submission order and leaves the depth buffer alone, like glDisable(GL_DEPTH_TEST)
+	inline void SetDepthTest(bool enabled) { m_DepthTest = enabled; }
+	void DrawQuads(const Vertex* vertices, uint32_t quadCount, const glm::mat4& viewProj);
+
+	inline const uint32_t* GetColorBuffer() const { return m_Color.data(); }
+	inline uint32_t GetWidth() const { return m_Width; }
+	inline uint32_t GetHeight() const { return m_Height; }
+	inline uint32_t GetStride() const { return m_Stride; }
+	inline uint32_t GetThreadCount() const { return m_ThreadCount; }
+
+	inline uint64_t GetShadedPixels() const { return m_ShadedPixels; }
+	inline float GetRasterTimeMs() const { return m_RasterTimeMs; }
+	inline float GetMPixelsPerSecond() const { return m_RasterTimeMs > 0.0f ? m_ShadedPixels / (m_RasterTimeMs * 1000.0f) : 0.0f; }
+
+private:
+	void SetupTriangles(uint32_t thread, const Vertex* vertices, uint32_t count);
+	void BinTriangle(uint32_t thread, const RasterTriangle& triangle);
+	void RasterizeTiles();
+	void RasterizeTriangle(const RasterTriangle& triangle, int32_t tileMinX, int32_t tileMinY, int32_t tileMaxX, int32_t tileMaxY, uint64_t& shaded);
+	// color comes in as what's in the buffer and goes out blended, false when the pixel is discarded
+	bool Shade(const RasterTriangle& triangle, const RasterSteps& steps, float b0, float b1, float b2, uint32_t& color) const;
+
+private:
+	static const int32_t TileSize = 64;
+
+	uint32_t m_Width;
+	uint32_t m_Height;
+	uint32_t m_Stride; // row length in pixels, padded to 4 for the SSE loads
+	uint32_t m_TilesX;
+	uint32_t m_TilesY;
+
+	std::vector<uint32_t> m_Color;
+	std::vector<float> m_Depth;
+
+	uint32_t m_ThreadCount;
+
+	// per thread so setup and binning don't need any locking, tiles walk them in thread order
+	std::vector<std::vector<RasterTriangle>> m_Triangles;
+	std::vector<std::vector<std::vector<uint32_t>>> m_Bins;
+
+	glm::mat4 m_ViewProj;
+	Texture* m_Textures[MAX_TEXTURE_SLOTS];
+	uint32_t m_TextureCount;
+	bool m_AlphaTest;
+	bool m_Shapes;
+	bool m_Sdf;
+	RasterBlend m_Blend;
+	bool m_DepthTest;
+
+	uint64_t m_ShadedPixels;
+	float m_RasterTimeMs;
+};
@@ -0,0 +1,321 @@
+#include "SpatialIndex.h"
+
+#include <math.h>
+#include <float.h>
+
+SpatialIndex::SpatialIndex(float cellSize)
+	: m_CellSize(cellSize > 0.0f ? cellSize : 1.0f), m_ItemCount(0), m_MinZ(FLT_MAX), m_MaxZ(-FLT_MAX)
+{
+	m_InvCellSize = 1.0f / m_CellSize;
+}
+
+SpatialBounds SpatialIndex::GetQuadBounds(const Transform& transform)
+{
+	// the quad is flat, so the extent on every axis comes from the first two rotation columns
+	glm::mat4 rotation = GetRotation(transform.Rotation);
+	glm::vec3 halfX = glm::vec3(rotation[0]) * (transform.Scale.X * 0.5f);
+	glm::vec3 halfY = glm::vec3(rotation[1]) * (transform.Scale.Y * 0.5f);
+	glm::vec3 extent = glm::abs(halfX) + glm::abs(halfY);
+
+	const Vec3& location = transform.Location;
+	return
+	{
+		{ location.X - extent.x, location.Y - extent.y, location.Z - extent.z },
+		{ location.X + extent.x, location.Y + extent.y, location.Z + extent.z }
+	};
+}
+
+uint64_t SpatialIndex::GetCellKey(float x, float y) const
+{
+	int32_t cellX = (int32_t)floorf(x * m_InvCellSize);
+	int32_t cellY = (int32_t)floorf(y * m_InvCellSize);
+	return ((uint64_t)(uint32_t)cellX << 32) | (uint32_t)cellY;
+}
+
+void SpatialIndex::Link(uint32_t item)
+{
+	Item& entry = m_Items[item];
+	const SpatialBounds& bounds = entry.Bounds;
+
+	float halfWidth = (bounds.Max.X - bounds.Min.X) * 0.5f;
+	float halfHeight = (bounds.Max.Y - bounds.Min.Y) * 0.5f;
+
+	std::vector<uint32_t>* items;
+	if (halfWidth > m_CellSize * 0.5f || halfHeight > m_CellSize * 0.5f)
+	{
+		entry.Cell = LargeCell;
+		items = &m_Large;
+	}
+	else
+	{
+		entry.Cell = GetCellKey(bounds.Min.X + halfWidth, bounds.Min.Y + halfHeight);
+		items = &m_Cells[entry.Cell];
+	}
+
+	entry.Slot = (uint32_t)items->size();
+	items->push_back(item);
+
+	if (bounds.Min.Z < m_MinZ)
+		m_MinZ = bounds.Min.Z;
+	if (bounds.Max.Z > m_MaxZ)
+		m_MaxZ = bounds.Max.Z;
+}
+
+// swap with the last one in the cell, so the item that moved into the slot needs its Slot fixed
+void SpatialIndex::Unlink(uint32_t item)
+{
+	Item& entry = m_Items[item];
+	std::vector<uint32_t>& items = entry.Cell == LargeCell ? m_Large : m_Cells.find(entry.Cell)->second;
+
+	uint32_t last = items.back();
+	items[entry.Slot] = last;
+	m_Items[last].Slot = entry.Slot;
+	items.pop_back();
+}
+
+uint32_t SpatialIndex::Insert(const Transform& transform)
+{
+	uint32_t item;
+	if (!m_FreeItems.empty())
+	{
+		item = m_FreeItems.back();
+		m_FreeItems.pop_back();
+	}
+	else
+	{
+		item = (uint32_t)m_Items.size();
+		m_Items.emplace_back();
+	}
+
+	m_Items[item].Transform = transform;
+	m_Items[item].Bounds = GetQuadBounds(transform);
+	Link(item);
+
+	m_ItemCount++;
+	return item;
+}
+
+bool SpatialIndex::Move(uint32_t item, const Transform& transform)
+{
+	if (!IsValid(item))
+		return false;
+
+	Item& entry = m_Items[item];
+	entry.Transform = transform;
+	entry.Bounds = GetQuadBounds(transform);
+
+	// most moves stay in the same cell, then only the bounds change
+	const SpatialBounds& bounds = entry.Bounds;
+	float halfWidth = (bounds.Max.X - bounds.Min.X) * 0.5f;
+	float halfHeight = (bounds.Max.Y - bounds.Min.Y) * 0.5f;
+	bool large = halfWidth > m_CellSize * 0.5f || halfHeight > m_CellSize * 0.5f;
+
+	if (!large && entry.Cell != LargeCell && entry.Cell == GetCellKey(bounds.Min.X + halfWidth, bounds.Min.Y + halfHeight))
+	{
+		if (bounds.Min.Z < m_MinZ)
+			m_MinZ = bounds.Min.Z;
+		if (bounds.Max.Z > m_MaxZ)
+			m_MaxZ = bounds.Max.Z;
+		return true;
+	}
+
+	Unlink(item);
+	Link(item);
+	return true;
+}
+
+bool SpatialIndex::Remove(uint32_t item)
+{
+	// a second remove would unlink a cell that isn't there and put the handle on the free list twice
+	if (!IsValid(item))
+		return false;
+
+	Unlink(item);
+	m_Items[item].Cell = FreeCell;
+	m_FreeItems.push_back(item);
+	m_ItemCount--;
+	return true;
+}
+
+void SpatialIndex::Clear()
+{
+	m_Items.clear();
+	m_FreeItems.clear();
+	m_Cells.clear();
+	m_Large.clear();
+	m_ItemCount = 0;
+	m_MinZ = FLT_MAX;
+	m_MaxZ = -FLT_MAX;
+}
+
+// calls visit for every item whose cell (or the large list) could overlap the rect, the bounds still need a test
+template<typename Visit>
+void SpatialIndex::ForEachInRect(Vec2 min, Vec2 max, Visit visit) const
+{
+	for (uint32_t item : m_Large)
+		visit(item);
+
+	// loose cells, an item centered in a neighbour cell can stick out half a cell into the rect
+	float margin = m_CellSize * 0.5f;
+	double cellMinX = floor((min.X - margin) * m_InvCellSize);
+	double cellMinY = floor((min.Y - margin) * m_InvCellSize);
+	double cellMaxX = floor((max.X + margin) * m_InvCellSize);
+	double cellMaxY = floor((max.Y + margin) * m_InvCellSize);
+
+	double rangeCells = (cellMaxX - cellMinX + 1.0) * (cellMaxY - cellMinY + 1.0);
+	if (rangeCells > (double)m_Cells.size())
+	{
+		// a rect covering most of the world, walking the occupied cells is cheaper than looking every cell up
+		for (const auto& cell : m_Cells)
+		{
+			double cellX = (double)(int32_t)(cell.first >> 32);
+			double cellY = (double)(int32_t)(uint32_t)cell.first;
+			if (cellX < cellMinX || cellX > cellMaxX || cellY < cellMinY || cellY > cellMaxY)
+				continue;
+
+			for (uint32_t item : cell.second)
+				visit(item);
+		}
+		return;
+	}
+
+	for (int32_t y = (int32_t)cellMinY; y <= (int32_t)cellMaxY; y++)
+	{
+		for (int32_t x = (int32_t)cellMinX; x <= (int32_t)cellMaxX; x++)
+		{
+			auto cell = m_Cells.find(((uint64_t)(uint32_t)x << 32) | (uint32_t)y);
+			if (cell == m_Cells.end())
+				continue;
+
+			for (uint32_t item : cell->second)
+				visit(item);
+		}
+	}
+}
+
+void SpatialIndex::QueryRect(Vec2 min, Vec2 max, std::vector<uint32_t>& results) const
+{
+	ForEachInRect(min, max, [&](uint32_t item)
+	{
+		const SpatialBounds& bounds = m_Items[item].Bounds;
+		if (bounds.Max.X >= min.X && bounds.Min.X <= max.X && bounds.Max.Y >= min.Y && bounds.Min.Y <= max.Y)
+			results.push_back(item);
+	});
+}
+
+void SpatialIndex::QueryPoint(Vec2 point, std::vector<uint32_t>& results) const
+{
+	ForEachInRect(point, point, [&](uint32_t item)
+	{
+		const Item& entry = m_Items[item];
+		const SpatialBounds& bounds = entry.Bounds;
+		if (point.X < bounds.Min.X || point.X > bounds.Max.X || point.Y < bounds.Min.Y || point.Y > bounds.Max.Y)
+			return;
+
+		const Transform& transform = entry.Transform;
+		if (transform.Rotation.X != 0.0f || transform.Rotation.Y != 0.0f)
+		{
+			results.push_back(item);
+			return;
+		}
+
+		// into the quad's space, where it's the -0.5..0.5 square scaled
+		float radians = glm::radians(transform.Rotation.Z);
+		float s = sinf(radians);
+		float c = cosf(radians);
+		float dx = point.X - transform.Location.X;
+		float dy = point.Y - transform.Location.Y;
+		float localX = c * dx + s * dy;
+		float localY = -s * dx + c * dy;
+
+		if (fabsf(localX) <= fabsf(transform.Scale.X) * 0.5f && fabsf(localY) <= fabsf(transform.Scale.Y) * 0.5f)
+			results.push_back(item);
+	});
+}
+
+void SpatialIndex::QueryFrustum(const glm::mat4& viewProj, std::vector<uint32_t>& results) const
+{
+	if (m_ItemCount == 0)
+		return;
+
+	// Every item sits between m_MinZ and m_MaxZ, so only the part of the frustum inside that slab matters.
+	// Its XY bounds come from the frustum corners inside the slab and the frustum edges crossing the slab planes.
+	glm::mat4 inverse = glm::inverse(viewProj);
+	glm::vec3 corners[8];
+	for (uint32_t i = 0; i < 8; i++)
+	{
+		glm::vec4 corner = inverse * glm::vec4(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f, 1.0f);
+		corners[i] = glm::vec3(corner) / corner.w;
+	}
+
+	// pairs of corner indices differing in one bit
+	static const uint32_t edges[12][2] =
+	{
+		{ 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 },
+		{ 0, 2 }, { 1, 3 }, { 4, 6 }, { 5, 7 },
+		{ 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 }
+	};
+
+	Vec2 min = { FLT_MAX, FLT_MAX };
+	Vec2 max = { -FLT_MAX, -FLT_MAX };
+	auto grow = [&](const glm::vec3& point)
+	{
+		min.X = point.x < min.X ? point.x : min.X;
+		min.Y = point.y < min.Y ? point.y : min.Y;
+		max.X = point.x > max.X ? point.x : max.X;
+		max.Y = point.y > max.Y ? point.y : max.Y;
+	};
+
+	for (uint32_t i = 0; i < 8; i++)
+	{
+		if (corners[i].z >= m_MinZ && corners[i].z <= m_MaxZ)
+			grow(corners[i]);
+	}
+
+	float planes[2] = { m_MinZ, m_MaxZ };
+	for (uint32_t i = 0; i < 12; i++)
+	{
+		const glm::vec3& a = corners[edges[i][0]];
+		const glm::vec3& b = corners[edges[i][1]];
+
+		for (float z : planes)
+		{
+			if ((a.z - z) * (b.z - z) > 0.0f || a.z == b.z)
+				continue;
+
+			grow(a + (b - a) * ((z - a.z) / (b.z - a.z)));
+		}
+	}
+
+	if (min.X > max.X)
+		return;
+
+	// Gribb/Hartmann, every plane as (normal, distance) with the normal pointing inside
+	glm::vec4 rows[4];
+	for (uint32_t i = 0; i < 4; i++)
+		rows[i] = glm::vec4(viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i]);
+
+	glm::vec4 frustum[6] =
+	{
+		rows[3] + rows[0], rows[3] - rows[0],
+		rows[3] + rows[1], rows[3] - rows[1],
+		rows[3] + rows[2], rows[3] - rows[2]
+	};
+
+	ForEachInRect(min, max, [&](uint32_t item)
+	{
+		const SpatialBounds& bounds = m_Items[item].Bounds;
+
+		for (const glm::vec4& plane : frustum)
+		{
+			// the corner furthest along the normal, if even that one is outside the whole box is
+			float x = plane.x >= 0.0f ? bounds.Max.X : bounds.Min.X;
+			float y = plane.y >= 0.0f ? bounds.Max.Y : bounds.Min.Y;
+			float z = plane.z >= 0.0f ? bounds.Max.Z : bounds.Min.Z;
+			if (plane.x * x + plane.y * y + plane.z * z + plane.w < 0.0f)
+				return;
+		}
+
+		results.push_back(item);
+	});
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+#include <unordered_map>
+
+#include "glm/glm.hpp"
+
+#include "Renderer2D.h"
+
+struct SpatialBounds
+{
+	Vec3 Min;
+	Vec3 Max;
+};
+
+// Loose hashed grid over the XY plane for quads that stay around between frames.
+// Every item lives in the one cell its center falls in, so insert/move/remove are O(1) and queries look
+// half a cell further out to catch the quads hanging over from the neighbours. Items bigger than half a cell
+// would make that margin useless, those go in a separate list every query checks.
+// Handles are stable until the item is removed and get reused after, the caller keeps its own per item data by handle.
+class SpatialIndex
+{
+public:
+	static const uint32_t InvalidItem = 0xffffffff;
+
+	SpatialIndex(float cellSize);
+
+	uint32_t Insert(const Transform& transform);
+	// false and nothing changes when the item was removed or never inserted
+	bool Move(uint32_t item, const Transform& transform);
+	bool Remove(uint32_t item);
+	void Clear();
+
+	// all of them append to results, rect and frustum test the item bounds
+	void QueryRect(Vec2 min, Vec2 max, std::vector<uint32_t>& results) const;
+	void QueryFrustum(const glm::mat4& viewProj, std::vector<uint32_t>& results) const;
+	// exact for quads only rotated around Z, the rest are picked by their bounds
+	void QueryPoint(Vec2 point, std::vector<uint32_t>& results) const;
+
+	inline const Transform& GetTransform(uint32_t item) const { return m_Items[item].Transform; }
+	inline const SpatialBounds& GetBounds(uint32_t item) const { return m_Items[item].Bounds; }
+	inline bool IsValid(uint32_t item) const { return item < m_Items.size() && m_Items[item].Cell != FreeCell; }
+
+	inline uint32_t GetItemCount() const { return m_ItemCount; }
+	inline uint32_t GetHandleRange() const { return (uint32_t)m_Items.size(); } // size for arrays indexed by handle
+	inline uint32_t GetCellCount() const { return (uint32_t)m_Cells.size(); }
+	inline uint32_t GetLargeItemCount() const { return (uint32_t)m_Large.size(); }
+
+	// world bounds of the unit quad through the transform
+	static SpatialBounds GetQuadBounds(const Transform& transform);
+
+private:
+	static const uint64_t LargeCell = 0xfffffffffffffffeull;
+	static const uint64_t FreeCell = 0xffffffffffffffffull;
+
+	struct Item
+	{
+		Transform Transform;
+		SpatialBounds Bounds;
+		uint64_t Cell; // LargeCell when it's in m_Large, FreeCell when removed
+		uint32_t Slot; // index in the cell (or m_Large)
+	};
+
+	uint64_t GetCellKey(float x, float y) const;
+	void Link(uint32_t item);
+	void Unlink(uint32_t item);
+
+	template<typename Visit>
+	void ForEachInRect(Vec2 min, Vec2 max, Visit visit) const;
+
+private:
+	float m_CellSize;
+	float m_InvCellSize;
+
+	std::vector<Item> m_Items;
+	std::vector<uint32_t> m_FreeItems;
+	std::unordered_map<uint64_t, std::vector<uint32_t>> m_Cells; // emptied cells stay, so they keep their capacity
+	std::vector<uint32_t> m_Large;
+	uint32_t m_ItemCount;
+
+	// Z range of everything ever inserted, frustum queries cut the frustum down to this slab
+	float m_MinZ;
+	float m_MaxZ;
+};
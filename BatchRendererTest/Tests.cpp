@@ -0,0 +1,1109 @@
+#include "Tests.h"
+
+#include "GL/glew.h"
+#include "GLFW/glfw3.h"
+
+#include "Renderer2D.h"
+#include "SoftwareRasterizer.h"
+#include "GoldenImage.h"
+#include "Texture.h"
+#include "GpuQuadCuller.h"
+#include "QuadStore.h"
+#include "SpatialIndex.h"
+#include "RenderTarget.h"
+#include "RenderThread.h"
+#include "FramePacer.h"
+#include "ParticleSystem.h"
+#include "Tilemap.h"
+#include "Font.h"
+#include "Buffer.h"
+#include "Math.h"
+#include "WorkerPool.h"
+#include "DemoScenes.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <atomic>
+#include <functional>
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+////////////////////////////////////////////////
+/////////////// GOLDEN IMAGES //////////////////
+////////////////////////////////////////////////
+
+// Every scene gets its own Renderer2D, so batching, CalcVertices and the Vertex format are all covered,
+// which is what optimizations tend to break.
+
+static const uint32_t GOLDEN_WIDTH = 480;
+static const uint32_t GOLDEN_HEIGHT = 270;
+static const uint32_t GOLDEN_MAX_QUADS = 10000;
+static const float GOLDEN_THRESHOLD = 0.01f;     // perceptual delta for a pixel to count as different
+static const float GOLDEN_MAX_DIFFERENT = 0.001f; // fraction of different pixels still accepted
+
+// the demo's own scenes (DemoScenes.h) with fixed settings, plus a few that go after the batching
+struct GoldenScene
+{
+	std::string Name;
+	Camera Camera;
+	Vec3 ClearColor;
+	std::function<void(Renderer2D*)> Draw; // between BeginScene and EndScene
+};
+
+static Image RenderGoldenScene(Renderer2D* goldenRenderer, const GoldenScene& scene)
+{
+	goldenRenderer->Clear(scene.ClearColor);
+	goldenRenderer->BeginScene(scene.Camera);
+	scene.Draw(goldenRenderer);
+	goldenRenderer->EndScene();
+
+	SoftwareRasterizer* raster = goldenRenderer->GetRasterizer();
+	return MakeImage(raster->GetColorBuffer(), raster->GetWidth(), raster->GetHeight(), raster->GetStride());
+}
+
+static std::vector<GoldenScene> BuildGoldenScenes(Texture* doomTexture, const std::vector<Texture*>& thrashTextures)
+{
+	std::vector<GoldenScene> scenes;
+
+	// the demo's camera and clear color at startup
+	Camera defaultCamera;
+	defaultCamera.FOV = 60.0f;
+	defaultCamera.AspectRatio = (float)GOLDEN_WIDTH / GOLDEN_HEIGHT;
+	defaultCamera.Transform = { { 0.0f, 0.0f, -5.0f }, { 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f } };
+	Vec3 defaultClearColor = { 0.321f, 0.058f, 0.784f };
+
+	{
+		// the default 50 x 50 board, white squares are untextured and the rest textured
+		GoldenScene scene;
+		scene.Name = "checkerboard";
+		scene.Camera = defaultCamera;
+		scene.Camera.Transform.Location = { 24.5f, 24.5f, -45.0f };
+		scene.ClearColor = defaultClearColor;
+		scene.Draw = [doomTexture](Renderer2D* target)
+		{
+			DrawCheckerboardRect(target, { doomTexture, { 1.0f, 1.0f, 1.0f }, 1.0f }, 0, 0, 50, 50);
+		};
+
+		scenes.push_back(scene);
+	}
+
+	{
+		// the main quad frozen 1.25s into the default rotation, untextured and tinted
+		GoldenScene scene;
+		scene.Name = "main_quad";
+		scene.Camera = defaultCamera;
+		scene.ClearColor = defaultClearColor;
+		scene.Draw = [](Renderer2D* target)
+		{
+			DrawMainQuad(target, { { 0.0f, 0.0f, -0.2f }, { 0.0f, 0.0f, 50.0f * 1.25f }, { 1.5f, 1.5f, 1.0f } }, { 0.2f, 0.92f, 0.52f });
+		};
+
+		scenes.push_back(scene);
+	}
+
+	{
+		// the shape permutation, its edges blend over the clear color
+		GoldenScene scene;
+		scene.Name = "debug_shapes";
+		scene.Camera = defaultCamera;
+		scene.Camera.Transform.Location = { -3.0f, 0.4f, -2.0f };
+		scene.ClearColor = defaultClearColor;
+		scene.Draw = [](Renderer2D* target)
+		{
+			DrawDebugShapes(target, 400);
+		};
+
+		scenes.push_back(scene);
+	}
+
+	{
+		// textured and tinted sprites going through a submission context and the merge at EndScene
+		GoldenScene scene;
+		scene.Name = "parallel_sprites";
+		scene.Camera = defaultCamera;
+		scene.Camera.Transform.Location = { -3.0f, -1.1f, -1.0f };
+		scene.ClearColor = defaultClearColor;
+		scene.Draw = [doomTexture](Renderer2D* target)
+		{
+			EmitParallelSprites(target->GetSubmissionContext(0), doomTexture, 0, 2000, 1.25f);
+		};
+
+		scenes.push_back(scene);
+	}
+
+	{
+		// more textures than slots, so it has to split into several batches, tinted towards the top
+		GoldenScene scene;
+		scene.Name = "texture_thrash";
+		scene.Camera = defaultCamera;
+		scene.Camera.Transform.Location = { 15.5f, 7.5f, -20.0f };
+		scene.ClearColor = { 0.0f, 0.0f, 0.0f };
+		std::vector<Texture*> textures = thrashTextures;
+		textures.push_back(doomTexture);
+		scene.Draw = [textures](Renderer2D* target)
+		{
+			for (int32_t y = 0; y < 16; y++)
+			{
+				for (int32_t x = 0; x < 32; x++)
+				{
+					Texture* texture = textures[(x + y * 7) % textures.size()];
+					float tiling = 1.0f + (x % 3);
+					Transform transform = { { (float)x, (float)y, 0.0f }, { 0.0f, 0.0f, (float)(x * 11 + y * 5) }, { 0.9f, 0.9f, 1.0f } };
+					target->DrawQuadTextured(transform, texture, tiling, { 1.0f, 1.0f - y / 32.0f, 1.0f });
+				}
+			}
+		};
+
+		scenes.push_back(scene);
+	}
+
+	return scenes;
+}
+
+int32_t RunGoldenTests(bool capture)
+{
+	// nothing here has a context, the textures only keep their pixels for the rasterizer
+	Texture* doomTexture = Texture::FromFile("res/doom.png", true);
+	if (!doomTexture)
+	{
+		std::cout << "[FAILED] golden: can't load res/doom.png" << std::endl;
+		return 1;
+	}
+
+	// small procedural textures, 2x the slot count so the thrash scene really thrashes
+	std::vector<Texture*> thrashTextures;
+	for (uint32_t i = 0; i < MAX_TEXTURE_SLOTS * 2; i++)
+	{
+		uint32_t pixels[8 * 8];
+		for (uint32_t p = 0; p < 8 * 8; p++)
+		{
+			bool odd = ((p % 8) + (p / 8) + i) % 2;
+			uint32_t r = (i * 53) % 256, g = (i * 97) % 256, b = (i * 193) % 256;
+			pixels[p] = odd ? (r | (g << 8) | (b << 16) | 0xff000000) : 0xff202020;
+		}
+		thrashTextures.push_back(new Texture(8, 8, 4, (unsigned char*)pixels, 1, true));
+	}
+
+	std::vector<GoldenScene> scenes = BuildGoldenScenes(doomTexture, thrashTextures);
+
+	// the scenes render side by side on the workers, each with its own renderer
+	Renderer2DConfig config;
+	config.MaxQuads = GOLDEN_MAX_QUADS;
+	config.ThreadCount = 1;
+	config.SubmissionContexts = 1;
+	config.Backend = RendererBackend::Software;
+	config.Width = GOLDEN_WIDTH;
+	config.Height = GOLDEN_HEIGHT;
+
+	std::vector<std::unique_ptr<Renderer2D>> goldenRenderers;
+	for (uint32_t i = 0; i < scenes.size(); i++)
+		goldenRenderers.emplace_back(new Renderer2D(config));
+
+	std::vector<Image> images(scenes.size());
+	WorkerPool::Get().Run((uint32_t)scenes.size(), [&](uint32_t i)
+	{
+		images[i] = RenderGoldenScene(goldenRenderers[i].get(), scenes[i]);
+	});
+
+	int32_t failed = 0;
+	for (uint32_t i = 0; i < scenes.size(); i++)
+	{
+		const Image& image = images[i];
+		std::string referencePath = "res/golden_" + scenes[i].Name + ".tga";
+
+		if (capture)
+		{
+			bool written = WriteImageTGA(referencePath.c_str(), image);
+			std::cout << (written ? "[CAPTURED] " : "[ERROR] ") << referencePath << std::endl;
+			failed += written ? 0 : 1;
+			continue;
+		}
+
+		Image reference;
+		if (!ReadImage(referencePath.c_str(), reference))
+		{
+			std::cout << "[FAILED] golden " << scenes[i].Name << ": missing reference " << referencePath << std::endl;
+			failed++;
+			continue;
+		}
+
+		ImageDiff diff = CompareImages(reference, image, GOLDEN_THRESHOLD);
+		float differentFraction = (float)diff.DifferentPixels / (image.Width * image.Height);
+		bool passed = !diff.SizeMismatch && differentFraction <= GOLDEN_MAX_DIFFERENT;
+
+		std::cout << (passed ? "[PASSED] " : "[FAILED] ") << "golden " << scenes[i].Name
+			<< ": " << diff.DifferentPixels << " different pixels, max delta " << diff.MaxDelta
+			<< ", mean delta " << diff.MeanDelta << (diff.SizeMismatch ? " (size mismatch)" : "") << std::endl;
+
+		if (!passed)
+		{
+			WriteImageTGA(("golden_" + scenes[i].Name + "_actual.tga").c_str(), image);
+			if (!diff.SizeMismatch)
+				WriteImageTGA(("golden_" + scenes[i].Name + "_diff.tga").c_str(), diff.Heatmap);
+			failed++;
+		}
+	}
+
+	goldenRenderers.clear();
+
+	for (Texture* texture : thrashTextures)
+		delete texture;
+	delete doomTexture;
+
+	return failed;
+}
+
+////////////////////////////////////////////////
+///////////////////// MATH /////////////////////
+////////////////////////////////////////////////
+
+// what Math.h promises for |angle| up to 8192
+static const float SINCOS_RANGE = 8192.0f;
+static const double SINCOS_MAX_ERROR = 8e-8;
+// odd on purpose, the last few go through the scalar tail
+static const uint32_t SINCOS_SAMPLES = 1000003;
+
+int32_t RunSinCosTest()
+{
+	std::vector<float> angles(SINCOS_SAMPLES);
+	std::vector<float> sines(SINCOS_SAMPLES);
+	std::vector<float> cosines(SINCOS_SAMPLES);
+
+	// both ends included
+	for (uint32_t i = 0; i < SINCOS_SAMPLES; i++)
+		angles[i] = (float)(-SINCOS_RANGE + 2.0 * SINCOS_RANGE * i / (SINCOS_SAMPLES - 1));
+
+	SinCos(angles.data(), sines.data(), cosines.data(), SINCOS_SAMPLES);
+
+	double sinMaxError = 0.0;
+	double cosMaxError = 0.0;
+	float sinWorst = 0.0f;
+	float cosWorst = 0.0f;
+	for (uint32_t i = 0; i < SINCOS_SAMPLES; i++)
+	{
+		double sinError = fabs(sines[i] - sin((double)angles[i]));
+		double cosError = fabs(cosines[i] - cos((double)angles[i]));
+		if (sinError > sinMaxError)
+		{
+			sinMaxError = sinError;
+			sinWorst = angles[i];
+		}
+		if (cosError > cosMaxError)
+		{
+			cosMaxError = cosError;
+			cosWorst = angles[i];
+		}
+	}
+
+	bool passed = sinMaxError <= SINCOS_MAX_ERROR && cosMaxError <= SINCOS_MAX_ERROR;
+	std::cout << (passed ? "[PASSED] " : "[FAILED] ") << "SinCos over +-" << SINCOS_RANGE << ": max error " << sinMaxError << " sin (at " << sinWorst << "), "
+		<< cosMaxError << " cos (at " << cosWorst << "), allowed " << SINCOS_MAX_ERROR << std::endl;
+
+	return passed ? 0 : 1;
+}
+
+////////////////////////////////////////////////
+/////////////////// RASTERIZER /////////////////
+////////////////////////////////////////////////
+
+static const uint32_t RASTER_TEST_SIZE = 16;
+
+// a quad from pixel (x0, y0) to (x1, y1), the identity matrix is clip space so that's all DrawQuads needs
+static void MakeRasterQuad(Vertex* vertices, float x0, float y0, float x1, float y1, Vec3 color, Vec2 uv0, Vec2 uv1, float textureIndex)
+{
+	float scale = 2.0f / RASTER_TEST_SIZE;
+	x0 = x0 * scale - 1.0f; y0 = y0 * scale - 1.0f;
+	x1 = x1 * scale - 1.0f; y1 = y1 * scale - 1.0f;
+
+	vertices[0] = { { x0, y0, 0.0f }, color, { uv0.X, uv0.Y }, textureIndex };
+	vertices[1] = { { x1, y0, 0.0f }, color, { uv1.X, uv0.Y }, textureIndex };
+	vertices[2] = { { x1, y1, 0.0f }, color, { uv1.X, uv1.Y }, textureIndex };
+	vertices[3] = { { x0, y1, 0.0f }, color, { uv0.X, uv1.Y }, textureIndex };
+}
+
+int32_t RunRasterizerTest()
+{
+	int32_t failed = 0;
+	auto check = [&failed](bool passed, const char* what)
+	{
+		std::cout << (passed ? "[PASSED] " : "[FAILED] ") << "rasterizer: " << what << std::endl;
+		failed += passed ? 0 : 1;
+	};
+
+	SoftwareRasterizer rasterizer(RASTER_TEST_SIZE, RASTER_TEST_SIZE, 1);
+	const uint32_t* pixels = rasterizer.GetColorBuffer();
+	uint32_t stride = rasterizer.GetStride();
+	Vertex quad[4];
+
+	uint32_t whitePixel = 0xffffffff;
+	Texture whiteTexture(1, 1, 4, (unsigned char*)&whitePixel, 1, true);
+	Texture* slots[1] = { &whiteTexture };
+	rasterizer.SetTextures(slots, 1);
+
+	// every edge and the diagonal run through pixel centers, 8 x 8 of them belong to the quad
+	rasterizer.Clear({ 0.0f, 0.0f, 0.0f });
+	MakeRasterQuad(quad, 0.5f, 0.5f, 8.5f, 8.5f, { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f }, { 1.0f, 1.0f }, 0.0f);
+	rasterizer.DrawQuads(quad, 1, glm::mat4(1.0f));
+	check(rasterizer.GetShadedPixels() == 64 && pixels[1 * stride + 0] == 0xffffffff && pixels[0 * stride + 0] == 0xff000000 && pixels[8 * stride + 8] == 0xff000000,
+		"pixel centers on an edge are shaded once, by the left and top edges only");
+
+	// a white circle over black, solid inside, untouched outside and blended in between
+	rasterizer.Clear({ 0.0f, 0.0f, 0.0f });
+	rasterizer.SetShapes(true);
+	rasterizer.SetBlend(RasterBlend::Coverage);
+	float half = RASTER_TEST_SIZE * 0.5f;
+	MakeRasterQuad(quad, 0.0f, 0.0f, (float)RASTER_TEST_SIZE, (float)RASTER_TEST_SIZE, { 1.0f, 1.0f, 1.0f }, { -half, -half }, { half, half },
+		PackShape({ (float)ShapeKind_Circle, half, 0.0f, 0.0f }));
+	rasterizer.DrawQuads(quad, 1, glm::mat4(1.0f));
+
+	uint32_t partial = 0;
+	for (uint32_t y = 0; y < RASTER_TEST_SIZE; y++)
+	{
+		for (uint32_t x = 0; x < RASTER_TEST_SIZE; x++)
+		{
+			uint32_t red = pixels[y * stride + x] & 0xff;
+			partial += red > 0 && red < 255 ? 1 : 0;
+		}
+	}
+	check(pixels[8 * stride + 8] == 0xffffffff && pixels[0] == 0xff000000 && partial > 0, "shape edges blend over what's already there");
+
+	// half transparent premultiplied red over blue, like a layer composite
+	uint32_t premultipliedRed = 0x80000080;
+	Texture redTexture(1, 1, 4, (unsigned char*)&premultipliedRed, 1, true);
+	slots[0] = &redTexture;
+	rasterizer.SetTextures(slots, 1);
+	rasterizer.SetShapes(false);
+	rasterizer.SetBlend(RasterBlend::Premultiplied);
+	rasterizer.Clear({ 0.0f, 0.0f, 1.0f });
+	MakeRasterQuad(quad, 0.0f, 0.0f, (float)RASTER_TEST_SIZE, (float)RASTER_TEST_SIZE, { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f }, { 1.0f, 1.0f }, 0.0f);
+	rasterizer.DrawQuads(quad, 1, glm::mat4(1.0f));
+
+	uint32_t composited = pixels[8 * stride + 8];
+	int32_t red = composited & 0xff, blue = (composited >> 16) & 0xff;
+	check(abs(red - 128) <= 1 && abs(blue - 127) <= 1, "premultiplied composites add the color and keep what the alpha lets through");
+
+	return failed;
+}
+
+////////////////////////////////////////////////
+///////////////// SPATIAL INDEX ////////////////
+////////////////////////////////////////////////
+
+int32_t RunSpatialIndexTest()
+{
+	int32_t failed = 0;
+	auto check = [&failed](bool passed, const char* what)
+	{
+		std::cout << (passed ? "[PASSED] " : "[FAILED] ") << "spatial index: " << what << std::endl;
+		failed += passed ? 0 : 1;
+	};
+
+	SpatialIndex index(4.0f);
+	Transform close = { { 1.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f } };
+	Transform distant = { { 100.0f, 100.0f, 0.0f }, { 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f } };
+
+	uint32_t first = index.Insert(close);
+	uint32_t second = index.Insert(close);
+
+	bool removed = index.Remove(second);
+	bool removedTwice = index.Remove(second);
+	check(removed && !removedTwice && index.GetItemCount() == 1, "a second remove is turned down and the count stays");
+
+	bool moved = index.Move(second, distant);
+	check(!moved && !index.IsValid(second) && index.GetItemCount() == 1, "a move through a removed handle doesn't bring it back");
+
+	check(!index.Remove(SpatialIndex::InvalidItem) && !index.Move(index.GetHandleRange() + 10, close), "handles that were never handed out are turned down");
+
+	// the handle went on the free list once, so the next two inserts get different ones
+	uint32_t reused = index.Insert(close);
+	uint32_t fresh = index.Insert(close);
+	check(reused == second && fresh != reused && fresh != first && index.GetItemCount() == 3, "the free list only has the removed handle once");
+
+	std::vector<uint32_t> results;
+	index.QueryRect({ 0.0f, 0.0f }, { 2.0f, 2.0f }, results);
+	check(results.size() == 3, "a query finds every live item once");
+
+	return failed;
+}
+
+////////////////////////////////////////////////
+////////////////////// GPU /////////////////////
+////////////////////////////////////////////////
+
+// small on purpose, llvmpipe has to get through it too
+static const uint32_t GPU_TEST_SIZE = 256;
+static const uint32_t GPU_CULL_TEST_QUADS = 20000;
+// the visible count comes from a query that answers a few frames late
+static const uint32_t GPU_CULL_TEST_FRAMES = 8;
+
+static const uint32_t QUAD_STORE_TEST_QUADS = 20000;
+// the size of the demo field
+static const uint32_t QUAD_STORE_BENCHMARK_QUADS = 1000000;
+static const uint32_t QUAD_STORE_BENCHMARK_FRAMES = 10;
+static const float QUAD_STORE_BENCHMARK_PERCENTS[3] = { 0.1f, 1.0f, 10.0f };
+
+// rand differs between CRTs, this gives the same quads everywhere. [0, range)
+static uint32_t NextRandom(uint32_t& seed, uint32_t range)
+{
+	seed = seed * 1664525u + 1013904223u;
+	return (seed >> 8) % range;
+}
+
+// somewhere in the 100 x 100 square around the origin the cull tests look at
+static GpuQuad MakeRandomQuad(uint32_t& seed, uint32_t textureSlot, bool tilted)
+{
+	Vec3 location = { NextRandom(seed, 1000) / 10.0f - 50.0f, NextRandom(seed, 1000) / 10.0f - 50.0f, NextRandom(seed, 200) / 10.0f };
+	Vec3 rotation = { tilted ? (float)NextRandom(seed, 90) : 0.0f, 0.0f, (float)NextRandom(seed, 360) };
+	Vec3 scale = { 0.5f + NextRandom(seed, 10) / 5.0f, 0.5f, 1.0f };
+	return MakeGpuQuad({ location, rotation, scale }, { 1.0f, 0.5f, 0.2f }, textureSlot);
+}
+
+static Camera MakeCullTestCamera()
+{
+	Camera camera;
+	camera.FOV = 60.0f;
+	camera.AspectRatio = 1.0f;
+	camera.Transform = { { 5.0f, -3.0f, -30.0f }, { 0.0f, 10.0f, 0.0f }, { 1.0f, 1.0f, 1.0f } };
+	return camera;
+}
+
+// a few frames into a target of its own, so the primitives query has an answer
+static void DrawCulledQuads(GpuQuadCuller* culler, const Camera& camera, uint32_t quadCount)
+{
+	RenderTarget* target = new RenderTarget(GPU_TEST_SIZE, GPU_TEST_SIZE);
+	glBindFramebuffer(GL_FRAMEBUFFER, target->GetFramebufferID());
+	glViewport(0, 0, GPU_TEST_SIZE, GPU_TEST_SIZE);
+	glEnable(GL_DEPTH_TEST);
+
+	for (uint32_t frame = 0; frame < GPU_CULL_TEST_FRAMES; frame++)
+	{
+		glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		culler->Draw(GetViewMatrix(camera), GetProjectionMatrix(camera), quadCount);
+		glFinish();
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	delete target;
+}
+
+// the same planes and bounding sphere as GpuQuadCuller::Draw and res/gpu_cull.txt
+static uint32_t CountVisibleQuads(const std::vector<GpuQuad>& quads, const glm::mat4& viewProj)
+{
+	glm::vec4 rows[4];
+	for (uint32_t i = 0; i < 4; i++)
+		rows[i] = glm::vec4(viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i]);
+
+	glm::vec4 planes[6] =
+	{
+		rows[3] + rows[0], rows[3] - rows[0],
+		rows[3] + rows[1], rows[3] - rows[1],
+		rows[3] + rows[2], rows[3] - rows[2]
+	};
+	for (glm::vec4& plane : planes)
+		plane /= glm::length(glm::vec3(plane));
+
+	uint32_t visible = 0;
+	for (const GpuQuad& quad : quads)
+	{
+		if (quad.Color.W == 0.0f)
+			continue;
+
+		glm::vec3 center(quad.CenterTexture.X, quad.CenterTexture.Y, quad.CenterTexture.Z);
+		glm::vec3 halfX(quad.HalfX.X, quad.HalfX.Y, quad.HalfX.Z);
+		glm::vec3 halfY(quad.HalfY.X, quad.HalfY.Y, quad.HalfY.Z);
+		float radius = sqrtf(glm::dot(halfX, halfX) + glm::dot(halfY, halfY));
+
+		bool inside = true;
+		for (const glm::vec4& plane : planes)
+			inside = inside && glm::dot(glm::vec3(plane), center) + plane.w >= -radius;
+		visible += inside ? 1 : 0;
+	}
+	return visible;
+}
+
+int32_t RunGpuCullTest()
+{
+	if (!GpuQuadCuller::IsSupported())
+	{
+		std::cout << "[SKIPPED] gpu cull: no compute shaders" << std::endl;
+		return 0;
+	}
+
+	uint32_t whitePixel = 0xffffffff;
+	Texture* whiteTexture = new Texture(1, 1, 4, (unsigned char*)&whitePixel);
+
+	GpuQuadCuller* culler = new GpuQuadCuller(GPU_CULL_TEST_QUADS);
+	uint32_t whiteSlot = culler->AddTexture(whiteTexture);
+
+	// some tilted out of the plane, every tenth one a free slot
+	uint32_t seed = 3;
+	std::vector<GpuQuad> quads(GPU_CULL_TEST_QUADS);
+	for (uint32_t i = 0; i < GPU_CULL_TEST_QUADS; i++)
+	{
+		quads[i] = MakeRandomQuad(seed, whiteSlot, i % 4 == 0);
+		if (i % 10 == 0)
+			quads[i].Color.W = 0.0f;
+	}
+	culler->SetQuads(quads.data(), 0, GPU_CULL_TEST_QUADS);
+	culler->SetQuadCount(GPU_CULL_TEST_QUADS);
+
+	Camera camera = MakeCullTestCamera();
+	uint32_t expected = CountVisibleQuads(quads, GetProjectionMatrix(camera) * GetViewMatrix(camera));
+
+	RenderTarget* target = new RenderTarget(GPU_TEST_SIZE, GPU_TEST_SIZE);
+	glBindFramebuffer(GL_FRAMEBUFFER, target->GetFramebufferID());
+	glViewport(0, 0, GPU_TEST_SIZE, GPU_TEST_SIZE);
+	glEnable(GL_DEPTH_TEST);
+
+	for (uint32_t frame = 0; frame < GPU_CULL_TEST_FRAMES; frame++)
+	{
+		glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		culler->Draw(GetViewMatrix(camera), GetProjectionMatrix(camera), GPU_CULL_TEST_QUADS);
+		glFinish();
+	}
+
+	std::vector<uint32_t> pixels(GPU_TEST_SIZE * GPU_TEST_SIZE);
+	glReadPixels(0, 0, GPU_TEST_SIZE, GPU_TEST_SIZE, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+	uint32_t litPixels = 0;
+	for (uint32_t pixel : pixels)
+		litPixels += (pixel & 0x00ffffff) ? 1 : 0;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	GLenum error = glGetError();
+
+	uint32_t visible = culler->GetVisibleCount();
+	bool passed = visible == expected && litPixels > 0 && error == GL_NO_ERROR;
+	std::cout << (passed ? "[PASSED] " : "[FAILED] ") << "gpu cull: " << visible << " visible, " << expected << " on the cpu (of "
+		<< GPU_CULL_TEST_QUADS << "), " << litPixels << " lit pixels, gl error " << error << std::endl;
+
+	// once every slot is taken AddTexture has to say so instead of writing past them
+	std::vector<Texture*> slotTextures;
+	for (uint32_t i = 1; i < MAX_TEXTURE_SLOTS; i++)
+	{
+		slotTextures.push_back(new Texture(1, 1, 4, (unsigned char*)&whitePixel));
+		culler->AddTexture(slotTextures.back());
+	}
+	Texture* extraTexture = new Texture(1, 1, 4, (unsigned char*)&whitePixel);
+	uint32_t extraSlot = culler->AddTexture(extraTexture);
+	uint32_t whiteAgain = culler->AddTexture(whiteTexture);
+
+	bool slotsPassed = extraSlot == GpuQuadCuller::InvalidTextureSlot && whiteAgain == whiteSlot;
+	std::cout << (slotsPassed ? "[PASSED] " : "[FAILED] ") << "gpu cull: texture " << MAX_TEXTURE_SLOTS + 1 << " got slot " << (int32_t)extraSlot
+		<< ", a known one still gets " << whiteAgain << std::endl;
+
+	delete target;
+	delete culler;
+	delete extraTexture;
+	for (Texture* texture : slotTextures)
+		delete texture;
+	delete whiteTexture;
+
+	return (passed ? 0 : 1) + (slotsPassed ? 0 : 1);
+}
+
+int32_t RunQuadStoreTest()
+{
+	if (!GpuQuadCuller::IsSupported())
+	{
+		std::cout << "[SKIPPED] quad store: no compute shaders" << std::endl;
+		return 0;
+	}
+
+	int32_t failed = 0;
+	auto check = [&failed](bool passed, const char* what)
+	{
+		std::cout << (passed ? "[PASSED] " : "[FAILED] ") << "quad store: " << what << std::endl;
+		failed += passed ? 0 : 1;
+	};
+
+	uint32_t whitePixel = 0xffffffff;
+	Texture* whiteTexture = new Texture(1, 1, 4, (unsigned char*)&whitePixel);
+	GpuQuadCuller* culler = new GpuQuadCuller(QUAD_STORE_TEST_QUADS);
+	uint32_t whiteSlot = culler->AddTexture(whiteTexture);
+	QuadStore* store = new QuadStore(culler);
+	uint32_t seed = 5;
+
+	{
+		QuadHandle first = store->CreateQuad(MakeRandomQuad(seed, whiteSlot, false));
+		QuadHandle second = store->CreateQuad(MakeRandomQuad(seed, whiteSlot, false));
+		check(store->IsValid(first) && store->IsValid(second) && store->GetQuadCount() == 2, "created handles are valid");
+
+		bool destroyed = store->DestroyQuad(second);
+		bool destroyedTwice = store->DestroyQuad(second);
+		check(destroyed && !destroyedTwice && store->GetQuadCount() == 1, "a second destroy is turned down and the count stays");
+
+		bool updated = store->UpdateQuad(second, MakeRandomQuad(seed, whiteSlot, false));
+		check(!updated && !store->IsValid(second) && store->GetQuadCount() == 1, "an update through a destroyed handle doesn't bring the slot back");
+
+		// the free slot goes to the next quad, the old handle must not reach it
+		QuadHandle reused = store->CreateQuad(MakeRandomQuad(seed, whiteSlot, false));
+		GpuQuad before = store->GetQuad(reused);
+		bool staleUpdated = store->UpdateQuad(second, MakeRandomQuad(seed, whiteSlot, false));
+		bool staleDestroyed = store->DestroyQuad(second);
+		check(reused != second && !staleUpdated && !staleDestroyed && store->IsValid(reused) && store->GetQuadCount() == 2
+			&& memcmp(&before, &store->GetQuad(reused), sizeof(GpuQuad)) == 0, "a stale handle can't touch the quad that took its slot");
+
+		check(!store->IsValid(QuadStore::InvalidQuad) && !store->IsValid(store->GetSlotCount()) && !store->UpdateQuad(QuadStore::InvalidQuad, before)
+			&& !store->DestroyQuad(store->GetSlotCount() + 100), "handles past the used slots are turned down");
+
+		store->DestroyQuad(first);
+		store->DestroyQuad(reused);
+	}
+
+	// churn with a few stale destroys thrown in, then the GPU has to see exactly the live quads
+	std::vector<QuadHandle> handles;
+	for (uint32_t i = 0; i < QUAD_STORE_TEST_QUADS / 2; i++)
+		handles.push_back(store->CreateQuad(MakeRandomQuad(seed, whiteSlot, false)));
+	std::vector<QuadHandle> destroyedHandles;
+	for (uint32_t i = 0; i < QUAD_STORE_TEST_QUADS / 4; i++)
+	{
+		uint32_t index = NextRandom(seed, (uint32_t)handles.size());
+		if (handles[index] == QuadStore::InvalidQuad)
+			continue;
+		store->DestroyQuad(handles[index]);
+		destroyedHandles.push_back(handles[index]);
+		handles[index] = QuadStore::InvalidQuad;
+	}
+	for (uint32_t i = 0; i < QUAD_STORE_TEST_QUADS / 4; i++)
+		handles.push_back(store->CreateQuad(MakeRandomQuad(seed, whiteSlot, false)));
+	for (QuadHandle quad : destroyedHandles)
+	{
+		store->DestroyQuad(quad);
+		store->UpdateQuad(quad, MakeRandomQuad(seed, whiteSlot, false));
+	}
+
+	uint32_t liveHandles = 0;
+	std::vector<GpuQuad> liveQuads;
+	for (QuadHandle quad : handles)
+	{
+		if (quad == QuadStore::InvalidQuad)
+			continue;
+		liveHandles++;
+		if (store->IsValid(quad))
+			liveQuads.push_back(store->GetQuad(quad));
+	}
+	check(store->GetQuadCount() == liveHandles && liveQuads.size() == liveHandles, "the count matches the live handles after churn");
+
+	store->Flush();
+	Camera camera = MakeCullTestCamera();
+	uint32_t expected = CountVisibleQuads(liveQuads, GetProjectionMatrix(camera) * GetViewMatrix(camera));
+	DrawCulledQuads(culler, camera, culler->GetQuadCount());
+	uint32_t visible = culler->GetVisibleCount();
+	std::cout << (visible == expected ? "[PASSED] " : "[FAILED] ") << "quad store: " << visible << " visible on the gpu, " << expected << " on the cpu" << std::endl;
+	failed += visible == expected ? 0 : 1;
+
+	store->Flush();
+	check(store->GetUploadStats().UploadBytes == 0 && store->GetUploadStats().Ranges == 0, "a flush with nothing changed uploads nothing");
+
+	delete store;
+	delete culler;
+	delete whiteTexture;
+
+	return failed;
+}
+
+// what the demo's benchmark button measures, the numbers go to the log and nothing can fail
+void RunQuadStoreBenchmark()
+{
+	if (!GpuQuadCuller::IsSupported())
+		return;
+
+	GpuQuadCuller* culler = new GpuQuadCuller(QUAD_STORE_BENCHMARK_QUADS);
+	QuadStore* store = new QuadStore(culler);
+	uint32_t seed = 7;
+
+	std::vector<QuadHandle> handles(QUAD_STORE_BENCHMARK_QUADS);
+	for (uint32_t i = 0; i < QUAD_STORE_BENCHMARK_QUADS; i++)
+		handles[i] = store->CreateQuad(MakeRandomQuad(seed, 0, false));
+	store->Flush();
+
+	double fullMB = (double)QUAD_STORE_BENCHMARK_QUADS * sizeof(GpuQuad) / (1024.0 * 1024.0);
+	for (float percent : QUAD_STORE_BENCHMARK_PERCENTS)
+	{
+		uint32_t changed = (uint32_t)(QUAD_STORE_BENCHMARK_QUADS * percent / 100.0f);
+		double bytes = 0.0;
+		double ranges = 0.0;
+		double flushMs = 0.0;
+		for (uint32_t frame = 0; frame < QUAD_STORE_BENCHMARK_FRAMES; frame++)
+		{
+			for (uint32_t i = 0; i < changed; i++)
+				store->UpdateQuad(handles[NextRandom(seed, QUAD_STORE_BENCHMARK_QUADS)], MakeRandomQuad(seed, 0, false));
+
+			// with the upload itself, the stats only time the packing
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			store->Flush();
+			glFinish();
+			std::chrono::duration<double, std::milli> flushTime = std::chrono::steady_clock::now() - start;
+
+			bytes += (double)store->GetUploadStats().UploadBytes / QUAD_STORE_BENCHMARK_FRAMES;
+			ranges += (double)store->GetUploadStats().Ranges / QUAD_STORE_BENCHMARK_FRAMES;
+			flushMs += flushTime.count() / QUAD_STORE_BENCHMARK_FRAMES;
+		}
+
+		std::cout << "[BENCHMARK] quad store " << percent << "% of " << QUAD_STORE_BENCHMARK_QUADS << " changed, merge gap " << store->GetMergeGap()
+			<< ": " << bytes / 1024.0 << " KB per frame (full upload " << fullMB << " MB), " << ranges << " ranges, flush and upload " << flushMs << " ms" << std::endl;
+	}
+
+	delete store;
+	delete culler;
+}
+
+int32_t RunGpuTests()
+{
+	if (!glfwInit())
+	{
+		std::cout << "[FAILED] gpu: glfwInit" << std::endl;
+		return 1;
+	}
+
+	// never shown, it's only there for the context. Any 4.5 driver will do, Mesa llvmpipe included
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+	GLFWwindow* window = glfwCreateWindow(GPU_TEST_SIZE, GPU_TEST_SIZE, "Tests", NULL, NULL);
+	if (!window)
+	{
+		std::cout << "[FAILED] gpu: no 4.5 core context" << std::endl;
+		glfwTerminate();
+		return 1;
+	}
+
+	glfwMakeContextCurrent(window);
+	if (glewInit() != GLEW_OK)
+	{
+		std::cout << "[FAILED] gpu: glewInit" << std::endl;
+		glfwDestroyWindow(window);
+		glfwTerminate();
+		return 1;
+	}
+
+	std::cout << "GL " << glGetString(GL_VERSION) << ", " << glGetString(GL_RENDERER) << std::endl;
+
+	int32_t failed = 0;
+	failed += RunGpuCullTest();
+	failed += RunQuadStoreTest();
+	RunQuadStoreBenchmark();
+	failed += RunGpuSteadyFrameAllocationTest(window);
+
+	glfwDestroyWindow(window);
+	glfwTerminate();
+
+	std::cout << (failed ? "[FAILED] " : "[PASSED] ") << failed << " failed" << std::endl;
+	return failed;
+}
+
+////////////////////////////////////////////////
+////////////////// ALLOCATIONS /////////////////
+////////////////////////////////////////////////
+
+// Every plain new and new[] in the process comes through here, containers and std::function included. It only counts
+// while a test has it switched on, on every thread (workers and the render thread too). The aligned forms aren't
+// replaced, nothing per frame is over-aligned.
+static std::atomic<bool> s_CountAllocations(false);
+static std::atomic<uint64_t> s_Allocations(0);
+
+void* operator new(size_t size)
+{
+	if (s_CountAllocations.load(std::memory_order_relaxed))
+		s_Allocations++;
+
+	void* memory = malloc(size ? size : 1);
+	if (!memory)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+	free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	free(memory);
+}
+
+static const uint32_t STEADY_WARMUP_FRAMES = 30; // vectors, arenas and pools grow to what the scene needs
+static const uint32_t STEADY_FRAMES = 60;
+static const uint32_t STEADY_WIDTH = 320;
+static const uint32_t STEADY_HEIGHT = 180;
+static const uint32_t STEADY_MAX_QUADS = 1000; // small, so the scene takes several batches
+static const uint32_t STEADY_THREADS = 4;
+static const uint32_t STEADY_QUADS = 2500;
+static const uint32_t STEADY_SPRITES = 500;
+static const uint32_t STEADY_CONTEXT_QUADS = 250; // per submission context
+static const uint32_t STEADY_PARTICLES = 20000;
+
+// a bit of every path a frame goes through, the same every frame except for the animation
+struct SteadyScene
+{
+	Camera Camera;
+	std::vector<Texture*> Textures; // more than the slots, so batches also break on textures
+	Font* Font;
+	ParticleSystem* Particles;
+	Tilemap* Tilemap; // OpenGL only
+	GpuQuadCuller* Culler; // OpenGL only
+	QuadStore* GpuQuads;
+	std::vector<QuadHandle> GpuQuadHandles;
+};
+
+static bool CreateSteadyScene(SteadyScene& scene, bool gpu)
+{
+	scene.Camera = Camera();
+	scene.Camera.FOV = 60.0f;
+	scene.Camera.AspectRatio = (float)STEADY_WIDTH / STEADY_HEIGHT;
+	scene.Camera.Transform = { { 25.0f, 25.0f, -45.0f }, { 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f } };
+
+	// the software renderer samples CPU only textures, the GL one real ones
+	for (uint32_t i = 0; i < MAX_TEXTURE_SLOTS + 4; i++)
+	{
+		uint32_t pixel = 0xff000000 | (i * 0x0a1b2c);
+		scene.Textures.push_back(new Texture(1, 1, 4, (unsigned char*)&pixel, 1, !gpu));
+	}
+
+	scene.Font = Font::FromFile("res/Lato-Regular.ttf", 512, !gpu);
+	scene.Particles = new ParticleSystem(STEADY_PARTICLES, STEADY_THREADS);
+	scene.Tilemap = nullptr;
+	scene.Culler = nullptr;
+	scene.GpuQuads = nullptr;
+
+	if (gpu)
+	{
+		scene.Tilemap = new Tilemap(256, 256, { 1.0f, 1.0f }, { 0.0f, 0.0f, 0.0f }, Renderer2D::GetVertexLayout(), STEADY_THREADS);
+		uint16_t white = scene.Tilemap->AddTileType({ scene.Textures[0], { 1.0f, 1.0f, 1.0f }, GetTilingRect(1.0f) });
+		uint16_t textured = scene.Tilemap->AddTileType({ scene.Textures[1], { 1.0f, 0.5f, 0.5f }, GetTilingRect(1.0f) });
+		for (uint32_t y = 0; y < 256; y++)
+		{
+			for (uint32_t x = 0; x < 256; x++)
+				scene.Tilemap->SetTile(x, y, (x + y) % 2 ? textured : white);
+		}
+
+		if (GpuQuadCuller::IsSupported())
+		{
+			scene.Culler = new GpuQuadCuller(QUAD_STORE_TEST_QUADS);
+			uint32_t slot = scene.Culler->AddTexture(scene.Textures[0]);
+			scene.GpuQuads = new QuadStore(scene.Culler);
+
+			uint32_t seed = 11;
+			for (uint32_t i = 0; i < QUAD_STORE_TEST_QUADS; i++)
+				scene.GpuQuadHandles.push_back(scene.GpuQuads->CreateQuad(MakeRandomQuad(seed, slot, false)));
+		}
+	}
+
+	return scene.Font != nullptr;
+}
+
+static void DestroySteadyScene(SteadyScene& scene)
+{
+	delete scene.GpuQuads;
+	delete scene.Culler;
+	delete scene.Tilemap;
+	delete scene.Particles;
+	delete scene.Font;
+	for (Texture* texture : scene.Textures)
+		delete texture;
+	scene.Textures.clear();
+}
+
+static void DrawSteadyScene(Renderer2D* renderer, SteadyScene& scene, uint32_t frame)
+{
+	float time = frame / 60.0f;
+
+	renderer->Clear({ 0.1f, 0.1f, 0.1f });
+
+	// once straight and once depth sorted, both are per frame paths
+	for (uint32_t pass = 0; pass < 2; pass++)
+	{
+		renderer->SetDepthSort(pass == 1);
+		renderer->BeginScene(scene.Camera);
+
+		for (uint32_t i = 0; i < STEADY_QUADS; i++)
+		{
+			Transform transform = { { (float)(i % 50), (float)(i / 50), -0.01f * pass }, { 0.0f, 0.0f, (float)((i + frame) % 90) }, { 0.9f, 0.9f, 1.0f } };
+			if (i % 3)
+				renderer->DrawQuadTextured(transform, scene.Textures[(i + pass) % scene.Textures.size()]);
+			else
+				renderer->DrawQuad(transform, { 0.2f, 0.9f, 0.5f });
+		}
+
+		renderer->DrawCircle({ 10.0f, 10.0f, -0.1f }, 2.0f, { 1.0f, 0.5f, 0.0f }, 0.2f);
+		renderer->DrawLine({ 0.0f, 0.0f, -0.1f }, { 50.0f, 50.0f, -0.1f }, 0.1f, { 1.0f, 1.0f, 1.0f });
+
+		WorkerPool::Get().Run(STEADY_THREADS, [&](uint32_t context)
+		{
+			SubmissionContext* submission = renderer->GetSubmissionContext(context);
+			for (uint32_t i = 0; i < STEADY_CONTEXT_QUADS; i++)
+			{
+				Transform transform = { { (float)(i % 25) + context * 25.0f, 25.0f + i / 25, -0.2f }, { 0.0f, 0.0f, 0.0f }, { 0.5f, 0.5f, 1.0f } };
+				submission->DrawQuadTextured(transform, scene.Textures[(i + context) % scene.Textures.size()]);
+			}
+		});
+
+		for (uint32_t i = 0; i < STEADY_SPRITES; i++)
+			renderer->DrawSprite2D(GetAffine2D({ (float)(i % 40), (float)(i / 40) }, time + i, { 0.5f, 0.5f }), scene.Textures[i % scene.Textures.size()], i % 4);
+
+		renderer->DrawString(scene.Font, "The quick brown fox 0123456789", { 0.0f, 45.0f, -0.3f }, 1.0f, { 1.0f, 0.85f, 0.2f }, 24);
+		renderer->DrawStringSdf(scene.Font, "jumps over the lazy dog", { 0.0f, 47.0f, -0.3f }, 1.0f);
+
+		renderer->DrawParticles(scene.Particles);
+
+		if (pass == 0 && scene.Tilemap)
+		{
+			// a few edits, so chunks are rebuilt and uploaded every frame
+			for (uint32_t i = 0; i < 8; i++)
+				scene.Tilemap->SetTile((frame * 37 + i * 101) % 256, (frame * 11 + i * 53) % 256, (uint16_t)((frame + i) % 2));
+			renderer->DrawTilemap(scene.Tilemap);
+		}
+
+		if (pass == 0 && scene.GpuQuads)
+			renderer->DrawGpuQuads(scene.Culler);
+
+		renderer->EndScene();
+	}
+}
+
+static void UpdateSteadyScene(SteadyScene& scene, uint32_t frame)
+{
+	ParticleEmitDesc desc = {};
+	desc.Position = { 25.0f, 25.0f, -0.5f };
+	desc.PositionVariance = { 5.0f, 5.0f, 0.0f };
+	desc.Velocity = { 0.0f, 2.0f, 0.0f };
+	desc.VelocityVariance = { 2.0f, 1.0f, 0.0f };
+	desc.ColorBegin = { 1.0f, 0.8f, 0.2f };
+	desc.ColorEnd = { 0.5f, 0.1f, 0.1f };
+	desc.LifeTime = 0.25f; // the count levels off at 300 * 15 well inside the warmup
+	desc.Size = 0.2f;
+
+	scene.Particles->Emit(desc, 300);
+	scene.Particles->Update(1.0f / 60.0f, { 0.0f, -2.0f, 0.0f });
+
+	if (scene.GpuQuads)
+	{
+		// 1% moves every frame
+		uint32_t seed = frame;
+		uint32_t slot = 0;
+		for (uint32_t i = 0; i < QUAD_STORE_TEST_QUADS / 100; i++)
+			scene.GpuQuads->UpdateQuad(scene.GpuQuadHandles[NextRandom(seed, QUAD_STORE_TEST_QUADS)], MakeRandomQuad(seed, slot, false));
+		scene.GpuQuads->Flush();
+	}
+}
+
+static int32_t ReportSteadyAllocations(const char* what, uint64_t allocations)
+{
+	bool passed = allocations == 0;
+	std::cout << (passed ? "[PASSED] " : "[FAILED] ") << "allocations: " << allocations << " in " << STEADY_FRAMES << " steady " << what
+		<< " frames (after " << STEADY_WARMUP_FRAMES << " to warm up)" << std::endl;
+	return passed ? 0 : 1;
+}
+
+int32_t RunSteadyFrameAllocationTest()
+{
+	SteadyScene scene;
+	if (!CreateSteadyScene(scene, false))
+	{
+		std::cout << "[FAILED] allocations: can't load res/Lato-Regular.ttf" << std::endl;
+		DestroySteadyScene(scene);
+		return 1;
+	}
+
+	Renderer2DConfig config;
+	config.MaxQuads = STEADY_MAX_QUADS;
+	config.ThreadCount = STEADY_THREADS;
+	config.SubmissionContexts = STEADY_THREADS;
+	config.Backend = RendererBackend::Software;
+	config.Width = STEADY_WIDTH;
+	config.Height = STEADY_HEIGHT;
+	Renderer2D* renderer = new Renderer2D(config);
+
+	for (uint32_t frame = 0; frame < STEADY_WARMUP_FRAMES + STEADY_FRAMES; frame++)
+	{
+		s_CountAllocations = frame >= STEADY_WARMUP_FRAMES;
+		UpdateSteadyScene(scene, frame);
+		DrawSteadyScene(renderer, scene, frame);
+	}
+	s_CountAllocations = false;
+
+	int32_t failed = ReportSteadyAllocations("software", s_Allocations.exchange(0));
+
+	delete renderer;
+	DestroySteadyScene(scene);
+	return failed;
+}
+
+int32_t RunGpuSteadyFrameAllocationTest(GLFWwindow* window)
+{
+	SteadyScene scene;
+	if (!CreateSteadyScene(scene, true))
+	{
+		std::cout << "[FAILED] allocations: can't load res/Lato-Regular.ttf" << std::endl;
+		DestroySteadyScene(scene);
+		return 1;
+	}
+
+	Renderer2DConfig config;
+	config.MaxQuads = STEADY_MAX_QUADS;
+	config.ThreadCount = STEADY_THREADS;
+	config.SubmissionContexts = STEADY_THREADS;
+	Renderer2D* renderer = new Renderer2D(config);
+
+	// the way the demo runs with everything on, commands recorded for the render thread and fences from the pacer
+	RenderThread* renderThread = new RenderThread(window, 2);
+	FramePacer* framePacer = new FramePacer();
+	framePacer->SetMaxFramesInFlight(2);
+
+	for (uint32_t frame = 0; frame < STEADY_WARMUP_FRAMES + STEADY_FRAMES; frame++)
+	{
+		s_CountAllocations = frame >= STEADY_WARMUP_FRAMES;
+
+		framePacer->BeginFrame();
+		UpdateSteadyScene(scene, frame);
+		DrawSteadyScene(renderer, scene, frame);
+
+		RenderThread::Run([window]()
+		{
+			glfwSwapBuffers(window);
+		});
+
+		framePacer->EndFrame();
+		renderThread->EndFrame();
+	}
+
+	// what's still queued is a steady frame too
+	renderThread->WaitIdle();
+	s_CountAllocations = false;
+
+	int32_t failed = ReportSteadyAllocations("OpenGL", s_Allocations.exchange(0));
+
+	delete renderThread;
+	delete framePacer;
+	delete renderer;
+	DestroySteadyScene(scene);
+	return failed;
+}
+
+int32_t RunTests()
+{
+	int32_t failed = 0;
+	failed += RunGoldenTests(false);
+	failed += RunSinCosTest();
+	failed += RunRasterizerTest();
+	failed += RunSpatialIndexTest();
+	failed += RunSteadyFrameAllocationTest();
+
+	std::cout << (failed ? "[FAILED] " : "[PASSED] ") << failed << " failed" << std::endl;
+	return failed;
+}
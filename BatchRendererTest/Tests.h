@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdint.h>
+
+struct GLFWwindow;
+
+// Checks that run before anything else is created, --test for the ones that don't need a window or a GL context.
+// Every group prints a line per case and returns how many failed, the process exits with the total.
+
+// canonical scenes on the software backend against the references in res/golden_*.tga,
+// capture writes new references instead (--golden-capture)
+int32_t RunGoldenTests(bool capture);
+
+// SinCos against sin/cos in double over the range Math.h documents
+int32_t RunSinCosTest();
+
+// the fill rule on shared edges and the blend modes of the software backend
+int32_t RunRasterizerTest();
+
+// removing twice and moving removed handles are turned down without touching the grid
+int32_t RunSpatialIndexTest();
+
+// no heap allocation at all, on any thread, once a scene that touches every per frame path has warmed up
+int32_t RunSteadyFrameAllocationTest();
+
+int32_t RunTests();
+
+// The ones below need GL and make their own context in a hidden window (--test-gpu), so they run wherever there is
+// a 4.5 driver, Mesa llvmpipe included (its opengl32.dll next to the exe on windows).
+
+// the compute cull of GpuQuadCuller against the same sphere test on the cpu, and its texture slot limit
+int32_t RunGpuCullTest();
+
+// handles that were destroyed or never created, churn checked against the GPU's visible count, an idle flush
+int32_t RunQuadStoreTest();
+
+// upload bytes, ranges and flush time at the demo's 1M quads with 0.1%, 1% and 10% changed per frame
+void RunQuadStoreBenchmark();
+
+// the same on GL, with the tilemap and GPU quads added and a render thread and frame pacer running
+int32_t RunGpuSteadyFrameAllocationTest(GLFWwindow* window);
+
+int32_t RunGpuTests();
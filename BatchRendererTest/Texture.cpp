@@ -5,9 +5,18 @@
 
 #include "stb/stb_image.h"
 
-Texture::Texture(uint32_t width, uint32_t height, uint32_t channels, unsigned char* data)
-	: m_Width(width), m_Height(height)
+#include "RenderThread.h"
+
+Texture::Texture(uint32_t width, uint32_t height, uint32_t channels, unsigned char* data, uint32_t mipLevels, bool cpuOnly)
+	: m_RendererID(0), m_Width(width), m_Height(height), m_Channels(channels), m_MipLevels(mipLevels > 0 ? mipLevels : 1)
 {
+	if (cpuOnly && data)
+	{
+		m_Pixels.resize(m_Width * m_Height);
+		CopyPixels(0, 0, m_Width, m_Height, data);
+		return;
+	}
+
 	if (channels == 3)
 	{
 		m_InternalFormat = GL_RGB8;
@@ -19,36 +28,105 @@ Texture::Texture(uint32_t width, uint32_t height, uint32_t channels, unsigned ch
 		m_DataFormat = GL_RGBA;
 	}
 
-	glCreateTextures(GL_TEXTURE_2D, 1, &m_RendererID);
-	glTextureStorage2D(m_RendererID, 1, m_InternalFormat, m_Width, m_Height);
+	// we need the id right away, so this one waits for the render thread
+	RenderThread::RunSync([this, data]()
+	{
+		glCreateTextures(GL_TEXTURE_2D, 1, &m_RendererID);
+		glTextureStorage2D(m_RendererID, m_MipLevels, m_InternalFormat, m_Width, m_Height);
 
-	glTextureParameteri(m_RendererID, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTextureParameteri(m_RendererID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTextureParameteri(m_RendererID, GL_TEXTURE_MIN_FILTER, m_MipLevels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+		glTextureParameteri(m_RendererID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-	glTextureParameteri(m_RendererID, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTextureParameteri(m_RendererID, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTextureParameteri(m_RendererID, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTextureParameteri(m_RendererID, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
-	glTextureSubImage2D(m_RendererID, 0, 0, 0, m_Width, m_Height, m_DataFormat, GL_UNSIGNED_BYTE, data);
+		if (data)
+			glTextureSubImage2D(m_RendererID, 0, 0, 0, m_Width, m_Height, m_DataFormat, GL_UNSIGNED_BYTE, data);
+	});
 }
 
 Texture::~Texture()
 {
-	glDeleteTextures(1, &m_RendererID);
+	if (IsCpuOnly())
+		return;
+
+	uint32_t rendererID = m_RendererID;
+	RenderThread::Run([rendererID]()
+	{
+		glDeleteTextures(1, &rendererID);
+	});
 }
 
 void Texture::Bind(uint32_t slot)
 {
+	if (IsCpuOnly())
+		return;
+
 	glBindTextureUnit(slot, m_RendererID);
 }
 
-Texture* Texture::FromFile(const char* path)
+void Texture::SetData(uint32_t x, uint32_t y, uint32_t width, uint32_t height, const unsigned char* data)
+{
+	if (IsCpuOnly())
+	{
+		CopyPixels(x, y, width, height, data);
+		return;
+	}
+
+	if (RenderThread::IsRecording())
+	{
+		// the caller's buffer won't be around when the render thread gets to it
+		std::vector<unsigned char> copy(data, data + width * height * m_Channels);
+		uint32_t rendererID = m_RendererID;
+		uint32_t dataFormat = m_DataFormat;
+
+		RenderThread::Run([rendererID, dataFormat, x, y, width, height, copy]()
+		{
+			glTextureSubImage2D(rendererID, 0, x, y, width, height, dataFormat, GL_UNSIGNED_BYTE, copy.data());
+		});
+	}
+	else
+	{
+		glTextureSubImage2D(m_RendererID, 0, x, y, width, height, m_DataFormat, GL_UNSIGNED_BYTE, data);
+	}
+}
+
+// the software renderer only samples level 0
+void Texture::GenerateMipmaps()
+{
+	if (IsCpuOnly())
+		return;
+
+	uint32_t rendererID = m_RendererID;
+	RenderThread::Run([rendererID]()
+	{
+		glGenerateTextureMipmap(rendererID);
+	});
+}
+
+void Texture::CopyPixels(uint32_t x, uint32_t y, uint32_t width, uint32_t height, const unsigned char* data)
+{
+	for (uint32_t row = 0; row < height; row++)
+	{
+		for (uint32_t column = 0; column < width; column++)
+		{
+			const unsigned char* texel = data + (row * width + column) * m_Channels;
+			uint32_t alpha = m_Channels == 4 ? texel[3] : 0xff;
+			m_Pixels[(y + row) * m_Width + x + column] = texel[0] | (texel[1] << 8) | (texel[2] << 16) | (alpha << 24);
+		}
+	}
+}
+
+Texture* Texture::FromFile(const char* path, bool cpuOnly)
 {
 	Texture* result;
 
 	int width, height, channels;
 	stbi_uc* textureData = stbi_load(path, &width, &height, &channels, 0);
+	if (!textureData)
+		return nullptr;
 
-	result = new Texture(width, height, channels, textureData);
+	result = new Texture(width, height, channels, textureData, 1, cpuOnly);
 
 	stbi_image_free(textureData);
 
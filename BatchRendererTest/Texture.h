@@ -2,17 +2,36 @@
 
 #include <stdint.h>
 
+#include <vector>
+
 class Texture
 {
 public:
-	Texture(uint32_t width, uint32_t height, uint32_t channels, unsigned char* data);
+	// data can be nullptr for a texture something renders into, mipLevels > 1 needs GenerateMipmaps once it has contents.
+	// cpuOnly keeps just the pixels and never touches GL, that's what a software renderer samples (see
+	// Renderer2D::UsesCpuTextures). A texture something renders into is always a GL one, even with cpuOnly set.
+	Texture(uint32_t width, uint32_t height, uint32_t channels, unsigned char* data, uint32_t mipLevels = 1, bool cpuOnly = false);
 	~Texture();
 
 	void Bind(uint32_t slot);
 
-	static Texture* FromFile(const char* path);
+	// updates a region, data has to be in the format the texture was created with
+	void SetData(uint32_t x, uint32_t y, uint32_t width, uint32_t height, const unsigned char* data);
+	void GenerateMipmaps();
+
+	// nullptr when the file can't be loaded
+	static Texture* FromFile(const char* path, bool cpuOnly = false);
 
 	inline uint32_t GetRendererID() const { return m_RendererID; }
+	inline uint32_t GetWidth() const { return m_Width; }
+	inline uint32_t GetHeight() const { return m_Height; }
+
+	// RGBA8 texels of a CPU only texture, nullptr for GL ones
+	inline const uint32_t* GetPixels() const { return m_Pixels.empty() ? nullptr : m_Pixels.data(); }
+	inline bool IsCpuOnly() const { return m_RendererID == 0; }
+
+private:
+	void CopyPixels(uint32_t x, uint32_t y, uint32_t width, uint32_t height, const unsigned char* data);
 
 private:
 	uint32_t m_RendererID;
@@ -20,5 +39,8 @@ private:
 	uint32_t m_Height;
 	uint32_t m_InternalFormat;
 	uint32_t m_DataFormat;
+	uint32_t m_Channels;
+	uint32_t m_MipLevels;
+	std::vector<uint32_t> m_Pixels;
 };
 
@@ -0,0 +1,402 @@
+#include "Tilemap.h"
+
+#include "GL/glew.h"
+
+#include "Buffer.h"
+#include "Texture.h"
+#include "RenderThread.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+
+Tilemap::Tilemap(uint32_t width, uint32_t height, Vec2 tileSize, Vec3 origin, const VertexLayout& layout, uint32_t threadCount)
+	: m_Width(width), m_Height(height), m_TileSize(tileSize), m_Origin(origin), m_TextureCount(0), m_Features(ShaderFeature_None),
+	m_MaxResidentChunks(1024), m_MaxUploadsPerFrame(256), m_ThreadCount(threadCount < 1 ? 1 : threadCount), m_Frame(0)
+{
+	m_ChunksX = (width + ChunkSize - 1) / ChunkSize;
+	m_ChunksY = (height + ChunkSize - 1) / ChunkSize;
+
+	m_Tiles.resize(width * height, EmptyTile);
+
+	m_Chunks.resize(m_ChunksX * m_ChunksY);
+	for (uint32_t y = 0; y < m_ChunksY; y++)
+	{
+		for (uint32_t x = 0; x < m_ChunksX; x++)
+		{
+			TilemapChunk& chunk = m_Chunks[y * m_ChunksX + x];
+			chunk.X = x;
+			chunk.Y = y;
+			chunk.QuadCount = 0;
+			chunk.Dirty = true;
+			chunk.Resident = false;
+			chunk.LastVisibleFrame = 0;
+		}
+	}
+	m_Buffers.resize(m_Chunks.size(), nullptr);
+
+	for (uint32_t i = 0; i < MAX_TEXTURE_SLOTS; i++)
+		m_Textures[i] = nullptr;
+
+	m_VertexStride = layout.GetStride();
+
+	// same index pattern as the quad batch, shared by every chunk
+	uint32_t quads = ChunkSize * ChunkSize;
+	std::vector<uint32_t> indices(quads * 6);
+	for (uint32_t i = 0; i < quads; i++)
+	{
+		indices[i * 6 + 0] = i * 4 + 0;
+		indices[i * 6 + 1] = i * 4 + 1;
+		indices[i * 6 + 2] = i * 4 + 2;
+		indices[i * 6 + 3] = i * 4 + 2;
+		indices[i * 6 + 4] = i * 4 + 3;
+		indices[i * 6 + 5] = i * 4 + 0;
+	}
+
+	RenderThread::RunSync([this, &indices, &layout]()
+	{
+		m_IndexBuffer = new IndexBuffer(indices.data(), sizeof(uint32_t) * indices.size());
+
+		// one vao, the chunk buffers are just swapped on binding 0 before each draw
+		glCreateVertexArrays(1, &m_VertexArray);
+
+		const std::vector<VertexAttribute>& attributes = layout.GetAttributes();
+		for (uint32_t i = 0; i < attributes.size(); i++)
+		{
+			glEnableVertexArrayAttrib(m_VertexArray, i);
+			glVertexArrayAttribFormat
+			(
+				m_VertexArray, i, GetDataTypeCount(attributes[i].Type),
+				GetDataTypeBaseType(attributes[i].Type),
+				attributes[i].Normalized ? GL_TRUE : GL_FALSE, attributes[i].Offset
+			);
+			glVertexArrayAttribBinding(m_VertexArray, i, 0);
+		}
+		glVertexArrayElementBuffer(m_VertexArray, m_IndexBuffer->GetID());
+	});
+}
+
+Tilemap::~Tilemap()
+{
+	for (VertexBuffer* buffer : m_Buffers)
+		delete buffer;
+
+	glDeleteVertexArrays(1, &m_VertexArray);
+	delete m_IndexBuffer;
+}
+
+uint16_t Tilemap::AddTileType(const TileType& type)
+{
+	// EmptyTile is the one id that can't be a type
+	if (m_Types.size() >= EmptyTile)
+		return EmptyTile;
+
+	m_Types.push_back(type);
+	m_TypeTextureIndex.push_back(0.0f);
+
+	uint16_t id = (uint16_t)(m_Types.size() - 1);
+	if (!SetTileType(id, type))
+	{
+		m_Types.pop_back();
+		m_TypeTextureIndex.pop_back();
+		return EmptyTile;
+	}
+
+	return id;
+}
+
+bool Tilemap::SetTileType(uint16_t id, const TileType& type)
+{
+	if (id >= m_Types.size())
+		return false;
+
+	int32_t slot = -1;
+	for (uint32_t i = 0; i < m_TextureCount; i++)
+	{
+		if (m_Textures[i] == type.Texture)
+			slot = i;
+	}
+	if (slot == -1)
+	{
+		// the whole map is one draw per chunk, there's no second batch to spill into
+		if (m_TextureCount == MAX_TEXTURE_SLOTS)
+			return false;
+
+		slot = m_TextureCount;
+		m_Textures[m_TextureCount++] = type.Texture;
+	}
+	m_Types[id] = type;
+	m_TypeTextureIndex[id] = (float)slot;
+
+	// every type is assumed to be textured and tinted, it's one permutation for the whole map anyway
+	m_Features = ShaderFeature_Textured | ShaderFeature_Tinted;
+
+	for (TilemapChunk& chunk : m_Chunks)
+		chunk.Dirty = true;
+
+	return true;
+}
+
+void Tilemap::SetTile(uint32_t x, uint32_t y, uint16_t tile)
+{
+	uint16_t& current = m_Tiles[y * m_Width + x];
+	if (current == tile)
+		return;
+
+	current = tile;
+	m_Chunks[(y / ChunkSize) * m_ChunksX + x / ChunkSize].Dirty = true;
+}
+
+// true when all the corners are on the outside of the same clip plane
+static bool IsOutside(const glm::vec4* corners, uint32_t count)
+{
+	for (uint32_t axis = 0; axis < 3; axis++)
+	{
+		bool below = true;
+		bool above = true;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			below = below && corners[i][axis] < -corners[i].w;
+			above = above && corners[i][axis] > corners[i].w;
+		}
+		if (below || above)
+			return true;
+	}
+	return false;
+}
+
+void Tilemap::Cull(const glm::mat4& viewProj, TilemapFrame& frame, bool buildUploads)
+{
+	m_Frame++;
+
+	frame.Visible.clear();
+	frame.VisibleQuadCounts.clear();
+	frame.Uploads.clear();
+	frame.UploadQuadCounts.clear();
+	frame.Evictions.clear();
+	frame.VisibleQuads = 0;
+	frame.OverBudget = 0;
+
+	float chunkWidth = m_TileSize.X * ChunkSize;
+	float chunkHeight = m_TileSize.Y * ChunkSize;
+
+	for (uint32_t i = 0; i < m_Chunks.size(); i++)
+	{
+		TilemapChunk& chunk = m_Chunks[i];
+
+		// tiles are centered on their grid position, like the checkerboard
+		float minX = m_Origin.X + chunk.X * chunkWidth - m_TileSize.X * 0.5f;
+		float minY = m_Origin.Y + chunk.Y * chunkHeight - m_TileSize.Y * 0.5f;
+
+		glm::vec4 corners[4] =
+		{
+			viewProj * glm::vec4(minX, minY, m_Origin.Z, 1.0f),
+			viewProj * glm::vec4(minX + chunkWidth, minY, m_Origin.Z, 1.0f),
+			viewProj * glm::vec4(minX + chunkWidth, minY + chunkHeight, m_Origin.Z, 1.0f),
+			viewProj * glm::vec4(minX, minY + chunkHeight, m_Origin.Z, 1.0f)
+		};
+
+		if (IsOutside(corners, 4))
+			continue;
+
+		chunk.LastVisibleFrame = m_Frame;
+		frame.Visible.push_back(i);
+	}
+
+	if (!buildUploads)
+		return;
+
+	// the room for new chunks comes from the ones seen longest ago, before anything is built
+	uint32_t incoming = 0;
+	for (uint32_t i : frame.Visible)
+	{
+		if (!m_Chunks[i].Resident)
+			incoming++;
+	}
+	EvictChunks(frame, std::min(incoming, m_MaxUploadsPerFrame));
+
+	uint32_t added = 0;
+	for (uint32_t i : frame.Visible)
+	{
+		TilemapChunk& chunk = m_Chunks[i];
+		if (!chunk.Dirty && chunk.Resident)
+			continue;
+
+		// whatever is still resident is visible now, a new chunk past the budget would only evict one of those
+		if (!chunk.Resident && m_Resident.size() + added >= m_MaxResidentChunks)
+		{
+			frame.OverBudget++;
+			continue;
+		}
+
+		if (frame.Uploads.size() == m_MaxUploadsPerFrame)
+			continue;
+
+		frame.Uploads.push_back(i);
+		added += chunk.Resident ? 0 : 1;
+	}
+
+	BuildUploads(frame);
+
+	// chunks still waiting for their first upload are skipped by Draw
+	for (uint32_t i : frame.Visible)
+	{
+		uint32_t quads = m_Chunks[i].Resident ? m_Chunks[i].QuadCount : 0;
+		frame.VisibleQuadCounts.push_back(quads);
+		frame.VisibleQuads += quads;
+	}
+}
+
+void Tilemap::BuildUploads(TilemapFrame& frame)
+{
+	uint32_t count = (uint32_t)frame.Uploads.size();
+	if (count == 0)
+		return;
+
+	frame.UploadQuadCounts.resize(count);
+	frame.UploadVertices.resize(count * ChunkSize * ChunkSize * 4);
+
+	// fewer chunks than threads: one each and the rest of the threads stay out of it
+	uint32_t threadsUsed = std::min(m_ThreadCount, count);
+	uint32_t chunksPerThread = count / threadsUsed;
+	const uint32_t* uploads = frame.Uploads.data();
+	Vertex* vertices = frame.UploadVertices.data();
+	uint32_t* quadCounts = frame.UploadQuadCounts.data();
+
+	WorkerPool::Get().Run(threadsUsed, [=](uint32_t thread)
+	{
+		uint32_t begin = chunksPerThread * thread;
+		uint32_t end = thread == threadsUsed - 1 ? count : begin + chunksPerThread;
+		BuildChunks(uploads + begin, end - begin, vertices + begin * ChunkSize * ChunkSize * 4, quadCounts + begin);
+	});
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		TilemapChunk& chunk = m_Chunks[frame.Uploads[i]];
+
+		if (!chunk.Resident)
+		{
+			chunk.Resident = true;
+			m_Resident.push_back(frame.Uploads[i]);
+		}
+
+		chunk.QuadCount = frame.UploadQuadCounts[i];
+		chunk.Dirty = false;
+	}
+}
+
+// makes room for incoming new chunks, visible ones are never dropped
+void Tilemap::EvictChunks(TilemapFrame& frame, uint32_t incoming)
+{
+	if (m_Resident.size() + incoming <= m_MaxResidentChunks)
+		return;
+
+	// least recently seen first
+	std::sort(m_Resident.begin(), m_Resident.end(), [this](uint32_t a, uint32_t b)
+	{
+		return m_Chunks[a].LastVisibleFrame < m_Chunks[b].LastVisibleFrame;
+	});
+
+	uint32_t evict = 0;
+	while (evict < m_Resident.size() && m_Resident.size() - evict + incoming > m_MaxResidentChunks && m_Chunks[m_Resident[evict]].LastVisibleFrame != m_Frame)
+	{
+		TilemapChunk& chunk = m_Chunks[m_Resident[evict]];
+		chunk.Resident = false;
+		chunk.QuadCount = 0;
+		frame.Evictions.push_back(m_Resident[evict]);
+		evict++;
+	}
+
+	m_Resident.erase(m_Resident.begin(), m_Resident.begin() + evict);
+}
+
+void Tilemap::BuildChunks(const uint32_t* chunks, uint32_t count, Vertex* vertices, uint32_t* quadCounts) const
+{
+	for (uint32_t i = 0; i < count; i++)
+	{
+		quadCounts[i] = BuildChunkVertices(chunks[i], vertices);
+		vertices += ChunkSize * ChunkSize * 4;
+	}
+}
+
+uint32_t Tilemap::BuildChunkVertices(uint32_t chunkIndex, Vertex* vertices) const
+{
+	const TilemapChunk& chunk = m_Chunks[chunkIndex];
+
+	uint32_t beginX = chunk.X * ChunkSize;
+	uint32_t beginY = chunk.Y * ChunkSize;
+	uint32_t endX = std::min(beginX + ChunkSize, m_Width);
+	uint32_t endY = std::min(beginY + ChunkSize, m_Height);
+
+	float halfWidth = m_TileSize.X * 0.5f;
+	float halfHeight = m_TileSize.Y * 0.5f;
+	float z = m_Origin.Z;
+
+	uint32_t quads = 0;
+	for (uint32_t y = beginY; y < endY; y++)
+	{
+		for (uint32_t x = beginX; x < endX; x++)
+		{
+			uint16_t tile = m_Tiles[y * m_Width + x];
+			if (tile == EmptyTile)
+				continue;
+
+			const TileType& type = m_Types[tile];
+			float textureIndex = m_TypeTextureIndex[tile];
+			const Vec4& rect = type.TextureRect;
+
+			float cx = m_Origin.X + x * m_TileSize.X;
+			float cy = m_Origin.Y + y * m_TileSize.Y;
+
+			// same corners and texture coordinates CalcVertices produces for an unrotated quad
+			vertices[0] = { { cx - halfWidth, cy - halfHeight, z }, type.Color, { rect.X, rect.W }, textureIndex };
+			vertices[1] = { { cx + halfWidth, cy - halfHeight, z }, type.Color, { rect.Z, rect.W }, textureIndex };
+			vertices[2] = { { cx + halfWidth, cy + halfHeight, z }, type.Color, { rect.Z, rect.Y }, textureIndex };
+			vertices[3] = { { cx - halfWidth, cy + halfHeight, z }, type.Color, { rect.X, rect.Y }, textureIndex };
+			vertices += 4;
+			quads++;
+		}
+	}
+
+	return quads;
+}
+
+uint32_t Tilemap::Draw(const TilemapFrame& frame)
+{
+	for (uint32_t chunk : frame.Evictions)
+	{
+		delete m_Buffers[chunk];
+		m_Buffers[chunk] = nullptr;
+	}
+
+	for (uint32_t i = 0; i < frame.Uploads.size(); i++)
+	{
+		VertexBuffer*& buffer = m_Buffers[frame.Uploads[i]];
+		if (!buffer)
+			buffer = new VertexBuffer(sizeof(Vertex) * ChunkSize * ChunkSize * 4);
+
+		if (frame.UploadQuadCounts[i] > 0)
+			buffer->SetData((float*)(frame.UploadVertices.data() + i * ChunkSize * ChunkSize * 4), sizeof(Vertex) * 4 * frame.UploadQuadCounts[i], 0);
+	}
+
+	for (uint32_t i = 0; i < m_TextureCount; i++)
+		m_Textures[i]->Bind(i);
+
+	glBindVertexArray(m_VertexArray);
+
+	uint32_t drawCalls = 0;
+	for (uint32_t i = 0; i < frame.Visible.size(); i++)
+	{
+		VertexBuffer* buffer = m_Buffers[frame.Visible[i]];
+		uint32_t quads = frame.VisibleQuadCounts[i];
+		if (quads == 0 || !buffer)
+			continue;
+
+		glVertexArrayVertexBuffer(m_VertexArray, 0, buffer->GetID(), 0, m_VertexStride);
+		glDrawElements(GL_TRIANGLES, quads * 6, GL_UNSIGNED_INT, nullptr);
+		drawCalls++;
+	}
+
+	glBindVertexArray(0);
+
+	return drawCalls;
+}
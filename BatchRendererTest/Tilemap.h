@@ -0,0 +1,128 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "Math.h"
+#include "Vertex.h"
+#include "ShaderPermutation.h"
+
+class Texture;
+class VertexBuffer;
+class VertexLayout;
+class IndexBuffer;
+
+struct TileType
+{
+	Texture* Texture;
+	Vec3 Color;
+	Vec4 TextureRect; // U0, V0, U1, V1 like TexturedQuad
+};
+
+struct TilemapChunk
+{
+	uint32_t X, Y; // in chunks
+	uint32_t QuadCount;
+	bool Dirty;
+	bool Resident; // has a vertex buffer on the GL side
+	uint64_t LastVisibleFrame;
+};
+
+// everything Draw needs for one frame, so culling (game side) and drawing (GL side) can run on different threads
+struct TilemapFrame
+{
+	std::vector<uint32_t> Visible;
+	std::vector<uint32_t> VisibleQuadCounts;
+	std::vector<uint32_t> Uploads;
+	std::vector<uint32_t> UploadQuadCounts;
+	std::vector<Vertex> UploadVertices; // ChunkSize * ChunkSize * 4 per upload
+	std::vector<uint32_t> Evictions;
+	uint32_t VisibleQuads;
+	uint32_t OverBudget; // visible chunks that weren't built because MaxResidentChunks was reached
+};
+
+// Grid of tiles split in ChunkSize x ChunkSize chunks, every chunk keeps its own vertex buffer
+// so a frame only costs a frustum test per chunk and a draw call per visible one.
+// Vertices are built the first time a chunk shows up and rebuilt only when one of its tiles changes,
+// chunks that haven't been seen for a while get their buffer freed to make room under MaxResidentChunks,
+// and when the visible ones alone need more than that the rest are left unbuilt (TilemapFrame::OverBudget).
+// Cull never touches GL and Draw only touches the chunk buffers, that's the split the render thread needs.
+class Tilemap
+{
+public:
+	Tilemap(uint32_t width, uint32_t height, Vec2 tileSize, Vec3 origin, const VertexLayout& layout, uint32_t threadCount);
+	~Tilemap();
+
+	// returns the id to use with SetTile, the texture counts against MAX_TEXTURE_SLOTS
+	// and EmptyTile comes back when it's a new one and they're all taken
+	uint16_t AddTileType(const TileType& type);
+	// rebuilds every chunk, false (and the type left as it was) when the texture doesn't fit
+	bool SetTileType(uint16_t id, const TileType& type);
+
+	void SetTile(uint32_t x, uint32_t y, uint16_t tile);
+	inline uint16_t GetTile(uint32_t x, uint32_t y) const { return m_Tiles[y * m_Width + x]; }
+
+	// finds the chunks inside the frustum, when buildUploads is true it also builds the vertices
+	// of the visible chunks that are new or dirty (up to MaxUploadsPerFrame) and picks the ones to evict
+	void Cull(const glm::mat4& viewProj, TilemapFrame& frame, bool buildUploads = true);
+
+	// applies the frame's uploads/evictions, then one draw call per visible chunk with whatever shader is bound
+	uint32_t Draw(const TilemapFrame& frame);
+
+	// for the software backend, writes the chunk the same way it would be uploaded and returns the quad count
+	uint32_t BuildChunkVertices(uint32_t chunk, Vertex* vertices) const;
+
+	inline Texture** GetTextures() { return m_Textures; }
+	inline uint32_t GetTextureCount() const { return m_TextureCount; }
+	inline uint32_t GetFeatures() const { return m_Features; }
+
+	inline uint32_t GetWidth() const { return m_Width; }
+	inline uint32_t GetHeight() const { return m_Height; }
+	inline uint32_t GetChunkCount() const { return (uint32_t)m_Chunks.size(); }
+	inline uint32_t GetResidentChunkCount() const { return (uint32_t)m_Resident.size(); }
+
+	inline void SetMaxResidentChunks(uint32_t count) { m_MaxResidentChunks = count; }
+	inline void SetMaxUploadsPerFrame(uint32_t count) { m_MaxUploadsPerFrame = count; }
+
+	static const uint32_t ChunkSize = 32;
+	static const uint16_t EmptyTile = 0xffff;
+
+private:
+	void BuildUploads(TilemapFrame& frame);
+	void EvictChunks(TilemapFrame& frame, uint32_t incoming);
+	void BuildChunks(const uint32_t* chunks, uint32_t count, Vertex* vertices, uint32_t* quadCounts) const;
+
+private:
+	uint32_t m_Width;
+	uint32_t m_Height;
+	uint32_t m_ChunksX;
+	uint32_t m_ChunksY;
+	Vec2 m_TileSize;
+	Vec3 m_Origin;
+
+	std::vector<uint16_t> m_Tiles;
+	std::vector<TilemapChunk> m_Chunks;
+
+	std::vector<TileType> m_Types;
+	Texture* m_Textures[MAX_TEXTURE_SLOTS];
+	std::vector<float> m_TypeTextureIndex;
+	uint32_t m_TextureCount;
+	uint32_t m_Features;
+
+	uint32_t m_VertexArray;
+	uint32_t m_VertexStride;
+	IndexBuffer* m_IndexBuffer;
+
+	std::vector<VertexBuffer*> m_Buffers; // per chunk, only touched by Draw
+
+	std::vector<uint32_t> m_Resident;
+	uint32_t m_MaxResidentChunks;
+	uint32_t m_MaxUploadsPerFrame;
+
+	uint32_t m_ThreadCount;
+
+	uint64_t m_Frame;
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Math.h"
+
+// layout has to match the VertexLayout set on the quad vertex buffer in InitRenderer
+
+// analytic shapes evaluated in the fragment shader (SHAPE permutation), TextureCoordinates
+// is then the position inside the quad relative to its center instead of a uv
+enum ShapeKind
+{
+    ShapeKind_None = 0,
+    ShapeKind_Circle = 1,      // Shape = { kind, radius, ring thickness (0 = filled), 0 }
+    ShapeKind_RoundedRect = 2  // Shape = { kind, half width, half height, corner radius }, lines are capsules
+};
+
+struct Vertex
+{
+    Vec3 Position;
+    Vec3 Color;
+    Vec2 TextureCoordinates;
+    float TextureIndex; // PackShape in SHAPE batches
+};
+
+// SHAPE batches don't sample a texture, so TextureIndex carries the part of the shape the quad doesn't already give:
+// circles their ring thickness (>= 0), rounded rects -1 - their corner radius. The quad is exactly the shape bounds,
+// so the radius or half size is the absolute TextureCoordinates of any corner. Every other quad keeps its 36 bytes.
+inline float PackShape(const Vec4& shape)
+{
+    return shape.X < 1.5f ? shape.Z : -1.0f - shape.W;
+}
+
+inline Vec4 UnpackShape(float packed, Vec2 corner)
+{
+    float halfWidth = corner.X < 0.0f ? -corner.X : corner.X;
+    float halfHeight = corner.Y < 0.0f ? -corner.Y : corner.Y;
+    if (packed >= 0.0f)
+        return { (float)ShapeKind_Circle, halfWidth, packed, 0.0f };
+    return { (float)ShapeKind_RoundedRect, halfWidth, halfHeight, -1.0f - packed };
+}
@@ -0,0 +1,91 @@
+#include "WorkerPool.h"
+
+WorkerPool& WorkerPool::Get()
+{
+	static WorkerPool pool(std::thread::hardware_concurrency() > 1 ? std::thread::hardware_concurrency() - 1 : 0);
+	return pool;
+}
+
+WorkerPool::WorkerPool(uint32_t threadCount)
+	: m_Jobs(nullptr), m_Stop(false)
+{
+	for (uint32_t i = 0; i < threadCount; i++)
+		m_Threads.emplace_back(&WorkerPool::ThreadMain, this);
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stop = true;
+	}
+	m_WorkAvailable.notify_all();
+
+	for (std::thread& thread : m_Threads)
+		thread.join();
+}
+
+void WorkerPool::Run(uint32_t taskCount, WorkerTask function, void* context)
+{
+	// nothing to share, skip the lock
+	if (taskCount <= 1 || m_Threads.empty())
+	{
+		for (uint32_t i = 0; i < taskCount; i++)
+			function(context, i);
+		return;
+	}
+
+	Job job = { function, context, taskCount, 0, 0, nullptr };
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	Job** tail = &m_Jobs;
+	while (*tail)
+		tail = &(*tail)->Next;
+	*tail = &job;
+
+	m_WorkAvailable.notify_all();
+
+	while (job.NextTask < job.TaskCount)
+		RunTask(lock, &job);
+
+	// the last ones may still run on the workers
+	m_TaskDone.wait(lock, [&job]() { return job.Running == 0; });
+}
+
+void WorkerPool::RunTask(std::unique_lock<std::mutex>& lock, Job* job)
+{
+	uint32_t task = job->NextTask++;
+	job->Running++;
+
+	// the last task is handed out, nobody else needs to find the job
+	if (job->NextTask == job->TaskCount)
+	{
+		Job** link = &m_Jobs;
+		while (*link != job)
+			link = &(*link)->Next;
+		*link = job->Next;
+	}
+
+	lock.unlock();
+	job->Function(job->Context, task);
+	lock.lock();
+
+	// the job is on its caller's stack, it may be gone as soon as this reaches 0 and the lock is dropped
+	if (--job->Running == 0 && job->NextTask == job->TaskCount)
+		m_TaskDone.notify_all();
+}
+
+void WorkerPool::ThreadMain()
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	while (true)
+	{
+		m_WorkAvailable.wait(lock, [this]() { return m_Stop || m_Jobs; });
+
+		if (m_Stop)
+			break;
+
+		RunTask(lock, m_Jobs);
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+typedef void (*WorkerTask)(void* context, uint32_t task);
+
+// Threads that live as long as the process, for the fork/join work the renderer splits over ThreadCount every frame.
+// Run hands out task indices to whoever is free, the calling thread included, and returns once all of them are done.
+// The job is a struct on the caller's stack and the tasks are a function pointer and a context, so running something
+// never allocates. Several threads can Run at once and a task can Run its own tasks, the callers work on their
+// own job until it's empty, so nobody waits on something that isn't being worked on.
+class WorkerPool
+{
+public:
+	// hardware_concurrency - 1 threads (the caller is the last one), started on first use
+	static WorkerPool& Get();
+
+	WorkerPool(uint32_t threadCount);
+	~WorkerPool();
+
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	// function(context, i) for every i in [0, taskCount)
+	void Run(uint32_t taskCount, WorkerTask function, void* context);
+
+	// same with a lambda taking the task index, it only has to live until this returns
+	template<typename Function>
+	inline void Run(uint32_t taskCount, const Function& function)
+	{
+		Run(taskCount, [](void* context, uint32_t task) { (*(const Function*)context)(task); }, (void*)&function);
+	}
+
+	inline uint32_t GetThreadCount() const { return (uint32_t)m_Threads.size(); }
+
+private:
+	struct Job
+	{
+		WorkerTask Function;
+		void* Context;
+		uint32_t TaskCount;
+		uint32_t NextTask;
+		uint32_t Running; // handed out and not done yet
+		Job* Next;
+	};
+
+	void ThreadMain();
+	// with the lock held and a task left in job, the lock is dropped while it runs
+	void RunTask(std::unique_lock<std::mutex>& lock, Job* job);
+
+private:
+	std::vector<std::thread> m_Threads;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_WorkAvailable;
+	std::condition_variable m_TaskDone;
+
+	Job* m_Jobs; // the ones with tasks left to hand out, oldest first
+	bool m_Stop;
+};